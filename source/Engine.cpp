@@ -31,9 +31,19 @@
 #include "callbacks.hpp"
 #include "state/IdleState.hpp"
 #include "util/sleep.hpp"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <cstdlib>
 
+namespace {
+    /// Returns the wall clock time, in seconds.
+    double wallTime() {
+        return std::chrono::duration<double>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
 void Engine::initWindowSystem() {
     // Initialize GLFW.
     if(!glfwInit()) {
@@ -64,43 +74,37 @@ void Engine::initWindowSystem() {
 }
 
 void Engine::initSystems() {
-    _renderSystem.init();
+    // There is nothing to render to when headless.
+    if(!_headless)
+        _renderSystem.init();
     _animationSystem.init();
     _cameraSystem.init();
-    _collisionSystem.init();
     _movementSystem.init();
+
+    // Same order the systems were updated in before the scheduler. The
+    // flocking and collision systems belong to the world, which inits them.
+    // The wings are animated slower than the simulation; the camera still
+    // moves every tick, as the render interpolates it between the ticks.
+    _scheduler.add(_animationSystem, AnimationRate);
+    _scheduler.add(_cameraSystem);
+    _scheduler.add(_world.getFlockingSystem());
+    _scheduler.add(_world.getCollisionSystem());
+    _scheduler.add(_movementSystem);
 }
 
-void Engine::initObjects() {
-    // Position the objective boid randomly in the center of the map.
-    float boidPosX = std::rand() % ((int) GroundSize) - GroundSize / 2;
-    float boidPosY = std::rand() % ((int)(MaximumHeight - MinimumHeight) / 2)
-        + MinimumHeight;
-    float boidPosZ = std::rand() % ((int) GroundSize) - GroundSize / 2;
-
-    // Do not position the boid in the tower.
-    if(std::abs(boidPosX) < TowerBaseRadius)
-        boidPosX += 2 * TowerBaseRadius;
-    if(std::abs(boidPosZ) < TowerBaseRadius)
-        boidPosZ += 2 * TowerBaseRadius;
-
-    // Create the position point.
-    Point objBoidPos = Point(boidPosX, boidPosY, boidPosZ);
-
-    // Random direction.
-    Vector objBoidDir = Vector((rand() % 1000) / 1000.0,
-            (rand() % 1000) / 1000.0,
-            (rand() % 1000) / 1000.0);
-
-    // Add the objective boid moving to the center of the map.
-    _objectiveBoid = new ObjectiveBoid(
-            getAnimationSystem().getRandomBoidDisplayList(),
-            getAnimationSystem().getRandomBoidGoingUp(),
-            objBoidPos, ObjectiveBoidInitialSpeed, objBoidDir);
-
-    // Add a boid.
-    addBoid();
-    addBoid();
+void Engine::initObjects(unsigned numBoids, unsigned long seed) {
+    // Place the objective boid and the follow boids.
+    _world.init(numBoids, seed);
+
+    // Animate the objective boids from random display lists.
+    for(size_t f = 0; f < _world.getNumFlocks(); ++f) {
+        RandomStream random(_world.getRandom(), AnimationStream, f, 0);
+        ObjectiveBoid &leader = _world.getFlock(f).leader;
+        leader.displayList =
+            getAnimationSystem().getRandomBoidDisplayList(random);
+        leader.displayListGoingUp =
+            getAnimationSystem().getRandomBoidGoingUp(random);
+    }
 
     // Add a tower.
     _tower = new Tower(getAnimationSystem().getTowerDisplayList());
@@ -109,54 +113,47 @@ void Engine::initObjects() {
 void Engine::terminateWindowSystem() {
     glfwDestroyWindow(_window);
     glfwTerminate();
+    _window = 0;
 }
 
 void Engine::terminateSystems() {
+    _scheduler.clear();
     _animationSystem.terminate();
     _cameraSystem.terminate();
-    _collisionSystem.terminate();
     _movementSystem.terminate();
-    _renderSystem.terminate();
+    if(!_headless)
+        _renderSystem.terminate();
 }
 
 void Engine::terminateObjects() {
-    // Remove the objective boid.
-    delete _objectiveBoid;
-    _objectiveBoid = 0;
-
     // Remove all the boids.
-    _boids.clear();
+    _world.terminate();
 
     // Delete the tower.
     delete _tower;
     _tower = 0;
 }
 
-void Engine::updateMiddlePosition() {
-    _middle.x = 0.0;
-    _middle.y = 0.0;
-    _middle.z = 0.0;
-
-    // Sum all the positions of the other boids.
-    for(Engine::BoidVector::iterator it = getEngine().getBoids().begin();
-            it != getEngine().getBoids().end(); ++it) {
-        _middle.x += it->getRelativePosition().x;
-        _middle.y += it->getRelativePosition().y;
-        _middle.z += it->getRelativePosition().z;
-    }
+void Engine::updateKeys() {
+    // The first key code is GLFW_KEY_SPACE. The codes below it are never
+    // pressed.
+    for(int key = 0; key <= GLFW_KEY_LAST; ++key)
+        _keys[key] = key >= GLFW_KEY_SPACE
+            && glfwGetKey(_window, key) == GLFW_PRESS;
+}
 
-    // Divide by the number of boids, getting the middle of the boids.
-    float size = _boids.size();
-    if(size) {
-        _middle.x /= size;
-        _middle.y /= size;
-        _middle.z /= size;
-    }
+void Engine::beginTick() {
+    _world.beginTick();
+    _world.setLodCenter(_cameraSystem.getCameraPosition());
+    _cameraSystem.savePreviousState();
+}
+
+void Engine::endTick() {
+    _world.endTick();
 }
 
 void Engine::mainLoop() {
     const double fpsTime = 100 / MaxFps; // Minimum time of a frame.
-    const double dt = 0.01; // Number of ms per update.
     double accumulator = 0.0;
     double current, after, sleep;
     double previous = glfwGetTime();
@@ -169,24 +166,22 @@ void Engine::mainLoop() {
         previous = current;
 
         // Clamp the accumulator if it is too big to avoid the spiral of death.
-        if(accumulator > 0.25)
-            accumulator = 0.25;
+        if(accumulator > MaxFrameTime)
+            accumulator = MaxFrameTime;
 
         // Process states.
         getStateManager().processStates();
 
         // Get input.
         getStateManager().getCurrentState().input();
+        updateKeys();
 
-        // Update the game simulation.
-        while(accumulator >= dt) {
-            getStateManager().getCurrentState().update(dt);
-            _elapsedTime += dt;
-            accumulator -= dt;
-        }
+        // Update the game simulation, in ticks as long as the world asks.
+        double dt = simulate(accumulator);
 
-        // Render.
-        getStateManager().getCurrentState().render(accumulator);
+        // Render between the last two ticks, as far as the time left in the
+        // accumulator.
+        getStateManager().getCurrentState().render(accumulator / dt);
 
         // Get the sleep time.
         after = glfwGetTime();
@@ -200,35 +195,122 @@ void Engine::mainLoop() {
     }
 }
 
-Engine::Engine()
-        : _window(0), _objectiveBoid(0), _tower(0) {
-    // Reserve space for the boids.
-    _boids.reserve(ReservedBoids);
+double Engine::simulate(double &accumulator) {
+    double dt = _world.getNextTickLength();
+    _numSubsteps = 0;
+    while(accumulator >= dt) {
+        beginTick();
+        getStateManager().getCurrentState().update(_world.getTickLength());
+        endTick();
+        _elapsedTime += dt;
+        accumulator -= dt;
+        ++_numSubsteps;
+        dt = _world.getNextTickLength();
+    }
+    return dt;
+}
 
-    // Init the rand() system.
-    std::srand(time(NULL));
+bool Engine::headlessLoop(const EngineOptions &options) {
+    const unsigned numTicks = options.numTicks;
+    const double frame = 1.0 / SimulationTickRate; // Seconds per frame.
+    double accumulator = 0.0;
+    _elapsedTime = 0.0; // Virtual time: advances by dt every tick.
+
+    getStateManager().processStates();
+
+    // No input and no render: the keys stay released, and the frames run as
+    // fast as they can. With fixed ticks, each frame is one tick.
+    unsigned substeps = 0, fewest = ~0u, most = 0;
+    double begin = wallTime();
+    for(unsigned tick = 0; tick < numTicks; ++tick) {
+        accumulator += frame;
+        simulate(accumulator);
+        substeps += _numSubsteps;
+        fewest = std::min(fewest, _numSubsteps);
+        most = std::max(most, _numSubsteps);
+    }
+    double seconds = wallTime() - begin;
+
+    std::cout << numTicks << " ticks of " << _world.getNumBoids()
+        << " boids in " << seconds << " s: "
+        << (seconds > 0.0 ? numTicks / seconds : 0.0)
+        << " ticks/s, " << _elapsedTime / (seconds > 0.0 ? seconds : 1.0)
+        << "x real time" << std::endl;
+    uint64_t checksum = _world.getChecksum();
+    std::cout << "state checksum " << std::hex << checksum << std::dec
+        << std::endl;
+    if(_world.getNumFlocks() > 1)
+        std::cout << _world.getNumFlocks() << " flocks, "
+            << getCollisionSystem().getNumFlockPairs()
+            << " pairs overlapping in the last tick" << std::endl;
+    if(_world.usesAdaptiveTicks())
+        std::cout << substeps << " adaptive ticks, " << fewest << " to "
+            << most << " per tick of " << frame << " s" << std::endl;
+    if(_world.getParameters().lodBudget)
+        std::cout << getFlockingSystem().getNumUpdated() << " of "
+            << _world.getNumBoids() << " boids flocked in the last tick"
+            << std::endl;
+    if(_world.usesNeighborList())
+        std::cout << _world.getNeighborList().getNumBuilds()
+            << " builds of the neighbor lists" << std::endl;
+
+    if(options.checkChecksum && checksum != options.expectedChecksum) {
+        std::cerr << "Error: expected the state checksum "
+            << std::hex << options.expectedChecksum << std::dec << std::endl;
+        return false;
+    }
+    return true;
+}
 
-    // Create the window.
-    initWindowSystem();
+Engine::Engine()
+        : _window(0), _headless(false), _numSubsteps(0), _tower(0),
+        _threadPool(1),
+        _world(_threadPool) {
+    // No key is pressed before the first input.
+    std::fill(_keys, _keys + GLFW_KEY_LAST + 1, false);
 }
 
 Engine::~Engine() {
-    // Terminate the window.
-    terminateWindowSystem();
+    // Terminate the window, if run() didn't.
+    if(_window)
+        terminateWindowSystem();
 }
 
-int Engine::run() {
+int Engine::run(const EngineOptions &options) {
+    // Start the threads of the simulation.
+    _threadPool.setNumThreads(options.numThreads);
+
+    // Create the window.
+    _headless = options.headless;
+    if(!_headless)
+        initWindowSystem();
+
     // Inits the systems.
     initSystems();
+    _scheduler.setRate(_animationSystem, options.animationRate);
 
     // Inits the objects.
-    initObjects();
+    _world.setNeighborSkin(options.neighborSkin);
+    _world.setTopologicalNeighbors(options.topologicalNeighbors);
+    _world.setReorderInterval(options.reorderInterval);
+    _world.setNumObstacles(options.numObstacles);
+    _world.setObstacleCache(options.obstacleCache);
+    _world.setNumFlocks(options.numFlocks);
+    _world.setOpeningAngle(options.openingAngle);
+    _world.setLodBudget(options.lodBudget);
+    if(options.adaptiveTicks)
+        _world.setTickLengths(options.minTickLength, options.maxTickLength);
+    initObjects(options.numBoids, options.seed);
 
     // Enter the run state.
     getStateManager().changeState(RunStateId);
 
     // Main loop of the engine.
-    mainLoop();
+    bool succeeded = true;
+    if(_headless)
+        succeeded = headlessLoop(options);
+    else
+        mainLoop();
 
     // Terminates the objects.
     terminateObjects();
@@ -236,120 +318,7 @@ int Engine::run() {
     // Terminates the systems.
     terminateSystems();
 
-    return 0;
-}
-
-void Engine::addBoid() {
-    const float boidSpace2 = 2 * BoidSpace;
-    const int objectiveVectors = 9; // Number of vectors that can be used with obj.
-    const int followVectors = 13; // Number of vectors that can be used with follow.
-    bool isObjectiveBoid = true;
-
-/*
-    Vector directions[] = {
-        // Used also by obj when inserting a new boid relative to
-        // obj (objectiveBoid).
-        Vector(-boidSpace2, -boidSpace2,    -boidSpace2),
-        Vector(0.0,         -boidSpace2,    -boidSpace2),
-        Vector(boidSpace2,  -boidSpace2,    -boidSpace2),
-        Vector(-boidSpace2, 0.0,            -boidSpace2),
-        Vector(0.0,         0.0,            -boidSpace2),
-        Vector(boidSpace2,  0.0,            -boidSpace2),
-        Vector(-boidSpace2, boidSpace2,     -boidSpace2),
-        Vector(0.0,         boidSpace2,     -boidSpace2),
-        Vector(boidSpace2,  boidSpace2,     -boidSpace2),
-
-        // Used when adding relative to other follow boids.
-        Vector(-boidSpace2, -boidSpace2,    0.0),
-        Vector(boidSpace2,  -boidSpace2,    0.0),
-        Vector(-boidSpace2, boidSpace2,     0.0),
-        Vector(boidSpace2,  boidSpace2,     0.0)
-    };
-*/
-    // Number of existing boids.
-    size_t num = _boids.size();
-
-    // Do this until we find a suitable place for the new boid.
-    for(;;) {
-        // Start with the objective boid.
-        const Boid *boid = &getEngine().getObjectiveBoid();
-        size_t numVectors = objectiveVectors;
-
-        // Choose a random existing boid if there is at least 1 follow boid.
-        // Else, stay with the objective boid.
-        if(num) {
-            size_t boidId = rand() % (num + 5);
-            if(boidId < num) {
-                boid = &_boids[boidId];
-                numVectors = followVectors;
-                isObjectiveBoid = false;
-            }
-        }
-
-        // Choose a random direction.
-        //size_t dir = rand() % numVectors;
-        Vector direction = Vector(rand() % 1000, rand() % 1000, rand() % 1000);
-        direction.normalize();
-        direction *= boidSpace2;
-
-        // Get the new position.
-        //Point pos = boid->getRelativePosition() + directions[dir];
-        Point pos;
-        if(isObjectiveBoid)
-            pos = boid->getRelativePosition() - direction - boid->direction * BoidSpace;
-        else
-            pos = boid->getRelativePosition() - direction;
-
-        // Check the distances to all the other boids. If we find a boid
-        // that is at a distance smaller tan boidSpace2 from pos, try again.
-        // It is guaranteed that in case the boid is the objective boid,
-        // no collision will happen.
-        bool boidFound = num ? false : true;
-        for(size_t i = 0; i < num; ++i) {
-            if(Point::distance(pos, _boids[i].getRelativePosition())
-                    > boidSpace2) {
-                boidFound = true;
-                break;
-            }
-        }
-        if(!boidFound)
-            continue;
-
-        // Add the new boid relative to boid.
-        // getRelativePosition() returns (0.0, 0.0, 0.0) if the boid is the
-        // objective boid.
-        _boids.push_back(FollowBoid(getAnimationSystem().getRandomBoidDisplayList(),
-                getAnimationSystem().getRandomBoidGoingUp(), pos,
-                boid->speed, boid->direction, boid->up));
-
-        break;
-    }
-
-    // Calculate the middle position again.
-    updateMiddlePosition();
-}
-
-void Engine::removeRandomBoid() {
-    // Do not remove if the boids vector is empty.
-    if(!_boids.size())
-        return;
-
-    // Get the size of the boid vector, generate a random number mod it.
-    // Remove the random boid.
-    size_t size = _boids.size();
-    size_t boidToRemove = rand() % size;
-
-    // Get the iterator position of the boid to remove.
-    BoidVector::iterator it = _boids.begin();
-    for(size_t i = 0; i != boidToRemove; ++i, ++it)
-        if(it == _boids.end() - 1) // Sanity check.
-            break;
-
-    // Remove the boid.
-    _boids.erase(it);
-
-    // Calculate the middle position again.
-    updateMiddlePosition();
+    return succeeded ? 0 : 1;
 }
 
 void Engine::errorEvent(int error, const char *description) {
@@ -29,17 +29,21 @@
 #define ENGINE_HPP
 
 #include <vector>
+#include "EngineOptions.hpp"
 #include "gameObject/ObjectiveBoid.hpp"
-#include "gameObject/FollowBoid.hpp"
+#include "gameObject/BoidStore.hpp"
 #include "gameObject/Tower.hpp"
+#include "spatial/SpatialGrid.hpp"
 #include "state/State.hpp"
 #include "state/StateManager.hpp"
 #include "system/System.hpp"
 #include "system/AnimationSystem.hpp"
 #include "system/CameraSystem.hpp"
-#include "system/CollisionSystem.hpp"
 #include "system/MovementSystem.hpp"
 #include "system/RenderSystem.hpp"
+#include "system/SystemScheduler.hpp"
+#include "util/ThreadPool.hpp"
+#include "World.hpp"
 #include "glfw.hpp"
 
 /**
@@ -50,36 +54,39 @@
  * @see getEngine()
  **/
 class Engine {
-
-public:
-    /// Vector of follow boids.
-    typedef std::vector<FollowBoid> BoidVector;
-
-private:
-    /// The window of the engine.
+    /// The window of the engine. Null when headless.
     GLFWwindow *_window;
 
+    /// If the engine runs without a window. See EngineOptions::headless.
+    bool _headless;
+
     /// The elapsed time since the mainLoop began, in seconds.
     double _elapsedTime;
 
+    /// Number of ticks the last frame was simulated in.
+    unsigned _numSubsteps;
+
     /// x position of the cursor.
     double _cursorXPos;
 
     /// y position of the cursor.
     double _cursorYPos;
 
-    /// The objective boid.
-    ObjectiveBoid *_objectiveBoid;
-
-    /// The boids.
-    std::vector<FollowBoid> _boids;
+    /**
+     * If each key was pressed when the input was last read. The systems read
+     * the keys from here instead of from glfw, which can only be used from
+     * the main thread.
+     **/
+    bool _keys[GLFW_KEY_LAST + 1];
 
     /// The center tower.
     Tower *_tower;
 
-    /// Point that represents the middle relative position of the follow boids.
-    /// This is 0 when there is no boid.
-    Point _middle;
+    /// Threads that run the loops of the systems over the boids.
+    ThreadPool _threadPool;
+
+    /// The boids and the systems that simulate them.
+    World _world;
 
     /// Animation system.
     AnimationSystem _animationSystem;
@@ -87,23 +94,27 @@ private:
     /// Camera system.
     CameraSystem _cameraSystem;
 
-    /// Collision system.
-    CollisionSystem _collisionSystem;
-
     /// Movement system.
     MovementSystem _movementSystem;
 
     /// Render system.
     RenderSystem _renderSystem;
 
+    /// Updates the systems of the simulation, except the render system.
+    SystemScheduler _scheduler;
+
     /// Inits the window system.
     void initWindowSystem();
 
     /// Inits the engine's systems.
     void initSystems();
 
-    /// Inits the objects. Must be init'ed after the systems.
-    void initObjects();
+    /**
+     * Inits the objects. Must be init'ed after the systems.
+     * @param numBoids Number of follow boids to add.
+     * @param seed Seed of the random numbers of the world.
+     **/
+    void initObjects(unsigned numBoids, unsigned long seed);
 
     /// Terminates the window system.
     void terminateWindowSystem();
@@ -114,14 +125,28 @@ private:
     /// Terminates the engine's systems.
     void terminateSystems();
 
-    /// Updates the middle position of the follow boids.
-    void updateMiddlePosition();
-
     /**
      * Main loop of the engine. Responsible for the frame-by-frame updates.
      **/
     void mainLoop();
 
+    /**
+     * Simulates the time in the accumulator, in ticks of the length the world
+     * asks for, until less than a tick is left in it.
+     * @return The length of the next tick.
+     **/
+    double simulate(double &accumulator);
+
+    /**
+     * Main loop of the engine when headless. Runs options.numTicks ticks
+     * of 1 / SimulationTickRate seconds back to back, on a virtual clock,
+     * and prints how long they took. With adaptive ticks, each of them is
+     * simulated in as many ticks as the world asks for.
+     * @return false if options.checkChecksum is set and the world didn't end
+     * with options.expectedChecksum.
+     **/
+    bool headlessLoop(const EngineOptions &options);
+
     /// Private constructor to make this class a singleton.
     Engine();
 
@@ -151,20 +176,25 @@ public:
      * Takes control of execution and runs the game until an interrupt signal
      * is given or the player asks to quit.
      * This function takes care of initing the engine and terminating it.
+     * @param options The options given in the command line.
      * @return 0 on success or nonzero on error. This allows the run
      * function to be used in main()'s return statement.'
      **/
-    int run();
+    int run(const EngineOptions &options);
 
     /**
      * Adds a new boid to the flock at a random position near it.
      **/
-    void addBoid();
+    inline void addBoid() {
+        _world.addBoid();
+    }
 
     /**
      * Removes a random boid.
      **/
-    void removeRandomBoid();
+    inline void removeRandomBoid() {
+        _world.removeRandomBoid();
+    }
 
     /**
      * Error event to be generated by anyone, but mainly by glfw.
@@ -177,16 +207,14 @@ public:
      * Returns the middle relative position of the following boids.
      **/
     Point getMiddlePosition() {
-        return _middle;
+        return _world.getMiddlePosition();
     }
 
     /**
      * Returns the middle absolute position of the following boids.
      **/
     Point getAbsoluteMiddlePosition() {
-        return Point(_objectiveBoid->position.x + _middle.x,
-                _objectiveBoid->position.y + _middle.y,
-                _objectiveBoid->position.z + _middle.z);
+        return _world.getAbsoluteMiddlePosition();
     }
 
     /**
@@ -207,6 +235,30 @@ public:
         _cursorYPos = ypos;
     }
 
+    /**
+     * Reads the state of every key from the window.
+     * Called once per frame, after the input of the current state.
+     **/
+    void updateKeys();
+
+    /**
+     * Starts a new tick of the world and saves the state of the camera as the
+     * one of the previous tick, so the render can interpolate between the
+     * last two ticks. Called before each tick.
+     **/
+    void beginTick();
+
+    /// Ends the tick of the world. Called after each tick.
+    void endTick();
+
+    /**
+     * Returns if the key was pressed when the input was last read.
+     * Unlike glfwGetKey(), this can be called from any thread.
+     **/
+    inline bool isKeyPressed(int key) const {
+        return key >= 0 && key <= GLFW_KEY_LAST && _keys[key];
+    }
+
     /**
      * Returns the elapsed time since the mainLoop started, in seconds.
      **/
@@ -214,6 +266,14 @@ public:
         return _elapsedTime;
     }
 
+    /**
+     * Returns the number of ticks the last frame was simulated in. With
+     * adaptive ticks, it follows the speed of the boids.
+     **/
+    inline unsigned getNumSubsteps() const {
+        return _numSubsteps;
+    }
+
     /**
      * Returns the state manager of the engine.
      **/
@@ -228,18 +288,40 @@ public:
         return _window;
     }
 
+    /**
+     * Returns if the engine runs without a window, OpenGL or input.
+     **/
+    inline bool isHeadless() const {
+        return _headless;
+    }
+
     /**
      * Returns the objective boid.
      **/
     inline ObjectiveBoid &getObjectiveBoid() {
-        return *_objectiveBoid;
+        return _world.getObjectiveBoid();
+    }
+
+    /**
+     * Returns the store of follow boids.
+     **/
+    inline BoidStore &getBoids() {
+        return _world.getBoids();
+    }
+
+    /**
+     * Returns the grid with the follow boids.
+     * @see World::updateGrid()
+     **/
+    inline SpatialGrid &getGrid() {
+        return _world.getGrid();
     }
 
     /**
-     * Returns the vector of boids.
+     * Returns the world of the engine.
      **/
-    inline BoidVector &getBoids() {
-        return _boids;
+    inline World &getWorld() {
+        return _world;
     }
 
     /**
@@ -249,6 +331,20 @@ public:
         return *_tower;
     }
 
+    /**
+     * Returns the thread pool of the systems.
+     **/
+    inline ThreadPool &getThreadPool() {
+        return _threadPool;
+    }
+
+    /**
+     * Returns the scheduler of the systems of the simulation.
+     **/
+    inline SystemScheduler &getScheduler() {
+        return _scheduler;
+    }
+
     /**
      * Returns the animation system.
      **/
@@ -267,7 +363,14 @@ public:
      * Returns the collision system.
      **/
     inline CollisionSystem &getCollisionSystem() {
-        return _collisionSystem;
+        return _world.getCollisionSystem();
+    }
+
+    /**
+     * Returns the flocking system.
+     **/
+    inline FlockingSystem &getFlockingSystem() {
+        return _world.getFlockingSystem();
     }
 
     /**
@@ -0,0 +1,240 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "EngineOptions.hpp"
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace {
+    /// Parses a number that fits in T, returning false if it isn't one.
+    template<typename T>
+    bool parseUnsigned(const char *arg, T &value) {
+        // strtoul() takes a sign and wraps negative numbers around.
+        if(*arg < '0' || *arg > '9')
+            return false;
+
+        char *end;
+        errno = 0;
+        unsigned long number = std::strtoul(arg, &end, 10);
+        if(*end || errno == ERANGE
+                || number > std::numeric_limits<T>::max())
+            return false;
+
+        value = number;
+        return true;
+    }
+
+    /// Parses a checksum in hexadecimal, returning false if it isn't one.
+    bool parseChecksum(const char *arg, uint64_t &value) {
+        if(!std::isxdigit((unsigned char) *arg))
+            return false;
+
+        char *end;
+        errno = 0;
+        unsigned long long number = std::strtoull(arg, &end, 16);
+        if(*end || errno == ERANGE)
+            return false;
+
+        value = number;
+        return true;
+    }
+
+    /// Parses a finite number that isn't negative, returning false if it
+    /// isn't one.
+    bool parseDistance(const char *arg, float &value) {
+        char *end;
+        double number = std::strtod(arg, &end);
+        // strtod() takes "nan" and "inf" too, which fail both comparisons.
+        if(!*arg || *end || !(number >= 0.0)
+                || !(number <= std::numeric_limits<float>::max()))
+            return false;
+
+        value = number;
+        return true;
+    }
+}
+
+bool parseEngineOptions(int argc, char **argv, EngineOptions &options) {
+    for(int i = 1; i < argc; ++i) {
+        if((!std::strcmp(argv[i], "-j") || !std::strcmp(argv[i], "--threads"))
+                && i + 1 < argc) {
+            if(!parseUnsigned(argv[++i], options.numThreads))
+                return false;
+        }
+        else if(!std::strcmp(argv[i], "--headless")) {
+            options.headless = true;
+        }
+        else if(!std::strcmp(argv[i], "--ticks") && i + 1 < argc) {
+            if(!parseUnsigned(argv[++i], options.numTicks))
+                return false;
+        }
+        else if(!std::strcmp(argv[i], "--boids") && i + 1 < argc) {
+            if(!parseUnsigned(argv[++i], options.numBoids))
+                return false;
+        }
+        else if(!std::strcmp(argv[i], "--seed") && i + 1 < argc) {
+            if(!parseUnsigned(argv[++i], options.seed))
+                return false;
+        }
+        else if(!std::strcmp(argv[i], "--skin") && i + 1 < argc) {
+            if(!parseDistance(argv[++i], options.neighborSkin))
+                return false;
+        }
+        else if(!std::strcmp(argv[i], "--nearest") && i + 1 < argc) {
+            if(!parseUnsigned(argv[++i], options.topologicalNeighbors))
+                return false;
+        }
+        else if(!std::strcmp(argv[i], "--reorder") && i + 1 < argc) {
+            if(!parseUnsigned(argv[++i], options.reorderInterval))
+                return false;
+        }
+        else if(!std::strcmp(argv[i], "--obstacles") && i + 1 < argc) {
+            if(!parseUnsigned(argv[++i], options.numObstacles))
+                return false;
+        }
+        else if(!std::strcmp(argv[i], "--obstacle-cache") && i + 1 < argc) {
+            options.obstacleCache = argv[++i];
+        }
+        else if(!std::strcmp(argv[i], "--flocks") && i + 1 < argc) {
+            if(!parseUnsigned(argv[++i], options.numFlocks)
+                    || !options.numFlocks)
+                return false;
+        }
+        else if(!std::strcmp(argv[i], "--far-cohesion") && i + 1 < argc) {
+            if(!parseDistance(argv[++i], options.openingAngle))
+                return false;
+        }
+        else if(!std::strcmp(argv[i], "--lod") && i + 1 < argc) {
+            if(!parseUnsigned(argv[++i], options.lodBudget))
+                return false;
+        }
+        else if(!std::strcmp(argv[i], "--animation-rate") && i + 1 < argc) {
+            if(!parseUnsigned(argv[++i], options.animationRate))
+                return false;
+        }
+        else if(!std::strcmp(argv[i], "--adaptive")) {
+            options.adaptiveTicks = true;
+        }
+        else if(!std::strcmp(argv[i], "--min-dt") && i + 1 < argc) {
+            if(!parseDistance(argv[++i], options.minTickLength))
+                return false;
+        }
+        else if(!std::strcmp(argv[i], "--max-dt") && i + 1 < argc) {
+            if(!parseDistance(argv[++i], options.maxTickLength))
+                return false;
+        }
+        else if(!std::strcmp(argv[i], "--expect") && i + 1 < argc) {
+            if(!parseChecksum(argv[++i], options.expectedChecksum))
+                return false;
+            options.checkChecksum = true;
+        }
+        else {
+            return false;
+        }
+    }
+
+    // A tick longer than a frame would never fit in the accumulator of the
+    // main loop, and a tick of no time would never fill it.
+    return options.minTickLength > 0.0
+        && options.minTickLength <= options.maxTickLength
+        && options.maxTickLength <= MaxFrameTime;
+}
+
+void printEngineUsage(const char *program) {
+    std::cerr << "Usage: " << program
+        << " [-j threads] [--boids n] [--seed n] [--skin x]" << std::endl
+        << "       [--nearest k] [--reorder n] [--obstacles n]"
+        << " [--obstacle-cache file]" << std::endl
+        << "       [--flocks n] [--far-cohesion theta] [--lod n]"
+        << " [--animation-rate hz]" << std::endl
+        << "       [--adaptive [--min-dt s] [--max-dt s]]" << std::endl
+        << "       [--headless [--ticks n] [--expect checksum]]" << std::endl
+        << "  -j, --threads n  Simulate with n threads (default: one per "
+        << "hardware thread)." << std::endl
+        << "  --boids n        Start with n follow boids (default: 2)."
+        << std::endl
+        << "  --seed n         Seed of the random numbers (default: the "
+        << "current time)." << std::endl
+        << "  --skin x         Use neighbor lists with a skin of x, rebuilt "
+        << "only when the" << std::endl
+        << "                   boids move more than it (default: 0, no "
+        << "lists)." << std::endl
+        << "  --nearest k      Flock with the k nearest boids instead of "
+        << "the ones inside" << std::endl
+        << "                   the neighbor radius (default: 0, the "
+        << "radius)." << std::endl
+        << "  --reorder n      Reorder the boids in memory every n ticks "
+        << "(default: " << BoidReorderInterval << "," << std::endl
+        << "                   0 never)." << std::endl
+        << "  --obstacles n    Place n obstacles on the ground besides the "
+        << "tower (default: 0)." << std::endl
+        << "  --obstacle-cache file" << std::endl
+        << "                   Keep the distance field of the obstacles in "
+        << "file (default:" << std::endl
+        << "                   " << ObstacleCacheFile << ", empty bakes it "
+        << "every time)." << std::endl
+        << "  --flocks n       Split the boids between n flocks, each with "
+        << "its own leader" << std::endl
+        << "                   (default: 1)." << std::endl
+        << "  --far-cohesion theta" << std::endl
+        << "                   Pull the boids towards their whole flock too, "
+        << "with an octree" << std::endl
+        << "                   of opening angle theta (default: 0, off; 0.6 "
+        << "is a good one)." << std::endl
+        << "  --lod n          Flock the boids far from the camera less often, "
+        << "about n boids" << std::endl
+        << "                   per tick (default: 0, all of them every tick)."
+        << std::endl
+        << "  --animation-rate hz" << std::endl
+        << "                   Animate the wings hz times per second "
+        << "(default: " << AnimationRate << ", 0 every" << std::endl
+        << "                   tick)." << std::endl
+        << "  --adaptive       Tick faster when the boids fly faster, so they "
+        << "never fly" << std::endl
+        << "                   through each other, and slower when they are "
+        << "calm." << std::endl
+        << "  --min-dt s       Shortest adaptive tick, in seconds (default: "
+        << AdaptiveMinTickLength << ")." << std::endl
+        << "  --max-dt s       Longest adaptive tick, in seconds (default: "
+        << AdaptiveMaxTickLength << "," << std::endl
+        << "                   at most " << MaxFrameTime << ")." << std::endl
+        << "  --headless       Simulate without a window, as fast as possible, "
+        << "and print" << std::endl
+        << "                   the throughput." << std::endl
+        << "  --ticks n        Number of ticks of 1 / " << SimulationTickRate
+        << " s to simulate when headless" << std::endl
+        << "                   (default: 1000), split in substeps when "
+        << "adaptive." << std::endl
+        << "  --expect checksum" << std::endl
+        << "                   Fail when headless if the state checksum at "
+        << "the end isn't" << std::endl
+        << "                   checksum, in hexadecimal." << std::endl;
+}
@@ -0,0 +1,151 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ENGINEOPTIONS_HPP
+#define ENGINEOPTIONS_HPP
+
+#include "defs.hpp"
+#include <ctime>
+#include <stdint.h>
+#include <string>
+
+/**
+ * Options of the engine, given in the command line.
+ **/
+struct EngineOptions {
+    /**
+     * Number of threads of the simulation, including the main thread. 0 uses
+     * one thread per hardware thread.
+     **/
+    unsigned numThreads;
+
+    /**
+     * If the engine runs without a window: no OpenGL, no input, no render and
+     * a virtual clock that advances one tick at a time, as fast as it can.
+     **/
+    bool headless;
+
+    /**
+     * Number of ticks of 1 / SimulationTickRate seconds to simulate when
+     * headless. With adaptive ticks, they are the frames the ticks fill.
+     **/
+    unsigned numTicks;
+
+    /// Number of follow boids at the start.
+    unsigned numBoids;
+
+    /**
+     * Seed of the random numbers of the simulation. The same seed gives the
+     * same simulation, with any number of threads.
+     **/
+    unsigned long seed;
+
+    /**
+     * Skin of the neighbor lists (see NeighborList), or 0 to query the grid
+     * every tick instead.
+     **/
+    float neighborSkin;
+
+    /**
+     * Number of nearest boids that are flockmates, or 0 to use the boids
+     * inside the neighbor radius instead.
+     **/
+    unsigned topologicalNeighbors;
+
+    /**
+     * Number of ticks between two reorders of the boids in memory, or 0 to
+     * never reorder them.
+     **/
+    unsigned reorderInterval;
+
+    /// Number of static obstacles besides the tower.
+    unsigned numObstacles;
+
+    /// File where the distance field of the obstacles is kept between runs.
+    std::string obstacleCache;
+
+    /**
+     * Number of flocks the follow boids are split between. The first one
+     * follows the objective boid of the input, the others fly by themselves.
+     **/
+    unsigned numFlocks;
+
+    /**
+     * Opening angle of the octree of the far cohesion, or 0 to leave the far
+     * cohesion out.
+     **/
+    float openingAngle;
+
+    /**
+     * Number of boids flocked per tick with the level of detail centered on
+     * the camera, or 0 to flock all of them every tick.
+     **/
+    unsigned lodBudget;
+
+    /// Updates per second of the animation system, or 0 for every tick.
+    unsigned animationRate;
+
+    /// If the length of the ticks adapts to the speed of the boids.
+    bool adaptiveTicks;
+
+    /// Shortest and longest tick, in seconds, with adaptive ticks.
+    float minTickLength, maxTickLength;
+
+    /**
+     * Checksum the world must end with when headless, see
+     * World::getChecksum(). Only checked if checkChecksum is true.
+     **/
+    uint64_t expectedChecksum;
+
+    /// If the headless run fails when it doesn't end with expectedChecksum.
+    bool checkChecksum;
+
+    EngineOptions() : numThreads(0), headless(false), numTicks(1000),
+            numBoids(2), seed(std::time(NULL)), neighborSkin(0.0),
+            topologicalNeighbors(0), reorderInterval(BoidReorderInterval),
+            numObstacles(0), obstacleCache(ObstacleCacheFile),
+            numFlocks(1), openingAngle(0.0), lodBudget(0),
+            animationRate(AnimationRate), adaptiveTicks(false),
+            minTickLength(AdaptiveMinTickLength),
+            maxTickLength(AdaptiveMaxTickLength), expectedChecksum(0),
+            checkChecksum(false) {
+
+    }
+};
+
+/**
+ * Parses the command line into the options.
+ * @return false if the command line is invalid.
+ **/
+bool parseEngineOptions(int argc, char **argv, EngineOptions &options);
+
+/**
+ * Prints the usage of the program to std::cerr.
+ **/
+void printEngineUsage(const char *program);
+
+#endif // !ENGINEOPTIONS_HPP
@@ -0,0 +1,529 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "World.hpp"
+#include "math/math.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace {
+    /// Starting value of the FNV-1a hash.
+    const uint64_t FnvOffsetBasis = 14695981039346656037ull;
+
+    /// Multiplier of the FNV-1a hash.
+    const uint64_t FnvPrime = 1099511628211ull;
+
+    /// Adds the bytes of the data to the FNV-1a hash and returns it.
+    uint64_t hashBytes(uint64_t hash, const void *data, size_t size) {
+        const unsigned char *bytes = (const unsigned char *) data;
+        for(size_t i = 0; i < size; ++i)
+            hash = (hash ^ bytes[i]) * FnvPrime;
+        return hash;
+    }
+}
+
+World::World(ThreadPool &pool, const WorldParameters &parameters)
+        : _parameters(parameters), _pool(pool), _tick(0),
+        _tickLength(1.0 / parameters.tickRate), _added(0), _removed(0),
+        _flockingSystem(*this), _collisionSystem(*this) {
+    // The main flock always exists. Reserve space for its boids.
+    _flocks.push_back(new Flock(parameters.neighborRadius,
+                parameters.boidSpace, parameters.neighborSkin));
+    _flocks[0]->boids.reserve(ReservedBoids);
+}
+
+World::~World() {
+    for(size_t f = 0; f < _flocks.size(); ++f)
+        delete _flocks[f];
+}
+
+void World::placeLeader(unsigned f) {
+    RandomStream random(_random, ObjectiveBoidStream, f, 0);
+
+    // Position the objective boid randomly in the center of the map.
+    float boidPosX = random.next() % ((int) GroundSize) - GroundSize / 2;
+    float boidPosY = random.next()
+        % ((int)(MaximumHeight - MinimumHeight) / 2) + MinimumHeight;
+    float boidPosZ = random.next() % ((int) GroundSize) - GroundSize / 2;
+
+    // Do not position the boid in the tower.
+    if(std::abs(boidPosX) < TowerBaseRadius)
+        boidPosX += 2 * TowerBaseRadius;
+    if(std::abs(boidPosZ) < TowerBaseRadius)
+        boidPosZ += 2 * TowerBaseRadius;
+
+    // Create the position point.
+    Point objBoidPos = Point(boidPosX, boidPosY, boidPosZ);
+
+    // Random direction.
+    Vector objBoidDir = Vector(random.nextFloat(), random.nextFloat(),
+            random.nextFloat());
+
+    // Add the objective boid moving to the center of the map.
+    _flocks[f]->leader = ObjectiveBoid(0, true, objBoidPos,
+            ObjectiveBoidInitialSpeed, objBoidDir);
+    if(f)
+        chooseWaypoint(f);
+}
+
+void World::chooseWaypoint(unsigned f) {
+    // Anywhere over the ground, between the heights the boids fly at.
+    RandomStream random(_random, WaypointStream, f, _tick);
+    float limit = GroundSize / 2 - TowerBaseRadius;
+    _flocks[f]->waypoint = Point((2 * random.nextFloat() - 1) * limit,
+            MinimumHeight + random.nextFloat()
+                * (MaximumHeight - MinimumHeight),
+            (2 * random.nextFloat() - 1) * limit);
+}
+
+void World::init(unsigned numBoids, unsigned long seed) {
+    _random.setSeed(seed);
+    _tick = 0;
+    _tickLength = 1.0 / _parameters.tickRate;
+    _added = 0;
+    _removed = 0;
+
+    // Keep the main flock, with the space reserved for its boids.
+    unsigned numFlocks = std::max(_parameters.numFlocks, 1u);
+    for(size_t f = numFlocks; f < _flocks.size(); ++f)
+        delete _flocks[f];
+    _flocks.resize(std::min<size_t>(_flocks.size(), numFlocks));
+    while(_flocks.size() < numFlocks)
+        _flocks.push_back(new Flock(_parameters.neighborRadius,
+                    _parameters.boidSpace, _parameters.neighborSkin));
+
+    for(unsigned f = 0; f < numFlocks; ++f)
+        placeLeader(f);
+    _lodCenter = _flocks[0]->leader.getAbsolutePosition();
+
+    placeObstacles();
+
+    // Init the systems.
+    _flockingSystem.init();
+    _collisionSystem.init();
+
+    // Add the follow boids, the first flocks taking the ones left over.
+    for(unsigned f = 0; f < numFlocks; ++f) {
+        Flock &flock = *_flocks[f];
+        flock.boids.clear();
+        flock.stats.clear();
+        addBoids(numBoids / numFlocks + (f < numBoids % numFlocks), f);
+    }
+    updateGrid();
+}
+
+void World::terminate() {
+    _collisionSystem.terminate();
+    _flockingSystem.terminate();
+
+    // Remove all the boids.
+    for(size_t f = 0; f < _flocks.size(); ++f) {
+        Flock &flock = *_flocks[f];
+        flock.boids.clear();
+        flock.stats.clear();
+        flock.updateMiddlePosition();
+    }
+    updateGrid();
+}
+
+void World::beginTick() {
+    // The follow boids keep their previous state by swapping their buffers.
+    for(size_t f = 0; f < _flocks.size(); ++f)
+        _flocks[f]->leader.savePreviousState();
+    _tickLength = getNextTickLength();
+    ++_tick;
+
+    // Every few ticks, before the systems build their structures over the
+    // indices of the boids.
+    unsigned interval = _parameters.reorderInterval;
+    if(interval && _tick % interval == 0)
+        reorderBoids();
+}
+
+void World::reorderBoids() {
+    // The cells of the grid, so the boids follow the order of the grid.
+    for(size_t f = 0; f < _flocks.size(); ++f) {
+        Flock &flock = *_flocks[f];
+        _mortonOrder.sort(flock.boids.px(), flock.boids.py(),
+                flock.boids.pz(), flock.boids.size(),
+                flock.grid.getCellSize(), _pool);
+        flock.boids.permute(_mortonOrder.getOrder());
+    }
+}
+
+void World::step() {
+    beginTick();
+    float dt = getTickLength();
+
+    _flockingSystem.update(dt);
+    _collisionSystem.update(dt);
+    moveObjectiveBoid(dt);
+    moveLeaders(dt);
+
+    endTick();
+}
+
+float World::getNextTickLength() const {
+    if(!usesAdaptiveTicks())
+        return 1.0 / _parameters.tickRate;
+
+    float maxSpeed = getMaxSpeed();
+    float length = maxSpeed > 0.0f
+        ? AdaptiveCourantNumber * _parameters.boidSpace / maxSpeed
+        : _parameters.maxTickLength;
+    return std::max(_parameters.minTickLength,
+            std::min(length, _parameters.maxTickLength));
+}
+
+float World::getMaxSpeed() const {
+    float maxSpeed = 0.0;
+    for(size_t f = 0; f < _flocks.size(); ++f)
+        maxSpeed = std::max(maxSpeed, std::max(_flocks[f]->leader.speed,
+                    _flocks[f]->stats.getMaxSpeed()));
+    return maxSpeed;
+}
+
+void World::endTick() {
+    for(size_t f = 0; f < _flocks.size(); ++f)
+        _flocks[f]->boids.endTick();
+}
+
+void World::moveObjectiveBoid(float dt) {
+    ObjectiveBoid &objective = _flocks[0]->leader;
+    objective.position += objective.direction * objective.speed * dt;
+}
+
+void World::moveLeaders(float dt) {
+    const Vector vertical(0.0, 1.0, 0.0);
+    float turn = std::min(LeaderTurnRate * dt, 1.0f);
+
+    for(unsigned f = 1; f < _flocks.size(); ++f) {
+        ObjectiveBoid &leader = _flocks[f]->leader;
+        Vector toWaypoint = _flocks[f]->waypoint - leader.position;
+        if(toWaypoint.module() < LeaderWaypointReach) {
+            chooseWaypoint(f);
+            toWaypoint = _flocks[f]->waypoint - leader.position;
+        }
+
+        // Turn a bit towards the waypoint, keeping the wings level.
+        toWaypoint.normalize();
+        leader.direction += (toWaypoint - leader.direction) * turn;
+        leader.direction.normalize();
+        Vector right = Vector::cross(leader.direction, vertical);
+        if(right.module() > 0.0) {
+            leader.right = right.normalize();
+            leader.up = Vector::cross(leader.right, leader.direction);
+            leader.up.normalize();
+        }
+
+        leader.position += leader.direction * leader.speed * dt;
+    }
+}
+
+size_t World::addBoids(size_t n, size_t f) {
+    const float boidSpace2 = 2 * _parameters.boidSpace;
+    Flock &flock = *_flocks[f];
+    const ObjectiveBoid &objective = flock.leader;
+    BoidStore &boids = flock.boids;
+    size_t num = boids.size();
+
+    // Grow geometrically, so adding a boid at a time doesn't reallocate the
+    // arrays every few boids.
+    if(num + n > boids.capacity())
+        boids.reserve(std::max(num + n, 2 * boids.capacity()));
+
+    // Numbers of this addition.
+    RandomStream random(_random, SpawnStream, _added++, _tick);
+
+    // Point 0 is the objective boid, and point i + 1 the follow boid i. No
+    // boid moves or leaves until the next tick, or the version of the boids
+    // changes, so until then the boids added one at a time only insert
+    // themselves in the grid of the previous additions.
+    PlacementGrid &grid = flock.placement;
+    std::vector<unsigned> &active = flock.placementActive;
+    if(flock.placementTick != _tick
+            || flock.placementVersion != boids.getVersion()
+            || grid.size() != num + 1) {
+        grid.clear(boidSpace2, num + n + 1);
+        grid.insert(objective.getAbsolutePosition());
+        for(size_t i = 0; i < num; ++i)
+            grid.insert(boids[i].getPosition());
+
+        // Points that may still have space for a new boid around them.
+        active.resize(num + 1);
+        for(size_t i = 0; i <= num; ++i)
+            active[i] = i;
+    }
+
+    size_t added = 0;
+    while(added < n && !active.empty()) {
+        // Choose a random point, and fly like its boid.
+        size_t a = random.next() % active.size();
+        unsigned point = active[a];
+        Point position = grid.getPoint(point);
+        Vector velocity = point ? boids[point - 1].getVelocity()
+            : objective.direction * objective.speed;
+
+        bool placed = false;
+        for(int attempt = 0; attempt < NewBoidAttempts && !placed;
+                ++attempt) {
+            // Choose a random direction behind the objective boid: a random
+            // point of the unit ball, normalized. Unlike std::cos() and
+            // std::sin(), this gives the same bits with any math library.
+            // The points near the center are rejected too, as they have
+            // few bits of direction left in fixed point.
+            Vector direction;
+            Scalar length2;
+            do {
+                direction = Vector(2 * random.nextFloat() - 1,
+                        2 * random.nextFloat() - 1,
+                        2 * random.nextFloat() - 1);
+                length2 = Vector::dot(direction, direction);
+            } while(length2 > 1 || length2 < Scalar(0.01f));
+            direction.normalize();
+            if(Vector::dot(direction, objective.direction) > 0)
+                direction *= -1;
+
+            // Try a position between boidSpace2 and 2 * boidSpace2 from it.
+            Point candidate = position
+                + direction * (boidSpace2 * (1 + random.nextFloat()));
+            if(!grid.isFree(candidate))
+                continue;
+
+            grid.insert(candidate);
+            active.push_back(num + added + 1);
+            boids.add(candidate, velocity, random.next() % WingCycle);
+            flock.stats.add(candidate, velocity);
+            ++added;
+            placed = true;
+        }
+
+        // No space left around the point.
+        if(!placed) {
+            active[a] = active.back();
+            active.pop_back();
+        }
+    }
+
+    flock.placementTick = _tick;
+    flock.placementVersion = boids.getVersion();
+
+    // Calculate the middle position again.
+    flock.updateMiddlePosition();
+
+    return added;
+}
+
+void World::removeRandomBoid() {
+    Flock &flock = *_flocks[0];
+    BoidStore &boids = flock.boids;
+
+    // Do not remove if the boids vector is empty.
+    if(!boids.size())
+        return;
+
+    // Get the size of the boid vector, generate a random number mod it.
+    // Remove the random boid.
+    size_t size = boids.size();
+    size_t boidToRemove = _random.get(RemoveStream, _removed++, _tick)
+        % size;
+
+    // Remove the boid.
+    flock.stats.remove(boids[boidToRemove].getPosition(),
+            boids[boidToRemove].getVelocity());
+    boids.removeAt(boidToRemove);
+
+    // The last boid moved to its index, so the grid is wrong until the next
+    // tick rebuilds it, before anything queries it.
+
+    // Calculate the middle position again.
+    flock.updateMiddlePosition();
+}
+
+size_t World::removeBoids(size_t n) {
+    size_t size = _flocks[0]->boids.size();
+    std::vector<unsigned char> marked(size, n >= size);
+
+    // Choose n different boids with a partial Fisher-Yates shuffle.
+    if(n < size) {
+        RandomStream random(_random, RemoveStream, _removed++, _tick);
+        std::vector<unsigned> indices(size);
+        for(size_t i = 0; i < size; ++i)
+            indices[i] = i;
+
+        for(size_t k = 0; k < n; ++k) {
+            std::swap(indices[k], indices[k + random.next() % (size - k)]);
+            marked[indices[k]] = 1;
+        }
+    }
+
+    return removeMarkedBoids(marked);
+}
+
+size_t World::removeMarkedBoids(const std::vector<unsigned char> &marked) {
+    Flock &flock = *_flocks[0];
+    BoidStore &boids = flock.boids;
+    if(marked.empty() || marked.size() != boids.size())
+        return 0;
+
+    for(size_t i = 0; i < marked.size(); ++i)
+        if(marked[i])
+            flock.stats.remove(boids[i].getPosition(),
+                    boids[i].getVelocity());
+
+    size_t removed = boids.removeMarked(&marked[0]);
+
+    // The boids moved to other indices, so the grid is wrong until the next
+    // tick rebuilds it.
+
+    // Calculate the middle position again.
+    flock.updateMiddlePosition();
+
+    return removed;
+}
+
+void World::updateGrid(Flock &flock) {
+    const BoidStore &boids = flock.boids;
+    flock.grid.setPoints(boids.px(), boids.py(), boids.pz(), boids.size());
+    flock.grid.rebuild();
+}
+
+void World::updateGrid() {
+    for(size_t f = 0; f < _flocks.size(); ++f)
+        updateGrid(*_flocks[f]);
+}
+
+bool World::updateNeighborList() {
+    // The collision system uses the lists after the boids move in the tick.
+    float margin = BoidMaxSpeed * getTickLength();
+    bool rebuilt = false;
+    for(size_t f = 0; f < _flocks.size(); ++f) {
+        Flock &flock = *_flocks[f];
+        if(!flock.neighborList.needsRebuild(flock.boids, margin, _pool))
+            continue;
+
+        updateGrid(flock);
+        flock.neighborList.build(flock.grid, flock.boids, _pool);
+        rebuilt = true;
+    }
+    return rebuilt;
+}
+
+void World::updateKdTree() {
+    for(size_t f = 0; f < _flocks.size(); ++f) {
+        Flock &flock = *_flocks[f];
+        flock.kdTree.build(flock.boids.px(), flock.boids.py(),
+                flock.boids.pz(), flock.boids.size(), _pool);
+        flock.kdTree.findAllNearest(_parameters.topologicalNeighbors, _pool);
+    }
+}
+
+void World::updateOctree() {
+    for(size_t f = 0; f < _flocks.size(); ++f) {
+        Flock &flock = *_flocks[f];
+        flock.octree.build(flock.boids.px(), flock.boids.py(),
+                flock.boids.pz(), flock.boids.size(), _pool);
+        flock.octree.findCentroids(_parameters.openingAngle,
+                FarCohesionSoftening, _pool);
+    }
+}
+
+void World::setNeighborSkin(float skin) {
+    _parameters.neighborSkin = skin;
+    for(size_t f = 0; f < _flocks.size(); ++f)
+        _flocks[f]->neighborList.setRadius(
+                std::max(_parameters.neighborRadius, _parameters.boidSpace),
+                skin);
+}
+
+void World::updateStats() {
+    for(size_t f = 0; f < _flocks.size(); ++f) {
+        Flock &flock = *_flocks[f];
+        flock.stats.update(flock.boids, _pool);
+        flock.updateMiddlePosition();
+    }
+}
+
+void World::placeObstacles() {
+    _obstacles.clear();
+    for(unsigned o = 0; o < _parameters.numObstacles; ++o) {
+        RandomStream random(_random, ObstacleStream, o, 0);
+        Obstacle obstacle;
+        obstacle.shape = random.next() % 2 ? Obstacle::PillarShape
+            : Obstacle::ConeShape;
+        obstacle.radius = ObstacleMinRadius
+            + random.nextFloat() * (ObstacleMaxRadius - ObstacleMinRadius);
+        obstacle.height = ObstacleMinHeight
+            + random.nextFloat() * (ObstacleMaxHeight - ObstacleMinHeight);
+
+        // Anywhere on the ground, but away from the tower.
+        float limit = GroundSize / 2 - obstacle.radius;
+        float free = TowerBaseRadius + obstacle.radius + ObstacleClearance;
+        do {
+            obstacle.x = (2 * random.nextFloat() - 1) * limit;
+            obstacle.z = (2 * random.nextFloat() - 1) * limit;
+        } while(obstacle.x * obstacle.x + obstacle.z * obstacle.z
+                < free * free);
+
+        _obstacles.add(obstacle);
+    }
+
+    // The cache is only read if it has the same obstacles.
+    bool cached = !_obstacles.empty() && !_obstacleCache.empty();
+    if(!cached || !_obstacles.load(_obstacleCache)) {
+        _obstacles.bake(_pool);
+        if(cached)
+            _obstacles.save(_obstacleCache);
+    }
+}
+
+size_t World::getNumBoids() const {
+    size_t numBoids = 0;
+    for(size_t f = 0; f < _flocks.size(); ++f)
+        numBoids += _flocks[f]->boids.size();
+    return numBoids;
+}
+
+uint64_t World::getChecksum() const {
+    uint64_t hash = FnvOffsetBasis;
+    for(size_t f = 0; f < _flocks.size(); ++f) {
+        const BoidStore &boids = _flocks[f]->boids;
+        size_t size = boids.size();
+        const float *arrays[] = { boids.px(), boids.py(), boids.pz(),
+            boids.vx(), boids.vy(), boids.vz(), boids.wing() };
+        for(size_t a = 0; a < sizeof(arrays) / sizeof(arrays[0]); ++a)
+            hash = hashBytes(hash, arrays[a], size * sizeof(float));
+
+        const ObjectiveBoid &leader = _flocks[f]->leader;
+        const Scalar scalars[] = { leader.position.x, leader.position.y,
+            leader.position.z, leader.direction.x, leader.direction.y,
+            leader.direction.z };
+        hash = hashBytes(hash, scalars, sizeof(scalars));
+        hash = hashBytes(hash, &leader.speed, sizeof(leader.speed));
+    }
+    return hash;
+}
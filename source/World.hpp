@@ -0,0 +1,584 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef WORLD_HPP
+#define WORLD_HPP
+
+#include "defs.hpp"
+#include "gameObject/BoidStore.hpp"
+#include "gameObject/Flock.hpp"
+#include "gameObject/FlockStats.hpp"
+#include "gameObject/ObjectiveBoid.hpp"
+#include "spatial/KdTree.hpp"
+#include "spatial/MortonOrder.hpp"
+#include "spatial/NeighborList.hpp"
+#include "spatial/ObstacleField.hpp"
+#include "spatial/SpatialGrid.hpp"
+#include "system/CollisionSystem.hpp"
+#include "system/FlockingSystem.hpp"
+#include "util/Noncopyable.hpp"
+#include "util/Random.hpp"
+#include "util/ThreadPool.hpp"
+#include <algorithm>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * The parameters of a world that can change from one world to another. The
+ * defaults are the ones of the game, from defs.hpp.
+ **/
+struct WorldParameters {
+    /// Radius of the sphere around a boid that other boids won't enter.
+    float boidSpace;
+
+    /// Radius inside which the follow boids are flockmates.
+    float neighborRadius;
+
+    /// Distance below which the flockmates push each other away.
+    float separationRadius;
+
+    /// Number of ticks per simulated second.
+    int tickRate;
+
+    /**
+     * Shortest and longest tick, in seconds, when the length of the ticks
+     * adapts to the speed of the boids (see World::getNextTickLength()), or
+     * 0 to always tick 1 / tickRate seconds.
+     **/
+    float minTickLength, maxTickLength;
+
+    /**
+     * Skin of the neighbor lists of the flocking and collision systems (see
+     * NeighborList), or 0 to query the grid every tick instead.
+     **/
+    float neighborSkin;
+
+    /**
+     * Number of nearest boids that are the flockmates of a follow boid, or 0
+     * to use the boids inside the neighbor radius instead.
+     **/
+    unsigned topologicalNeighbors;
+
+    /**
+     * Number of ticks between two reorders of the follow boids in memory (see
+     * World::reorderBoids()), or 0 to never reorder them.
+     **/
+    unsigned reorderInterval;
+
+    /// Number of static obstacles placed on the ground, besides the tower.
+    unsigned numObstacles;
+
+    /// Number of flocks, each with its own leader.
+    unsigned numFlocks;
+
+    /**
+     * Opening angle of the octree of the far cohesion (see Octree), or 0 to
+     * leave the far cohesion out.
+     **/
+    float openingAngle;
+
+    /**
+     * Number of follow boids the flocking system flocks per tick with the
+     * level of detail (see FlockingSystem::setLevelOfDetail()), or 0 to flock
+     * all of them every tick.
+     **/
+    unsigned lodBudget;
+
+    WorldParameters() : boidSpace(BoidSpace),
+            neighborRadius(FlockingNeighborRadius),
+            separationRadius(FlockingSeparationRadius),
+            tickRate(SimulationTickRate), minTickLength(0.0),
+            maxTickLength(0.0), neighborSkin(0.0),
+            topologicalNeighbors(0), reorderInterval(BoidReorderInterval),
+            numObstacles(0), numFlocks(1), openingAngle(0.0),
+            lodBudget(0) {
+
+    }
+};
+
+/**
+ * A world: the flocks, each an objective boid and the follow boids behind
+ * it, and the systems that simulate them, with their own random numbers.
+ * The same seed and parameters give the same world, with any number of
+ * threads.
+ * The engine has one world, which it updates with its systems, reads the
+ * input into and renders. Any number of other worlds can be simulated in the
+ * same process, for example by the parameter sweeps, as a world never uses
+ * the engine.
+ **/
+class World : public NonCopyable {
+    /// The parameters of the world.
+    WorldParameters _parameters;
+
+    /// The threads of the systems.
+    ThreadPool &_pool;
+
+    /// Random numbers of the world.
+    Random _random;
+
+    /// Number of ticks since init().
+    uint32_t _tick;
+
+    /// Length of the current tick, in seconds.
+    float _tickLength;
+
+    /// Number of additions and removals of follow boids since init(). They
+    /// key the random numbers of each addition and removal.
+    uint32_t _added, _removed;
+
+    /**
+     * The flocks. The first one is the main flock, which the input of the
+     * engine steers and its camera follows; the leaders of the others fly
+     * to random waypoints by themselves. There is always at least one.
+     **/
+    std::vector<Flock *> _flocks;
+
+    /// Order of the follow boids along a Morton curve, for reorderBoids().
+    MortonOrder _mortonOrder;
+
+    /// The static obstacles and their distance field, placed by init().
+    ObstacleField _obstacles;
+
+    /// Point the level of detail of the flocking is centered on.
+    Point _lodCenter;
+
+    /// File where the distance field is kept between runs, or empty.
+    std::string _obstacleCache;
+
+    /// Flocking system.
+    FlockingSystem _flockingSystem;
+
+    /// Collision system.
+    CollisionSystem _collisionSystem;
+
+    /**
+     * Removes the marked boids of the main flock and updates its middle
+     * position. The grid is rebuilt by the next tick.
+     * @param marked One byte for each boid, not 0 for the boids to remove.
+     * @return The number of boids removed, 0 if marked doesn't have a byte
+     * for each boid.
+     **/
+    size_t removeMarkedBoids(const std::vector<unsigned char> &marked);
+
+    /// Rebuilds the grid of a flock. See updateGrid().
+    void updateGrid(Flock &flock);
+
+    /// Places the leader of the flock f at a random position.
+    void placeLeader(unsigned f);
+
+    /// Chooses the next waypoint of the leader of the flock f.
+    void chooseWaypoint(unsigned f);
+
+    /**
+     * Places the obstacles at random positions and bakes their distance
+     * field, or loads it from the cache if it was baked for them before.
+     **/
+    void placeObstacles();
+
+public:
+    /**
+     * Creates an empty world.
+     * @param pool The threads the systems use. Worlds simulated from inside
+     * a loop of the pool run their own loops in the calling thread.
+     * @param parameters The parameters of the world.
+     **/
+    explicit World(ThreadPool &pool,
+            const WorldParameters &parameters = WorldParameters());
+
+    ~World();
+
+    /**
+     * Creates the flocks, places their leaders at random positions and adds
+     * the follow boids behind them. Inits the systems.
+     * @param numBoids Number of follow boids, split evenly between the
+     * flocks.
+     * @param seed Seed of the random numbers of the world.
+     **/
+    void init(unsigned numBoids, unsigned long seed);
+
+    /// Removes the follow boids and terminates the systems.
+    void terminate();
+
+    /**
+     * Starts a new tick of getNextTickLength() seconds: saves the state of
+     * the leaders as the one of the previous tick and advances the tick of
+     * the random numbers. Every reorderInterval ticks, it also reorders the
+     * boids.
+     **/
+    void beginTick();
+
+    /**
+     * Ends the tick. The follow boids swap their buffers when they move (see
+     * BoidStore), and keep their state as the previous one if they didn't.
+     **/
+    void endTick();
+
+    /**
+     * Reorders the follow boids in memory along a Morton curve of their
+     * positions, so the boids close in space are close in memory and the
+     * neighbor searches touch fewer cache lines. The boids keep their
+     * handles, but change their indices.
+     **/
+    void reorderBoids();
+
+    /// Changes the number of ticks between two reorders. 0 never reorders.
+    inline void setReorderInterval(unsigned interval) {
+        _parameters.reorderInterval = interval;
+    }
+
+    /// Changes the number of flocks created by the next init().
+    inline void setNumFlocks(unsigned numFlocks) {
+        _parameters.numFlocks = std::max(numFlocks, 1u);
+    }
+
+    /// Changes the number of obstacles placed by the next init().
+    inline void setNumObstacles(unsigned numObstacles) {
+        _parameters.numObstacles = numObstacles;
+    }
+
+    /**
+     * Changes the file where init() keeps the distance field of the
+     * obstacles. Empty, the default, bakes it every time.
+     **/
+    inline void setObstacleCache(const std::string &file) {
+        _obstacleCache = file;
+    }
+
+    /// Returns the static obstacles.
+    inline const ObstacleField &getObstacles() const {
+        return _obstacles;
+    }
+
+    /**
+     * Advances the world by one tick of getNextTickLength(), with the same
+     * systems in the same order as the engine, but no input: the objective
+     * boid flies straight.
+     **/
+    void step();
+
+    /**
+     * Moves the objective boid of the main flock in its direction.
+     * @param dt How much time to move.
+     **/
+    void moveObjectiveBoid(float dt);
+
+    /**
+     * Turns the leaders of the other flocks towards their waypoints, and
+     * moves them in their direction. A leader chooses its next waypoint
+     * when it gets close to the current one.
+     * @param dt How much time to move.
+     **/
+    void moveLeaders(float dt);
+
+    /**
+     * Adds a new boid to the main flock at a random position near it.
+     * @return The handle of the new boid, or an invalid handle if no boid
+     * fits. See addBoids().
+     **/
+    inline BoidHandle addBoid() {
+        if(!addBoids(1))
+            return BoidHandle();
+
+        BoidStore &boids = getBoids();
+        return boids.handleAt(boids.size() - 1);
+    }
+
+    /**
+     * Adds n new boids to a flock, at the end of its boids, by Poisson-disc
+     * sampling: each new boid is placed behind the objective boid or a random
+     * follow boid, between 2 and 4 boid spaces from it and at least 2 boid
+     * spaces from every other boid of the flock. The candidates are checked
+     * against a grid of the boids, so the cost is linear in the number of
+     * boids. The grid is kept until the boids move or leave, so the next
+     * additions in the same tick only cost the boids they add.
+     * @param f The flock, the main one by default.
+     * @return The number of boids added, less than n only if there is no
+     * space left around the flock.
+     **/
+    size_t addBoids(size_t n, size_t f = 0);
+
+    /**
+     * Removes a random boid of the main flock in constant time. Like the
+     * other additions and removals, it leaves the grid of the flock for the
+     * next tick to rebuild.
+     **/
+    void removeRandomBoid();
+
+    /**
+     * Removes n random boids of the main flock, or all its boids if there
+     * are fewer.
+     * @return The number of boids removed.
+     **/
+    size_t removeBoids(size_t n);
+
+    /**
+     * Removes the boids of the main flock for which the predicate returns
+     * true, in one pass. The other boids keep their order and their handles.
+     * @param predicate Called with a FollowBoid of each boid.
+     * @return The number of boids removed.
+     **/
+    template<typename Predicate>
+    size_t removeBoidsIf(Predicate predicate) {
+        BoidStore &boids = getBoids();
+        size_t size = boids.size();
+        std::vector<unsigned char> marked(size);
+        for(size_t i = 0; i < size; ++i)
+            marked[i] = predicate(boids[i]);
+
+        return removeMarkedBoids(marked);
+    }
+
+    /**
+     * Rebuilds the grids of the flocks with the current position of their
+     * follow boids.
+     * Called once per tick, before the boids are moved. The boids move at
+     * most BoidMaxSpeed * getTickLength() in a tick, so the users of the
+     * grid grow their queries by that much to find every boid.
+     * With neighbor lists, the grid is only rebuilt with the lists, and the
+     * lists are used instead of the grid queries.
+     **/
+    void updateGrid();
+
+    /**
+     * Rebuilds the neighbor lists and the grid of each flock, if its boids
+     * could have moved more than the skin by the end of the tick. Called
+     * once per tick instead of updateGrid(), when the lists are used.
+     * @return If the lists of any flock were rebuilt.
+     **/
+    bool updateNeighborList();
+
+    /**
+     * Changes the skin of the neighbor lists. 0 stops using the lists.
+     **/
+    void setNeighborSkin(float skin);
+
+    /// Returns if the systems use the neighbor lists instead of the grid.
+    inline bool usesNeighborList() const {
+        return _parameters.neighborSkin > 0.0;
+    }
+
+    /// Returns the neighbor lists of the main flock.
+    inline const NeighborList &getNeighborList() const {
+        return _flocks[0]->neighborList;
+    }
+
+    /**
+     * Rebuilds the tree of each flock with the current position of its
+     * follow boids, and finds the topologicalNeighbors nearest boids of
+     * every one of them.
+     **/
+    void updateKdTree();
+
+    /**
+     * Changes the number of nearest boids that are flockmates. 0 goes back to
+     * the boids inside the neighbor radius.
+     **/
+    inline void setTopologicalNeighbors(unsigned k) {
+        _parameters.topologicalNeighbors = k;
+    }
+
+    /// Returns if the flockmates are the nearest boids instead of the boids
+    /// inside the neighbor radius.
+    inline bool usesTopologicalNeighbors() const {
+        return _parameters.topologicalNeighbors > 0;
+    }
+
+    /// Returns the tree with the follow boids of the main flock.
+    inline const KdTree &getKdTree() const {
+        return _flocks[0]->kdTree;
+    }
+
+    /**
+     * Rebuilds the octree of each flock with the current position of its
+     * follow boids, and finds the centroid of the flock each one of them is
+     * pulled to.
+     **/
+    void updateOctree();
+
+    /**
+     * Changes the opening angle of the octrees of the far cohesion. 0 leaves
+     * the far cohesion out.
+     **/
+    inline void setOpeningAngle(float openingAngle) {
+        _parameters.openingAngle = openingAngle;
+    }
+
+    /// Returns if the follow boids are pulled towards their whole flock, on
+    /// top of their flockmates.
+    inline bool usesFarCohesion() const {
+        return _parameters.openingAngle > 0.0;
+    }
+
+    /**
+     * Changes the number of follow boids flocked per tick with the level of
+     * detail. 0 flocks all of them every tick.
+     **/
+    inline void setLodBudget(unsigned budget) {
+        _parameters.lodBudget = budget;
+    }
+
+    /**
+     * Centers the level of detail on the given point, usually the camera.
+     * Until it is set, it is the first leader, where init() placed it.
+     **/
+    inline void setLodCenter(const Point &center) {
+        _lodCenter = center;
+    }
+
+    /// Returns the point the level of detail is centered on.
+    inline const Point &getLodCenter() const {
+        return _lodCenter;
+    }
+
+    /**
+     * Rescans the aggregates of the follow boids of each flock and updates
+     * their middle position. Must be called every time the follow boids
+     * move; the additions and removals update them by themselves.
+     **/
+    void updateStats();
+
+    /**
+     * Returns a hash of the bits of the state of the boids: for each flock,
+     * the positions, velocities and wing phases of the follow boids and the
+     * position, direction and speed of the objective boid. Two runs with the
+     * same checksum are in the same state, bit by bit.
+     **/
+    uint64_t getChecksum() const;
+
+    /// Returns the random numbers of the world.
+    inline const Random &getRandom() const {
+        return _random;
+    }
+
+    /// Returns the number of ticks since init().
+    inline uint32_t getTick() const {
+        return _tick;
+    }
+
+    /// Returns the parameters of the world.
+    inline const WorldParameters &getParameters() const {
+        return _parameters;
+    }
+
+    /// Returns the length of the current tick, in seconds.
+    inline float getTickLength() const {
+        return _tickLength;
+    }
+
+    /**
+     * Returns the length of the next tick, in seconds: 1 / tickRate, or, if
+     * the ticks adapt to the boids, the time the fastest boid takes to fly
+     * AdaptiveCourantNumber times boidSpace (a CFL condition), between
+     * minTickLength and maxTickLength. Fast flocks take short ticks, so no
+     * boid flies through the space of another in one, and calm flocks take
+     * long ones.
+     **/
+    float getNextTickLength() const;
+
+    /**
+     * Changes the shortest and longest tick. 0 for both ticks 1 / tickRate
+     * seconds.
+     **/
+    inline void setTickLengths(float minLength, float maxLength) {
+        _parameters.minTickLength = minLength;
+        _parameters.maxTickLength = maxLength;
+    }
+
+    /// Returns if the length of the ticks adapts to the speed of the boids.
+    inline bool usesAdaptiveTicks() const {
+        return _parameters.maxTickLength > 0.0;
+    }
+
+    /// Returns the largest speed of the boids of all the flocks, leaders
+    /// included.
+    float getMaxSpeed() const;
+
+    /// Returns the threads of the systems.
+    inline ThreadPool &getThreadPool() {
+        return _pool;
+    }
+
+    /// Returns the number of flocks.
+    inline size_t getNumFlocks() const {
+        return _flocks.size();
+    }
+
+    /// Returns the number of follow boids of all the flocks.
+    size_t getNumBoids() const;
+
+    /// Returns the flock f. The flock 0 is the main flock.
+    inline Flock &getFlock(size_t f) {
+        return *_flocks[f];
+    }
+
+    /// Returns the objective boid of the main flock.
+    inline ObjectiveBoid &getObjectiveBoid() {
+        return _flocks[0]->leader;
+    }
+
+    /// Returns the store of follow boids of the main flock.
+    inline BoidStore &getBoids() {
+        return _flocks[0]->boids;
+    }
+
+    /**
+     * Returns the grid with the follow boids of the main flock, as of its
+     * last rebuild: it misses the boids added or removed since.
+     * @see updateGrid()
+     **/
+    inline SpatialGrid &getGrid() {
+        return _flocks[0]->grid;
+    }
+
+    /// Returns the aggregates of the follow boids of the main flock.
+    inline const FlockStats &getStats() const {
+        return _flocks[0]->stats;
+    }
+
+    /// Returns the middle relative position of the main flock.
+    inline Point getMiddlePosition() const {
+        return _flocks[0]->middle;
+    }
+
+    /// Returns the middle absolute position of the main flock.
+    inline Point getAbsoluteMiddlePosition() const {
+        return _flocks[0]->getAbsoluteMiddlePosition();
+    }
+
+    /// Returns the flocking system.
+    inline FlockingSystem &getFlockingSystem() {
+        return _flockingSystem;
+    }
+
+    /// Returns the collision system.
+    inline CollisionSystem &getCollisionSystem() {
+        return _collisionSystem;
+    }
+};
+
+#endif // !WORLD_HPP
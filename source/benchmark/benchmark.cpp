@@ -0,0 +1,1029 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Benchmarks of the simulation.
+ * They don't create the engine (and, therefore, no window), and drive the
+ * systems directly with flocks of many boids.
+ *
+ * Usage: boids_benchmark [-t ticks] [-n boids[,boids...]]
+ *                        [-j threads[,threads...]] [benchmark...]
+ */
+
+#include "../defs.hpp"
+#include "../gameObject/ObjectiveBoid.hpp"
+#include "../gameObject/BoidStore.hpp"
+#include "../simd/kernels.hpp"
+#include "../spatial/KdTree.hpp"
+#include "../spatial/MortonOrder.hpp"
+#include "../spatial/NeighborList.hpp"
+#include "../spatial/ObstacleField.hpp"
+#include "../spatial/Octree.hpp"
+#include "../spatial/SpatialGrid.hpp"
+#include "../util/Random.hpp"
+#include "../util/ThreadPool.hpp"
+#include "../World.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    /// Options given in the command line.
+    struct Options {
+        /// Number of ticks to measure in each run.
+        unsigned ticks;
+
+        /// Flock sizes to run.
+        std::vector<size_t> sizes;
+
+        /// Numbers of threads to run the parallel benchmarks with. 0 is one
+        /// per hardware thread.
+        std::vector<size_t> threads;
+
+        Options() : ticks(100) {
+            threads.push_back(0);
+            sizes.push_back(1000);
+            sizes.push_back(5000);
+            sizes.push_back(10000);
+            sizes.push_back(20000);
+            sizes.push_back(50000);
+            sizes.push_back(100000);
+        }
+    };
+
+    /// A benchmark function.
+    typedef void (*BenchmarkFunction)(const Options &options);
+
+    /// A benchmark and its name in the command line.
+    struct Benchmark {
+        const char *name;
+        BenchmarkFunction function;
+    };
+
+    /// Number of ticks to run before measuring, to let the flock settle.
+    const unsigned WarmUpTicks = 10;
+
+    /// Returns a monotonic time, in seconds.
+    double now() {
+        return std::chrono::duration<double>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// Creates the leader of the benchmark flocks.
+    ObjectiveBoid createLeader() {
+        return ObjectiveBoid(0, true,
+                Point(0.0, (MinimumHeight + MaximumHeight) / 2, 0.0),
+                ObjectiveBoidInitialSpeed, Vector(0.0, 0.0, -1.0));
+    }
+
+    /**
+     * Creates a flock with the given size in a jittered lattice behind the
+     * leader, every boid flying like it.
+     **/
+    void createFlock(const ObjectiveBoid &leader, BoidStore &boids,
+            size_t size) {
+        const float spacing = 2 * BoidSpace;
+
+        // Side of the smallest cube that holds the flock.
+        size_t side = 1;
+        while(side * side * side < size)
+            ++side;
+
+        // The same flock every run.
+        Random random(1);
+        boids.clear();
+        boids.reserve(size);
+        for(size_t i = 0; i < size; ++i) {
+            RandomStream jitter(random, BenchmarkStream, i, 0);
+            float jitterX = jitter.nextFloat() - 0.5;
+            float jitterY = jitter.nextFloat() - 0.5;
+            float jitterZ = jitter.nextFloat() - 0.5;
+
+            Point position = leader.position;
+            position.x += (i % side - side / 2.0 + jitterX) * spacing;
+            position.y += ((i / side) % side - side / 2.0 + jitterY) * spacing;
+            position.z += (i / (side * side) + 1 + jitterZ) * spacing;
+
+            boids.add(position, leader.direction * leader.speed, 0.0);
+        }
+    }
+
+    /// Moves the leader straight ahead.
+    void moveLeader(ObjectiveBoid &leader, float dt) {
+        leader.position += leader.direction * leader.speed * dt;
+    }
+
+    /// Rebuilds the grid with the positions of the boids.
+    void updateGrid(SpatialGrid &grid, const BoidStore &boids) {
+        grid.setPoints(boids.px(), boids.py(), boids.pz(), boids.size());
+        grid.rebuild();
+    }
+
+    /// Counts the points visited by the grid.
+    struct CountVisitor {
+        size_t count;
+
+        CountVisitor() : count(0) { }
+
+        void operator()(unsigned, float, float, float) {
+            ++count;
+        }
+    };
+
+    /**
+     * Prints the time of a run.
+     * @param extra Printed at the end of the line.
+     **/
+    void report(const char *name, size_t size, unsigned ticks, double seconds,
+            const std::string &extra = "") {
+        const double budget = 1000.0 / SimulationTickRate;
+        double msPerTick = seconds * 1000.0 / ticks;
+
+        std::cout << std::setw(12) << name << std::setw(10) << size
+            << std::setw(12) << std::fixed << std::setprecision(3)
+            << msPerTick << " ms/tick" << std::setw(10) << std::setprecision(1)
+            << 1000.0 / msPerTick << " ticks/s  "
+            << (msPerTick <= budget ? "ok      " : "too slow") << extra
+            << std::endl;
+    }
+
+    /**
+     * Measures the rebuild of the grid plus a query around every boid, which
+     * is the base of all the neighbor searches of a tick.
+     **/
+    void benchmarkGrid(const Options &options) {
+        for(size_t s = 0; s < options.sizes.size(); ++s) {
+            ObjectiveBoid leader = createLeader();
+            BoidStore boids;
+            SpatialGrid grid(SpatialGridCellSize);
+            createFlock(leader, boids, options.sizes[s]);
+
+            CountVisitor neighbors;
+            double begin = now();
+            for(unsigned i = 0; i < options.ticks; ++i) {
+                updateGrid(grid, boids);
+                for(size_t b = 0; b < boids.size(); ++b)
+                    grid.forEachNeighbor(boids.px()[b], boids.py()[b],
+                            boids.pz()[b], 2 * BoidSpace, neighbors);
+            }
+
+            double seconds = now() - begin;
+
+            std::stringstream extra;
+            extra << "  " << std::fixed << std::setprecision(1)
+                << (double) neighbors.count
+                / (options.ticks * boids.size()) << " neighbors/boid";
+            report("grid", options.sizes[s], options.ticks, seconds,
+                    extra.str());
+        }
+    }
+
+    /**
+     * Measures a tick of the flocking system, which must fit in
+     * 1 / SimulationTickRate seconds for the game to keep up, with each
+     * number of threads. The checksum of the positions at the end must be
+     * the same with any number of threads.
+     **/
+    void benchmarkFlocking(const Options &options) {
+        const float dt = 1.0 / SimulationTickRate;
+
+        for(size_t s = 0; s < options.sizes.size(); ++s) {
+            for(size_t t = 0; t < options.threads.size(); ++t) {
+                ObjectiveBoid leader = createLeader();
+                BoidStore boids;
+                SpatialGrid grid(SpatialGridCellSize);
+                ThreadPool pool(options.threads[t]);
+                World world(pool);
+                FlockingSystem &flocking = world.getFlockingSystem();
+                createFlock(leader, boids, options.sizes[s]);
+
+                for(unsigned i = 0; i < WarmUpTicks; ++i) {
+                    moveLeader(leader, dt);
+                    updateGrid(grid, boids);
+                    flocking.flock(pool, leader, boids, grid, dt);
+                }
+
+                double begin = now();
+                for(unsigned i = 0; i < options.ticks; ++i) {
+                    moveLeader(leader, dt);
+                    updateGrid(grid, boids);
+                    flocking.flock(pool, leader, boids, grid, dt);
+                }
+                double seconds = now() - begin;
+
+                double checksum = 0.0;
+                for(size_t i = 0; i < boids.size(); ++i)
+                    checksum += boids.px()[i] + boids.py()[i] + boids.pz()[i];
+
+                std::stringstream extra;
+                extra << "  " << std::setw(2) << pool.getNumThreads()
+                    << " threads, checksum " << std::fixed
+                    << std::setprecision(4) << checksum;
+                report("flocking", options.sizes[s], options.ticks, seconds,
+                        extra.str());
+            }
+        }
+    }
+
+    /// Boids flocked per tick by benchmarkLod().
+    const size_t LodBudget = 2000;
+
+    /**
+     * Measures the flocking with the level of detail centered on the leader,
+     * with LodBudget boids flocked per tick, against flocking all the boids
+     * every tick, from the same flock. The drift is how far apart the boids
+     * of both flocks end up, on average.
+     **/
+    void benchmarkLod(const Options &options) {
+        const float dt = 1.0 / SimulationTickRate;
+        ThreadPool pool(options.threads[0]);
+
+        for(size_t s = 0; s < options.sizes.size(); ++s) {
+            ObjectiveBoid leaders[2] = { createLeader(), createLeader() };
+            BoidStore boids[2];
+            SpatialGrid grid(SpatialGridCellSize);
+            World world(pool);
+            FlockingSystem &flocking = world.getFlockingSystem();
+
+            // The first flock every tick, the second with the level of
+            // detail. The tick of the world chooses the boids flocked.
+            double seconds[2];
+            size_t updates = 0;
+            for(int run = 0; run < 2; ++run) {
+                createFlock(leaders[run], boids[run], options.sizes[s]);
+                double begin = now();
+                for(unsigned i = 0; i < options.ticks; ++i) {
+                    world.beginTick();
+                    moveLeader(leaders[run], dt);
+                    flocking.setLevelOfDetail(leaders[run].position,
+                            run ? LodBudget : 0);
+                    updateGrid(grid, boids[run]);
+                    flocking.flock(pool, leaders[run], boids[run], grid, dt);
+                    updates += run ? flocking.getNumUpdated() : 0;
+                }
+                seconds[run] = now() - begin;
+            }
+
+            double drift = 0.0;
+            for(size_t i = 0; i < boids[0].size(); ++i) {
+                float dx = boids[1].px()[i] - boids[0].px()[i];
+                float dy = boids[1].py()[i] - boids[0].py()[i];
+                float dz = boids[1].pz()[i] - boids[0].pz()[i];
+                drift += std::sqrt(dx * dx + dy * dy + dz * dz);
+            }
+
+            report("every tick", options.sizes[s], options.ticks,
+                    seconds[0]);
+            std::stringstream extra;
+            extra << "  " << std::fixed << std::setprecision(0)
+                << (double) updates / options.ticks << " boids flocked/tick, "
+                << std::setprecision(1) << seconds[0] / seconds[1]
+                << "x faster, drift " << std::setprecision(2)
+                << drift / boids[0].size();
+            report("lod", options.sizes[s], options.ticks, seconds[1],
+                    extra.str());
+        }
+    }
+
+    /**
+     * Measures the flocking system with neighbor lists instead of a grid
+     * query per boid per tick, like benchmarkFlocking(). The lists are
+     * rebuilt, with the grid, only when the boids could have moved more than
+     * the skin.
+     **/
+    void benchmarkLists(const Options &options) {
+        const float dt = 1.0 / SimulationTickRate;
+
+        for(size_t s = 0; s < options.sizes.size(); ++s) {
+            for(size_t t = 0; t < options.threads.size(); ++t) {
+                ObjectiveBoid leader = createLeader();
+                BoidStore boids;
+                SpatialGrid grid(SpatialGridCellSize);
+                NeighborList neighbors(FlockingNeighborRadius,
+                        NeighborListSkin);
+                ThreadPool pool(options.threads[t]);
+                World world(pool);
+                FlockingSystem &flocking = world.getFlockingSystem();
+                createFlock(leader, boids, options.sizes[s]);
+
+                for(unsigned i = 0; i < WarmUpTicks; ++i) {
+                    moveLeader(leader, dt);
+                    if(neighbors.needsRebuild(boids, 0.0, pool)) {
+                        updateGrid(grid, boids);
+                        neighbors.build(grid, boids, pool);
+                    }
+                    flocking.flock(pool, leader, boids, grid, dt, &neighbors);
+                }
+
+                unsigned long builds = neighbors.getNumBuilds();
+                size_t listed = 0;
+                double begin = now();
+                for(unsigned i = 0; i < options.ticks; ++i) {
+                    moveLeader(leader, dt);
+                    if(neighbors.needsRebuild(boids, 0.0, pool)) {
+                        updateGrid(grid, boids);
+                        neighbors.build(grid, boids, pool);
+                    }
+                    flocking.flock(pool, leader, boids, grid, dt, &neighbors);
+                }
+                double seconds = now() - begin;
+                builds = neighbors.getNumBuilds() - builds;
+                for(size_t p = 0; p < neighbors.size(); ++p)
+                    listed += neighbors.getNumNeighbors(p);
+
+                double checksum = 0.0;
+                for(size_t i = 0; i < boids.size(); ++i)
+                    checksum += boids.px()[i] + boids.py()[i] + boids.pz()[i];
+
+                std::stringstream extra;
+                extra << "  " << std::setw(2) << pool.getNumThreads()
+                    << " threads, " << builds << " builds, "
+                    << std::fixed << std::setprecision(1)
+                    << (double) listed / boids.size() << " listed/boid, "
+                    << "checksum " << std::setprecision(4) << checksum;
+                report("lists", options.sizes[s], options.ticks, seconds,
+                        extra.str());
+            }
+        }
+    }
+
+    /**
+     * Measures the topological flocking, with the FlockingTopologicalNeighbors
+     * nearest boids as flockmates, like benchmarkFlocking(). The tree is
+     * rebuilt and searched every tick, and its share of the time is reported
+     * too.
+     **/
+    void benchmarkNearest(const Options &options) {
+        const float dt = 1.0 / SimulationTickRate;
+        const size_t k = FlockingTopologicalNeighbors;
+
+        for(size_t s = 0; s < options.sizes.size(); ++s) {
+            for(size_t t = 0; t < options.threads.size(); ++t) {
+                ObjectiveBoid leader = createLeader();
+                BoidStore boids;
+                KdTree tree;
+                ThreadPool pool(options.threads[t]);
+                World world(pool);
+                FlockingSystem &flocking = world.getFlockingSystem();
+                createFlock(leader, boids, options.sizes[s]);
+
+                for(unsigned i = 0; i < WarmUpTicks; ++i) {
+                    moveLeader(leader, dt);
+                    tree.build(boids.px(), boids.py(), boids.pz(),
+                            boids.size(), pool);
+                    tree.findAllNearest(k, pool);
+                    flocking.flockNearest(pool, leader, boids, tree, dt);
+                }
+
+                double treeSeconds = 0.0;
+                double begin = now();
+                for(unsigned i = 0; i < options.ticks; ++i) {
+                    moveLeader(leader, dt);
+                    double treeBegin = now();
+                    tree.build(boids.px(), boids.py(), boids.pz(),
+                            boids.size(), pool);
+                    tree.findAllNearest(k, pool);
+                    treeSeconds += now() - treeBegin;
+                    flocking.flockNearest(pool, leader, boids, tree, dt);
+                }
+                double seconds = now() - begin;
+
+                double checksum = 0.0;
+                for(size_t i = 0; i < boids.size(); ++i)
+                    checksum += boids.px()[i] + boids.py()[i] + boids.pz()[i];
+
+                std::stringstream extra;
+                extra << "  " << std::setw(2) << pool.getNumThreads()
+                    << " threads, " << std::fixed << std::setprecision(0)
+                    << 100.0 * treeSeconds / seconds << "% in the tree, "
+                    << "checksum " << std::setprecision(4) << checksum;
+                report("nearest", options.sizes[s], options.ticks, seconds,
+                        extra.str());
+            }
+        }
+    }
+
+    /**
+     * Shuffles the boids in memory, like a flock whose boids were added and
+     * removed in no particular order.
+     **/
+    void shuffleFlock(BoidStore &boids) {
+        std::vector<unsigned> order(boids.size());
+        for(size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+
+        Random random(1);
+        RandomStream shuffle(random, BenchmarkStream, order.size(), 1);
+        for(size_t i = order.size(); i > 1; --i)
+            std::swap(order[i - 1], order[shuffle.next() % i]);
+        boids.permute(&order[0]);
+    }
+
+    /**
+     * Returns the number of cache lines of each array loaded per boid when
+     * the boids are gathered in the order of the grid, as the systems do, a
+     * chunk of BoidsPerChunk boids at a time. A line is loaded once per
+     * chunk, however many of its boids the chunk gathers. The fewer, the
+     * fewer the cache misses.
+     **/
+    double linesPerBoid(const SpatialGrid &grid) {
+        const unsigned floatsPerLine = 64 / sizeof(float);
+        const unsigned *indices = grid.getSortedIndices();
+        std::vector<unsigned> lines;
+        size_t loaded = 0;
+        for(size_t begin = 0; begin < grid.size(); begin += BoidsPerChunk) {
+            size_t end = std::min(begin + BoidsPerChunk, grid.size());
+            lines.clear();
+            for(size_t p = begin; p < end; ++p)
+                lines.push_back(indices[p] / floatsPerLine);
+            std::sort(lines.begin(), lines.end());
+            loaded += std::unique(lines.begin(), lines.end()) - lines.begin();
+        }
+        return grid.size() ? (double) loaded / grid.size() : 0.0;
+    }
+
+    /**
+     * Measures the flocking system, like benchmarkFlocking(), with the boids
+     * scattered in memory, first as they are and then reordered along a
+     * Morton curve every BoidReorderInterval ticks. The time of the reorders
+     * is included.
+     **/
+    void benchmarkReorder(const Options &options) {
+        const float dt = 1.0 / SimulationTickRate;
+
+        for(size_t s = 0; s < options.sizes.size(); ++s) {
+            for(size_t t = 0; t < options.threads.size(); ++t) {
+                for(int reorder = 0; reorder < 2; ++reorder) {
+                    ObjectiveBoid leader = createLeader();
+                    BoidStore boids;
+                    SpatialGrid grid(SpatialGridCellSize);
+                    MortonOrder morton;
+                    ThreadPool pool(options.threads[t]);
+                    World world(pool);
+                    FlockingSystem &flocking = world.getFlockingSystem();
+                    createFlock(leader, boids, options.sizes[s]);
+                    shuffleFlock(boids);
+
+                    double begin = now();
+                    double lines = 0.0;
+                    for(unsigned i = 0; i < options.ticks; ++i) {
+                        if(reorder && i % BoidReorderInterval == 0) {
+                            morton.sort(boids.px(), boids.py(), boids.pz(),
+                                    boids.size(), SpatialGridCellSize, pool);
+                            boids.permute(morton.getOrder());
+                        }
+
+                        moveLeader(leader, dt);
+                        updateGrid(grid, boids);
+                        flocking.flock(pool, leader, boids, grid, dt);
+                        lines += linesPerBoid(grid);
+                    }
+                    double seconds = now() - begin;
+
+                    std::stringstream extra;
+                    extra << "  " << std::setw(2) << pool.getNumThreads()
+                        << " threads, " << std::fixed << std::setprecision(2)
+                        << lines / options.ticks << " cache lines/boid";
+                    report(reorder ? "morton" : "scattered", options.sizes[s],
+                            options.ticks, seconds, extra.str());
+                }
+            }
+        }
+    }
+
+    /**
+     * Measures the avoidance of the tower over a flock flying around it, and
+     * over one far from it, which the bounding box test skips.
+     **/
+    void benchmarkTower(const Options &options) {
+        const float dt = 1.0 / SimulationTickRate;
+        const simd::Cone tower = { 0.0f, 0.0f, TowerBaseRadius, TowerHeight };
+
+        for(size_t s = 0; s < options.sizes.size(); ++s) {
+            for(int far = 0; far < 2; ++far) {
+                ObjectiveBoid leader = createLeader();
+                if(far)
+                    leader.position.x += GroundSize / 2;
+                BoidStore boids;
+                createFlock(leader, boids, options.sizes[s]);
+
+                double begin = now();
+                for(unsigned i = 0; i < options.ticks; ++i)
+                    simd::avoidCone(boids, tower, 0, boids.size(),
+                            TowerClearance, TowerLookahead, BoidMaxForce * dt,
+                            BoidMaxSpeed);
+                double seconds = now() - begin;
+
+                report(far ? "tower far" : "tower near", options.sizes[s],
+                        options.ticks, seconds);
+            }
+        }
+    }
+
+    /**
+     * Measures whole ticks of a world with the boids split between a few and
+     * many flocks. Only the pairs of flocks whose boxes overlap are tested
+     * against each other, so the cost follows the overlaps, not the number
+     * of pairs of flocks.
+     **/
+    void benchmarkFlocks(const Options &options) {
+        const unsigned counts[] = { 1, 16, 64 };
+        ThreadPool pool(options.threads[0]);
+
+        for(size_t s = 0; s < options.sizes.size(); ++s) {
+            for(size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+                WorldParameters parameters;
+                parameters.numFlocks = counts[c];
+                World world(pool, parameters);
+                world.init(options.sizes[s], 1);
+
+                size_t pairs = 0;
+                double begin = now();
+                for(unsigned i = 0; i < options.ticks; ++i) {
+                    world.step();
+                    pairs += world.getCollisionSystem().getNumFlockPairs();
+                }
+                double seconds = now() - begin;
+
+                std::stringstream name, extra;
+                name << "flocks " << counts[c];
+                extra << "  " << std::fixed << std::setprecision(1)
+                    << (double) pairs / options.ticks << " of "
+                    << counts[c] * (counts[c] - 1) / 2
+                    << " pairs tested/tick";
+                report(name.str().c_str(), options.sizes[s], options.ticks,
+                        seconds, extra.str());
+            }
+        }
+    }
+
+    /// Places the given number of obstacles on the ground, the same every run.
+    void createObstacles(ObstacleField &field, unsigned count) {
+        Random random(1);
+        field.clear();
+        for(unsigned o = 0; o < count; ++o) {
+            RandomStream place(random, BenchmarkStream, o, 2);
+            Obstacle obstacle;
+            obstacle.shape = place.next() % 2 ? Obstacle::PillarShape
+                : Obstacle::ConeShape;
+            obstacle.radius = ObstacleMinRadius + place.nextFloat()
+                * (ObstacleMaxRadius - ObstacleMinRadius);
+            obstacle.height = ObstacleMinHeight + place.nextFloat()
+                * (ObstacleMaxHeight - ObstacleMinHeight);
+            obstacle.x = (place.nextFloat() - 0.5f) * GroundSize;
+            obstacle.z = (place.nextFloat() - 0.5f) * GroundSize;
+            field.add(obstacle);
+        }
+    }
+
+    /**
+     * Measures the distance to the nearest obstacle at every boid, looked up
+     * in the baked field and computed against every obstacle, for a few and
+     * for many obstacles. The field costs the same however many there are.
+     **/
+    void benchmarkObstacles(const Options &options) {
+        const unsigned counts[] = { 4, 64 };
+        ThreadPool pool(0);
+
+        for(size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+            ObstacleField field;
+            createObstacles(field, counts[c]);
+            double bakeBegin = now();
+            field.bake(pool);
+            double bakeSeconds = now() - bakeBegin;
+            const std::vector<Obstacle> &obstacles = field.getObstacles();
+
+            for(size_t s = 0; s < options.sizes.size(); ++s) {
+                ObjectiveBoid leader = createLeader();
+                BoidStore boids;
+                createFlock(leader, boids, options.sizes[s]);
+                const float *px = boids.px(), *py = boids.py(),
+                      *pz = boids.pz();
+
+                // Sum the distances up to the band, so the loops aren't
+                // optimized away and their results can be compared.
+                double fieldSum = 0.0;
+                double begin = now();
+                for(unsigned i = 0; i < options.ticks; ++i)
+                    for(size_t b = 0; b < boids.size(); ++b) {
+                        float gx, gy, gz;
+                        fieldSum += std::min(ObstacleField::Band,
+                                field.sample(px[b], py[b], pz[b], gx, gy, gz));
+                    }
+                double fieldSeconds = now() - begin;
+
+                double analyticSum = 0.0;
+                begin = now();
+                for(unsigned i = 0; i < options.ticks; ++i)
+                    for(size_t b = 0; b < boids.size(); ++b) {
+                        float distance = ObstacleField::Band;
+                        for(size_t o = 0; o < obstacles.size(); ++o)
+                            distance = std::min(distance,
+                                    obstacles[o].distance(px[b], py[b],
+                                        pz[b]));
+                        analyticSum += distance;
+                    }
+                double analyticSeconds = now() - begin;
+
+                std::stringstream name, extra;
+                name << "field " << counts[c];
+                extra << std::fixed << std::setprecision(1) << "  "
+                    << field.getNumStoredBricks() << "/"
+                    << field.getNumBricks() << " bricks baked in "
+                    << bakeSeconds * 1000.0 << " ms, "
+                    << analyticSeconds / fieldSeconds << "x the analytic";
+                report(name.str().c_str(), options.sizes[s], options.ticks,
+                        fieldSeconds, extra.str());
+
+                name.str("");
+                extra.str("");
+                name << "analytic " << counts[c];
+                extra << std::fixed << std::setprecision(3)
+                    << "  mean distance " << fieldSum / options.ticks
+                    / boids.size() << " / " << analyticSum / options.ticks
+                    / boids.size();
+                report(name.str().c_str(), options.sizes[s], options.ticks,
+                        analyticSeconds, extra.str());
+            }
+        }
+    }
+
+    /// Largest flock the centroids are found by all pairs for, as it takes
+    /// quadratic time.
+    const size_t MaxExactCentroids = 20000;
+
+    /**
+     * Measures the build of the octree plus the centroids of the far cohesion
+     * with a few opening angles, and compares the steering towards them with
+     * the one towards the exact centroids, found by all pairs, in speed and
+     * in error.
+     **/
+    void benchmarkBarnesHut(const Options &options) {
+        const float angles[] = { 0.3, 0.6, 1.0 };
+        ThreadPool pool(0);
+
+        for(size_t s = 0; s < options.sizes.size(); ++s) {
+            ObjectiveBoid leader = createLeader();
+            BoidStore boids;
+            Octree octree;
+            createFlock(leader, boids, options.sizes[s]);
+            const size_t size = boids.size();
+            const float *px = boids.px(), *py = boids.py(), *pz = boids.pz();
+
+            // The exact steering of each boid, towards the exact centroid.
+            bool exact = size <= MaxExactCentroids;
+            std::vector<float> steerX, steerY, steerZ;
+            double exactSeconds = 0.0;
+            if(exact) {
+                double begin = now();
+                octree.build(px, py, pz, size, pool);
+                octree.findCentroidsExact(FarCohesionSoftening, pool);
+                exactSeconds = now() - begin;
+
+                for(size_t i = 0; i < size; ++i) {
+                    steerX.push_back(octree.getCentroidX()[i] - px[i]);
+                    steerY.push_back(octree.getCentroidY()[i] - py[i]);
+                    steerZ.push_back(octree.getCentroidZ()[i] - pz[i]);
+                }
+                report("all pairs", size, 1, exactSeconds);
+            }
+
+            for(size_t a = 0; a < sizeof(angles) / sizeof(angles[0]); ++a) {
+                double begin = now();
+                for(unsigned i = 0; i < options.ticks; ++i) {
+                    octree.build(px, py, pz, size, pool);
+                    octree.findCentroids(angles[a], FarCohesionSoftening,
+                            pool);
+                }
+                double seconds = now() - begin;
+
+                std::stringstream name, extra;
+                name << "octree " << std::fixed << std::setprecision(1)
+                    << angles[a];
+                extra << "  " << octree.getNumNodes() << " nodes";
+                if(exact) {
+                    // Error of the steering, relative to the exact one.
+                    double sum = 0.0, largest = 0.0;
+                    for(size_t i = 0; i < size; ++i) {
+                        float dx = octree.getCentroidX()[i] - px[i]
+                            - steerX[i];
+                        float dy = octree.getCentroidY()[i] - py[i]
+                            - steerY[i];
+                        float dz = octree.getCentroidZ()[i] - pz[i]
+                            - steerZ[i];
+                        double steer = std::sqrt(steerX[i] * steerX[i]
+                                + steerY[i] * steerY[i]
+                                + steerZ[i] * steerZ[i]);
+                        double error = std::sqrt(dx * dx + dy * dy + dz * dz)
+                            / std::max(steer, 1.0);
+                        sum += error;
+                        largest = std::max(largest, error);
+                    }
+
+                    extra << ", " << std::fixed << std::setprecision(1)
+                        << exactSeconds * options.ticks / seconds
+                        << "x all pairs, error " << std::scientific
+                        << std::setprecision(1) << sum / size << " mean "
+                        << largest << " max";
+                }
+                report(name.str().c_str(), size, options.ticks, seconds,
+                        extra.str());
+            }
+        }
+    }
+
+    /// Largest difference between the sums of two kernels, relative to size.
+    float sumsError(const simd::FlockmateSums &a,
+            const simd::FlockmateSums &b) {
+        const float pairs[][2] = {
+            { a.separationX, b.separationX }, { a.separationY, b.separationY },
+            { a.separationZ, b.separationZ }, { a.alignmentX, b.alignmentX },
+            { a.alignmentY, b.alignmentY }, { a.alignmentZ, b.alignmentZ },
+            { a.cohesionX, b.cohesionX }, { a.cohesionY, b.cohesionY },
+            { a.cohesionZ, b.cohesionZ },
+            { (float) a.neighbors, (float) b.neighbors }
+        };
+
+        float error = 0.0;
+        for(size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); ++i)
+            error = std::max(error, std::fabs(pairs[i][0] - pairs[i][1])
+                    / std::max(1.0f, std::fabs(pairs[i][0])));
+        return error;
+    }
+
+    /// Prints the speed up and error of a SIMD kernel.
+    std::string simdExtra(double scalarSeconds, double simdSeconds,
+            float error) {
+        std::stringstream extra;
+        extra << "  " << simd::InstructionSet << " " << std::fixed
+            << std::setprecision(2) << scalarSeconds / simdSeconds
+            << "x faster than scalar, error " << std::scientific
+            << std::setprecision(1) << error;
+        return extra.str();
+    }
+
+    /**
+     * Compares the SIMD kernels with their scalar references, in speed and
+     * in results. The flockmates kernel runs for every boid of a settled
+     * flock, with the candidates found beforehand, so only the kernel is
+     * measured.
+     **/
+    void benchmarkKernels(const Options &options) {
+        const float dt = 1.0 / SimulationTickRate;
+
+        for(size_t s = 0; s < options.sizes.size(); ++s) {
+            ObjectiveBoid leader = createLeader();
+            BoidStore boids;
+            SpatialGrid grid(SpatialGridCellSize);
+            ThreadPool pool(1);
+            World world(pool);
+            FlockingSystem &flocking = world.getFlockingSystem();
+            createFlock(leader, boids, options.sizes[s]);
+
+            for(unsigned i = 0; i < WarmUpTicks; ++i) {
+                moveLeader(leader, dt);
+                updateGrid(grid, boids);
+                flocking.flock(pool, leader, boids, grid, dt);
+            }
+            updateGrid(grid, boids);
+
+            // The boids in the order of the grid, and their candidates.
+            size_t size = boids.size();
+            std::vector<float> x(size), y(size), z(size);
+            std::vector<float> vx(size), vy(size), vz(size);
+            grid.gather(boids.px(), &x[0]);
+            grid.gather(boids.py(), &y[0]);
+            grid.gather(boids.pz(), &z[0]);
+            grid.gather(boids.vx(), &vx[0]);
+            grid.gather(boids.vy(), &vy[0]);
+            grid.gather(boids.vz(), &vz[0]);
+            simd::Particles sorted = { &x[0], &y[0], &z[0], &vx[0], &vy[0],
+                &vz[0] };
+
+            std::vector<unsigned> candidates;
+            std::vector<size_t> begin(size + 1);
+            for(size_t p = 0; p < size; ++p) {
+                begin[p] = candidates.size();
+                grid.findCandidates(x[p], y[p], z[p], FlockingNeighborRadius,
+                        candidates);
+            }
+            begin[size] = candidates.size();
+            candidates.resize(candidates.size() + simd::Width - 1, 0);
+
+            std::vector<simd::FlockmateSums> scalarSums(size), simdSums(size);
+            double start = now();
+            for(unsigned i = 0; i < options.ticks; ++i)
+                for(size_t p = 0; p < size; ++p)
+                    simd::sumFlockmatesScalar(sorted, &candidates[begin[p]],
+                            begin[p + 1] - begin[p], x[p], y[p], z[p],
+                            FlockingNeighborRadius, FlockingSeparationRadius,
+                            scalarSums[p]);
+            double scalarSeconds = now() - start;
+
+            start = now();
+            for(unsigned i = 0; i < options.ticks; ++i)
+                for(size_t p = 0; p < size; ++p)
+                    simd::sumFlockmates(sorted, &candidates[begin[p]],
+                            begin[p + 1] - begin[p], x[p], y[p], z[p],
+                            FlockingNeighborRadius, FlockingSeparationRadius,
+                            simdSums[p]);
+            double simdSeconds = now() - start;
+
+            float error = 0.0;
+            for(size_t p = 0; p < size; ++p)
+                error = std::max(error, sumsError(scalarSums[p], simdSums[p]));
+
+            report("flockmates", size, options.ticks, simdSeconds,
+                    simdExtra(scalarSeconds, simdSeconds, error));
+
+            // Integrate two copies of the flock with the same accelerations.
+            BoidStore scalarBoids, simdBoids;
+            createFlock(leader, scalarBoids, size);
+            createFlock(leader, simdBoids, size);
+            size_t padded = (size + BoidStore::Padding - 1)
+                / BoidStore::Padding * BoidStore::Padding;
+            std::vector<float> ax(padded, 0.0f), ay(padded, 0.0f),
+                az(padded, 0.0f);
+            for(size_t i = 0; i < size; ++i) {
+                ax[i] = std::sin(i * 0.1f) * BoidMaxForce;
+                ay[i] = std::cos(i * 0.3f) * BoidMaxForce;
+                az[i] = std::sin(i * 0.7f) * BoidMaxForce;
+            }
+
+            start = now();
+            for(unsigned i = 0; i < options.ticks; ++i) {
+                simd::integrateScalar(scalarBoids, &ax[0], &ay[0], &az[0], 0,
+                        size, dt, BoidMaxSpeed);
+                scalarBoids.swapBuffers();
+            }
+            scalarSeconds = now() - start;
+
+            start = now();
+            for(unsigned i = 0; i < options.ticks; ++i) {
+                simd::integrate(simdBoids, &ax[0], &ay[0], &az[0], 0, size,
+                        dt, BoidMaxSpeed);
+                simdBoids.swapBuffers();
+            }
+            simdSeconds = now() - start;
+
+            error = 0.0;
+            for(size_t i = 0; i < size; ++i)
+                error = std::max(error, std::fabs(scalarBoids.px()[i]
+                            - simdBoids.px()[i]) / std::max(1.0f,
+                            std::fabs(scalarBoids.px()[i])));
+
+            report("integrate", size, options.ticks, simdSeconds,
+                    simdExtra(scalarSeconds, simdSeconds, error));
+
+            // Keep two copies of the flock, which starts in the tower, out
+            // of it.
+            const simd::Cone tower = { 0.0f, 0.0f, TowerBaseRadius,
+                TowerHeight };
+            createFlock(leader, scalarBoids, size);
+            createFlock(leader, simdBoids, size);
+
+            start = now();
+            for(unsigned i = 0; i < options.ticks; ++i)
+                simd::avoidConeScalar(scalarBoids, tower, 0, size,
+                        TowerClearance, TowerLookahead, BoidMaxForce * dt,
+                        BoidMaxSpeed);
+            scalarSeconds = now() - start;
+
+            start = now();
+            for(unsigned i = 0; i < options.ticks; ++i)
+                simd::avoidCone(simdBoids, tower, 0, size, TowerClearance,
+                        TowerLookahead, BoidMaxForce * dt, BoidMaxSpeed);
+            simdSeconds = now() - start;
+
+            error = 0.0;
+            for(size_t i = 0; i < size; ++i)
+                error = std::max(error, std::fabs(scalarBoids.vx()[i]
+                            - simdBoids.vx()[i]) / std::max(1.0f,
+                            std::fabs(scalarBoids.vx()[i])));
+
+            report("cone", size, options.ticks, simdSeconds,
+                    simdExtra(scalarSeconds, simdSeconds, error));
+        }
+    }
+
+    /// All the benchmarks.
+    const Benchmark benchmarks[] = {
+        { "grid", benchmarkGrid },
+        { "flocking", benchmarkFlocking },
+        { "lists", benchmarkLists },
+        { "nearest", benchmarkNearest },
+        { "lod", benchmarkLod },
+        { "reorder", benchmarkReorder },
+        { "tower", benchmarkTower },
+        { "obstacles", benchmarkObstacles },
+        { "flocks", benchmarkFlocks },
+        { "barneshut", benchmarkBarnesHut },
+        { "kernels", benchmarkKernels }
+    };
+
+    /// Number of benchmarks.
+    const size_t numBenchmarks = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+    /**
+     * Parses a comma separated list of numbers.
+     * @param allowZero If the numbers may be 0.
+     **/
+    bool parseList(const char *arg, std::vector<size_t> &list,
+            bool allowZero) {
+        std::stringstream stream(arg);
+        std::string item;
+
+        list.clear();
+        while(std::getline(stream, item, ',')) {
+            char *end;
+            size_t number = std::strtoul(item.c_str(), &end, 10);
+            if(item.empty() || *end || (!number && !allowZero))
+                return false;
+            list.push_back(number);
+        }
+
+        return !list.empty();
+    }
+
+    /// Prints the usage.
+    int usage(const char *program) {
+        std::cerr << "Usage: " << program
+            << " [-t ticks] [-n boids[,boids...]] [-j threads[,threads...]]"
+            << " [benchmark...]" << std::endl
+            << "Benchmarks:";
+        for(size_t i = 0; i < numBenchmarks; ++i)
+            std::cerr << " " << benchmarks[i].name;
+        std::cerr << std::endl;
+        return 1;
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    std::vector<const Benchmark *> selected;
+
+    for(int i = 1; i < argc; ++i) {
+        if(!std::strcmp(argv[i], "-t") && i + 1 < argc) {
+            options.ticks = std::strtoul(argv[++i], NULL, 10);
+            if(!options.ticks)
+                return usage(argv[0]);
+        }
+        else if(!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+            if(!parseList(argv[++i], options.sizes, false))
+                return usage(argv[0]);
+        }
+        else if(!std::strcmp(argv[i], "-j") && i + 1 < argc) {
+            if(!parseList(argv[++i], options.threads, true))
+                return usage(argv[0]);
+        }
+        else {
+            size_t b = 0;
+            while(b < numBenchmarks && std::strcmp(argv[i], benchmarks[b].name))
+                ++b;
+            if(b == numBenchmarks)
+                return usage(argv[0]);
+            selected.push_back(&benchmarks[b]);
+        }
+    }
+
+    // Run all the benchmarks if none was chosen.
+    if(selected.empty())
+        for(size_t i = 0; i < numBenchmarks; ++i)
+            selected.push_back(&benchmarks[i]);
+
+    for(size_t i = 0; i < selected.size(); ++i)
+        selected[i]->function(options);
+
+    return 0;
+}
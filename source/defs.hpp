@@ -142,6 +142,10 @@ const float ObjectiveBoidInitialSpeed = 30.0;
 /// Maximum distance a boid can be from other when being added.
 const float NewBoidMaximumDistance = 20.0;
 
+/// Candidate positions tried around a boid before deciding that no new boid
+/// fits next to it.
+const int NewBoidAttempts = 30;
+
 /// Maximum boid speed.
 const float BoidMaxSpeed = 100.0;
 
@@ -149,6 +153,111 @@ const float BoidMaxSpeed = 100.0;
 /// boids won't enter.
 const float BoidSpace = BoidBodyRadius + BoidWingHeight + 5.0;
 
+/// Number of simulation ticks per second. The engine advances the game in
+/// fixed steps of 1 / SimulationTickRate seconds.
+const int SimulationTickRate = 100;
+
+/// Most time, in seconds, a frame of the window catches up on. The time of
+/// slower frames is dropped, so the ticks don't fall further and further
+/// behind. No tick may be longer.
+const float MaxFrameTime = 0.25;
+
+/// When the length of the ticks adapts to the speed of the boids, the part
+/// of the space of a boid the fastest boid flies in a tick.
+const float AdaptiveCourantNumber = 0.05;
+
+/// Shortest and longest tick, in seconds, when the length of the ticks adapts
+/// to the speed of the boids and no other is given.
+const float AdaptiveMinTickLength = 0.0025;
+const float AdaptiveMaxTickLength = 0.04;
+
+/// Radius around a follow boid inside which other follow boids are seen as
+/// flockmates (used by alignment and cohesion).
+const float FlockingNeighborRadius = 2 * BoidSpace;
+
+/// Distance below which flockmates start pushing each other away.
+const float FlockingSeparationRadius = 1.5 * BoidSpace;
+
+/// Size of the side of the cells of the spatial grid that finds the boids
+/// close to each other.
+const float SpatialGridCellSize = 2 * BoidSpace;
+
+/// Skin of the neighbor lists, when they are used (see NeighborList): how far
+/// the boids can move between two builds of the lists.
+const float NeighborListSkin = 0.25 * FlockingNeighborRadius;
+
+/// Number of nearest boids that are the flockmates of a follow boid, when the
+/// flocking is topological instead of inside FlockingNeighborRadius.
+const unsigned FlockingTopologicalNeighbors = 7;
+
+/// Number of ticks between two reorders of the follow boids in memory, along
+/// a Morton curve of their positions. The flock changes shape slowly, so the
+/// order stays good for a while.
+const unsigned BoidReorderInterval = 50;
+
+/// How far behind the objective boid the follow boids try to stay.
+const float FlockingLeaderDistance = 3 * BoidSpace;
+
+/// Weight of the separation rule.
+const float FlockingSeparationWeight = 150.0;
+
+/// Weight of the alignment rule.
+const float FlockingAlignmentWeight = 2.0;
+
+/// Weight of the cohesion rule.
+const float FlockingCohesionWeight = 1.0;
+
+/// Weight of the leader seeking rule.
+const float FlockingLeaderWeight = 2.0;
+
+/// Weight of the far cohesion rule, which steers the follow boids towards the
+/// centroid of their whole flock weighted by distance, when it is on.
+const float FlockingFarCohesionWeight = 0.5;
+
+/// Distance added to the weights of the far cohesion, so the closest boids,
+/// already pulled by the cohesion rule, don't take over.
+const float FarCohesionSoftening = FlockingNeighborRadius;
+
+/// How fast (per second) the follow boids close in on the point behind the
+/// objective boid, on top of flying like it.
+const float FlockingLeaderGain = 0.3;
+
+/// Maximum acceleration the flocking rules can apply to a follow boid.
+const float BoidMaxForce = 400.0;
+
+/// Distance to the tower below which the follow boids turn away from it.
+const float TowerClearance = 2 * BoidSpace;
+
+/// How far ahead, in seconds, the follow boids look for the tower.
+const float TowerLookahead = 1.0;
+
+/// Size of the side of the cells of the distance field of the obstacles.
+const float ObstacleFieldCellSize = 10.0;
+
+/// Smallest and largest radius of the base of the obstacles.
+const float ObstacleMinRadius = 20.0;
+const float ObstacleMaxRadius = 60.0;
+
+/// Smallest and largest height of the obstacles.
+const float ObstacleMinHeight = 100.0;
+const float ObstacleMaxHeight = 400.0;
+
+/// Distance to an obstacle below which the follow boids turn away from it.
+const float ObstacleClearance = TowerClearance;
+
+/// How far ahead, in seconds, the follow boids look for the obstacles.
+const float ObstacleLookahead = TowerLookahead;
+
+/// File where the distance field of the obstacles is kept between runs.
+const char *const ObstacleCacheFile = "obstacles.sdf";
+
+/// How fast, in radians per second, the leaders of the other flocks turn
+/// towards their waypoints.
+const float LeaderTurnRate = 0.8;
+
+/// Distance to its waypoint at which a leader chooses the next one.
+const float LeaderWaypointReach = 100.0;
+
 /// Sensitivity of the objective boid to the keys.
 const float DefaultObjectiveBoidKeySensitivity = 50.0;
 
@@ -180,9 +289,24 @@ const int CurvedShapeFidelity = 50;
 /// The angle the wings will make in each swing.
 const float WingAngle = 100.0;
 
+/// How many display lists the wings of the follow boids advance per second.
+const float WingFlapRate = SimulationTickRate;
+
+/// Updates per second of the animation system. The wings don't need the
+/// rate of the simulation to look smooth.
+const unsigned AnimationRate = 30;
+
+/// Length of a full flap of the wings of the follow boids, in display lists:
+/// up through all of them and down again.
+const int WingCycle = 2 * (NumBoidDisplayLists - 1);
+
 /// How many boids to reserve in advance.
 const int ReservedBoids = 50;
 
+/// Number of boids in each chunk of the parallel loops of the systems. A
+/// multiple of BoidStore::Padding, so the SIMD loops get whole registers.
+const unsigned BoidsPerChunk = 512;
+
 /// How many initial boids.
 const int InitialBoidCount = 5;
 
@@ -338,11 +462,16 @@ const float FogStart = 200.0;
 /// Fog end depth.
 const float FogEnd = 500.0;
 
+/// Distance to the camera within which the follow boids are flocked every
+/// tick, when the level of detail is on. Each time the distance doubles, they
+/// are flocked half as often.
+const float LodNearDistance = FogStart;
+
+/// The follow boids far from the camera are flocked at least once every
+/// 2^LodMaxLevel ticks.
+const int LodMaxLevel = 4;
+
 /// Key to toggle fog.
 const int ToggleFogKey = GLFW_KEY_F;
 
-/// Toggles the different orders of rotation and translation
-/// of the boids. Use 1 and 0.
-#define BOIDS_ROTATE_AFTER 1
-
 #endif // !DEFS_HPP
@@ -0,0 +1,267 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "BoidStore.hpp"
+#include "../util/aligned.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    /**
+     * Moves the array to a new one with the given capacity, zeroing the new
+     * space.
+     **/
+    void reallocate(float *&array, size_t size, size_t capacity) {
+        float *newArray = (float *) util::alignedAlloc(capacity * sizeof(float));
+        if(size)
+            std::memcpy(newArray, array, size * sizeof(float));
+        std::fill(newArray + size, newArray + capacity, 0.0f);
+
+        util::alignedFree(array);
+        array = newArray;
+    }
+}
+
+BoidStore::BoidStore()
+        : _size(0), _capacity(0), _px(0), _py(0), _pz(0), _vx(0), _vy(0),
+        _vz(0), _speed(0), _wing(0), _previousPx(0), _previousPy(0),
+        _previousPz(0), _previousVx(0), _previousVy(0), _previousVz(0),
+        _swapped(false), _freeSlot(~0u), _version(0) {
+    grow(Padding);
+}
+
+BoidStore::~BoidStore() {
+    util::alignedFree(_px);
+    util::alignedFree(_py);
+    util::alignedFree(_pz);
+    util::alignedFree(_vx);
+    util::alignedFree(_vy);
+    util::alignedFree(_vz);
+    util::alignedFree(_speed);
+    util::alignedFree(_wing);
+    util::alignedFree(_previousPx);
+    util::alignedFree(_previousPy);
+    util::alignedFree(_previousPz);
+    util::alignedFree(_previousVx);
+    util::alignedFree(_previousVy);
+    util::alignedFree(_previousVz);
+}
+
+void BoidStore::grow(size_t capacity) {
+    // Round up to the padding.
+    capacity = (capacity + Padding - 1) / Padding * Padding;
+
+    reallocate(_px, _size, capacity);
+    reallocate(_py, _size, capacity);
+    reallocate(_pz, _size, capacity);
+    reallocate(_vx, _size, capacity);
+    reallocate(_vy, _size, capacity);
+    reallocate(_vz, _size, capacity);
+    reallocate(_speed, _size, capacity);
+    reallocate(_wing, _size, capacity);
+    reallocate(_previousPx, _size, capacity);
+    reallocate(_previousPy, _size, capacity);
+    reallocate(_previousPz, _size, capacity);
+    reallocate(_previousVx, _size, capacity);
+    reallocate(_previousVy, _size, capacity);
+    reallocate(_previousVz, _size, capacity);
+    _slotOf.resize(capacity);
+    _capacity = capacity;
+}
+
+BoidHandle BoidStore::add(const Point &position, const Vector &velocity,
+        float wingPhase) {
+    // Double the capacity when full. The padding must stay free.
+    if(_size == _capacity)
+        grow(2 * _capacity);
+
+    size_t i = _size++;
+    ++_version;
+    _px[i] = toFloat(position.x);
+    _py[i] = toFloat(position.y);
+    _pz[i] = toFloat(position.z);
+    _vx[i] = toFloat(velocity.x);
+    _vy[i] = toFloat(velocity.y);
+    _vz[i] = toFloat(velocity.z);
+    _wing[i] = wingPhase;
+    updateSpeed(i);
+
+    // A new boid has no previous tick: it stays in place until the next one.
+    _previousPx[i] = toFloat(position.x);
+    _previousPy[i] = toFloat(position.y);
+    _previousPz[i] = toFloat(position.z);
+    _previousVx[i] = toFloat(velocity.x);
+    _previousVy[i] = toFloat(velocity.y);
+    _previousVz[i] = toFloat(velocity.z);
+
+    // Take a free slot, or a new one if none is free.
+    uint32_t slot = _freeSlot;
+    if(slot != ~0u) {
+        _freeSlot = _slots[slot].index;
+    }
+    else {
+        slot = _slots.size();
+        Slot newSlot = { 0, 0 };
+        _slots.push_back(newSlot);
+    }
+    _slots[slot].index = i;
+    _slotOf[i] = slot;
+
+    return BoidHandle(slot, _slots[slot].generation);
+}
+
+void BoidStore::removeAt(size_t i) {
+    float *arrays[] = { _px, _py, _pz, _vx, _vy, _vz, _speed, _wing,
+        _previousPx, _previousPy, _previousPz, _previousVx, _previousVy,
+        _previousVz };
+    size_t last = _size - 1;
+    ++_version;
+
+    // Move the last boid to the index and zero the space left at the end.
+    for(size_t a = 0; a < sizeof(arrays) / sizeof(arrays[0]); ++a) {
+        arrays[a][i] = arrays[a][last];
+        arrays[a][last] = 0.0f;
+    }
+
+    // The last boid keeps its slot.
+    uint32_t slot = _slotOf[i];
+    _slotOf[i] = _slotOf[last];
+    _slots[_slotOf[i]].index = i;
+
+    // Invalidate the handles of the boid and free its slot.
+    freeSlot(slot);
+
+    --_size;
+}
+
+size_t BoidStore::removeMarked(const unsigned char *marked) {
+    float *arrays[] = { _px, _py, _pz, _vx, _vy, _vz, _speed, _wing,
+        _previousPx, _previousPy, _previousPz, _previousVx, _previousVy,
+        _previousVz };
+    const size_t numArrays = sizeof(arrays) / sizeof(arrays[0]);
+
+    // Move each kept boid back over the removed ones before it.
+    size_t kept = 0;
+    for(size_t i = 0; i < _size; ++i) {
+        uint32_t slot = _slotOf[i];
+        if(marked[i]) {
+            freeSlot(slot);
+            continue;
+        }
+
+        if(kept != i) {
+            for(size_t a = 0; a < numArrays; ++a)
+                arrays[a][kept] = arrays[a][i];
+            _slotOf[kept] = slot;
+            _slots[slot].index = kept;
+        }
+        ++kept;
+    }
+
+    // Zero the space left at the end.
+    for(size_t a = 0; a < numArrays; ++a)
+        std::fill(arrays[a] + kept, arrays[a] + _size, 0.0f);
+
+    size_t removed = _size - kept;
+    if(removed)
+        ++_version;
+    _size = kept;
+    return removed;
+}
+
+void BoidStore::clear() {
+    float *arrays[] = { _px, _py, _pz, _vx, _vy, _vz, _speed, _wing,
+        _previousPx, _previousPy, _previousPz, _previousVx, _previousVy,
+        _previousVz };
+
+    for(size_t a = 0; a < sizeof(arrays) / sizeof(arrays[0]); ++a)
+        std::fill(arrays[a], arrays[a] + _size, 0.0f);
+
+    // Free the slots of the boids.
+    for(size_t i = 0; i < _size; ++i)
+        freeSlot(_slotOf[i]);
+
+    _size = 0;
+    ++_version;
+}
+
+void BoidStore::permute(const unsigned *order) {
+    float **arrays[] = { &_px, &_py, &_pz, &_vx, &_vy, &_vz, &_speed,
+        &_wing, &_previousPx, &_previousPy, &_previousPz, &_previousVx,
+        &_previousVy, &_previousVz };
+    ++_version;
+
+    // Gather each array into the scratch array and swap them. The space past
+    // the boids stays zeroed in both.
+    float *scratch = (float *) util::alignedAlloc(_capacity * sizeof(float));
+    std::fill(scratch + _size, scratch + _capacity, 0.0f);
+    for(size_t a = 0; a < sizeof(arrays) / sizeof(arrays[0]); ++a) {
+        float *array = *arrays[a];
+        for(size_t i = 0; i < _size; ++i)
+            scratch[i] = array[order[i]];
+        *arrays[a] = scratch;
+        scratch = array;
+    }
+    util::alignedFree(scratch);
+
+    // The slots follow the boids.
+    std::vector<uint32_t> slotOf(_slotOf.begin(), _slotOf.begin() + _size);
+    for(size_t i = 0; i < _size; ++i) {
+        _slotOf[i] = slotOf[order[i]];
+        _slots[_slotOf[i]].index = i;
+    }
+}
+
+void BoidStore::reserve(size_t capacity) {
+    if(capacity > _capacity)
+        grow(capacity);
+}
+
+void BoidStore::swapBuffers() {
+    std::swap(_px, _previousPx);
+    std::swap(_py, _previousPy);
+    std::swap(_pz, _previousPz);
+    std::swap(_vx, _previousVx);
+    std::swap(_vy, _previousVy);
+    std::swap(_vz, _previousVz);
+    _swapped = true;
+}
+
+void BoidStore::endTick() {
+    if(_swapped) {
+        _swapped = false;
+        return;
+    }
+
+    size_t bytes = _size * sizeof(float);
+    std::memcpy(_previousPx, _px, bytes);
+    std::memcpy(_previousPy, _py, bytes);
+    std::memcpy(_previousPz, _pz, bytes);
+    std::memcpy(_previousVx, _vx, bytes);
+    std::memcpy(_previousVy, _vy, bytes);
+    std::memcpy(_previousVz, _vz, bytes);
+}
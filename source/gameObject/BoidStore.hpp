@@ -0,0 +1,332 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef GAMEOBJECT_BOIDSTORE_HPP
+#define GAMEOBJECT_BOIDSTORE_HPP
+
+#include "../math/Point.hpp"
+#include "../math/Vector.hpp"
+#include "../util/Noncopyable.hpp"
+#include <cmath>
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+class FollowBoid;
+
+/**
+ * Stable handle of a boid of a BoidStore. Unlike the index of the boid, it
+ * stays valid while other boids are added and removed, and is only
+ * invalidated when its boid is removed: the slot it points to is then reused
+ * with another generation.
+ **/
+struct BoidHandle {
+    /// Slot of the boid in the store.
+    uint32_t slot;
+
+    /// Generation of the slot when the handle was created.
+    uint32_t generation;
+
+    /// The default handle is never valid.
+    BoidHandle() : slot(~0u), generation(0) {
+
+    }
+
+    BoidHandle(uint32_t slot, uint32_t generation)
+            : slot(slot), generation(generation) {
+
+    }
+
+    inline bool operator==(const BoidHandle &other) const {
+        return slot == other.slot && generation == other.generation;
+    }
+
+    inline bool operator!=(const BoidHandle &other) const {
+        return !(*this == other);
+    }
+};
+
+/**
+ * Stores the follow boids as a structure of arrays: one aligned float array
+ * for each component of the boids, so the systems only stream the components
+ * they use, and can process many boids per SIMD instruction.
+ * The arrays are aligned to util::MemoryAlignment and their capacity is a
+ * multiple of BoidStore::Padding, with the unused space zeroed, so SIMD loops
+ * can run until size() rounded up to Padding.
+ * The positions and velocities are double buffered. During a tick, the
+ * current buffers hold the state at the start of the tick, and the
+ * integration reads only them and writes the whole state at the end of the
+ * tick into the next buffers; swapBuffers() then makes them the current
+ * ones. The old current buffers become the previous ones, which the render
+ * interpolates from. No pass reads what another boid writes in it, so the
+ * chunks need no locks, and no copy of the state is needed per tick.
+ * FollowBoid is a view of one of the boids, for the code that prefers to
+ * handle one boid at a time.
+ * The boids are dense in the arrays, and a removal moves the last boid to
+ * the removed index. The indices change, so code that tracks a boid across
+ * additions and removals holds a BoidHandle: a generational slot map keeps
+ * the index of each handle, with O(1) addition, removal and lookup. The
+ * handles also survive permute(), which reorders the boids in memory.
+ **/
+class BoidStore : public NonCopyable {
+public:
+    /// The capacity is always a multiple of this number of boids.
+    static const size_t Padding = 8;
+
+private:
+    /// Number of boids.
+    size_t _size;
+
+    /// Number of boids the arrays can hold.
+    size_t _capacity;
+
+    /// Position.
+    float *_px, *_py, *_pz;
+
+    /// Velocity.
+    float *_vx, *_vy, *_vz;
+
+    /// Module of the velocity.
+    float *_speed;
+
+    /// Phase of the wings, in display lists. See AnimationSystem.
+    float *_wing;
+
+    /**
+     * Position and velocity at the end of the previous tick, which are also
+     * the next buffers during a tick.
+     **/
+    float *_previousPx, *_previousPy, *_previousPz;
+    float *_previousVx, *_previousVy, *_previousVz;
+
+    /// If the buffers were swapped since the last endTick().
+    bool _swapped;
+
+    /// A slot of the slot map.
+    struct Slot {
+        /**
+         * Index of the boid of the slot, or the next free slot if the slot is
+         * free.
+         **/
+        uint32_t index;
+
+        /// Incremented each time the boid of the slot is removed.
+        uint32_t generation;
+    };
+
+    /// Slots of the handles.
+    std::vector<Slot> _slots;
+
+    /// Slot of the boid at each index.
+    std::vector<uint32_t> _slotOf;
+
+    /// First free slot, or ~0u if no slot is free.
+    uint32_t _freeSlot;
+
+    /**
+     * Incremented each time boids are added or removed, so the caches of the
+     * indices of the boids can tell when they are stale.
+     **/
+    uint32_t _version;
+
+    /// Grows the capacity of the arrays to at least capacity boids.
+    void grow(size_t capacity);
+
+    /// Invalidates the handles of the slot and adds it to the free slots.
+    inline void freeSlot(uint32_t slot) {
+        ++_slots[slot].generation;
+        _slots[slot].index = _freeSlot;
+        _freeSlot = slot;
+    }
+
+public:
+    BoidStore();
+    ~BoidStore();
+
+    /**
+     * Adds a boid at the end of the arrays, at index size() - 1.
+     * @return The handle of the new boid.
+     **/
+    BoidHandle add(const Point &position, const Vector &velocity,
+            float wingPhase);
+
+    /**
+     * Removes the boid at the given index, moving the last boid to it. The
+     * handles of the other boids stay valid.
+     **/
+    void removeAt(size_t i);
+
+    /// Removes the boid of the handle, which must be valid.
+    inline void remove(BoidHandle handle) {
+        removeAt(indexOf(handle));
+    }
+
+    /**
+     * Removes the boids whose mark is not zero, in one pass. The other boids
+     * keep their order and their handles.
+     * @param marked One mark for each boid.
+     * @return The number of boids removed.
+     **/
+    size_t removeMarked(const unsigned char *marked);
+
+    /// Removes all the boids, invalidating all the handles.
+    void clear();
+
+    /**
+     * Reorders the boids: the boid at index order[i] moves to index i, in
+     * all the arrays at once. The handles follow their boids.
+     * @param order A permutation of the indices of the boids.
+     **/
+    void permute(const unsigned *order);
+
+    /// Reserves space for capacity boids.
+    void reserve(size_t capacity);
+
+    /**
+     * Swaps the current and the next buffers, once the next buffers hold the
+     * positions and velocities of all the boids at the end of the tick. The
+     * state at the start of the tick becomes the previous state.
+     **/
+    void swapBuffers();
+
+    /**
+     * Ends the tick. If no integration swapped the buffers in it, the boids
+     * didn't move, so the current state is also the previous one.
+     **/
+    void endTick();
+
+    /**
+     * Recalculates the speed of the boid from its velocity.
+     * Must be called after changing the velocity of a boid by hand.
+     **/
+    inline void updateSpeed(size_t i) {
+        _speed[i] = std::sqrt(_vx[i] * _vx[i] + _vy[i] * _vy[i]
+                + _vz[i] * _vz[i]);
+    }
+
+    /// Returns a view of the boid at the given index.
+    inline FollowBoid operator[](size_t i);
+
+    /// Returns a view of the boid of the handle, which must be valid.
+    inline FollowBoid operator[](BoidHandle handle);
+
+    /// Returns if the handle is of a boid that is still in the store.
+    inline bool contains(BoidHandle handle) const {
+        return handle.slot < _slots.size()
+            && _slots[handle.slot].generation == handle.generation;
+    }
+
+    /// Returns the index of the boid of the handle, which must be valid.
+    inline size_t indexOf(BoidHandle handle) const {
+        return _slots[handle.slot].index;
+    }
+
+    /// Returns the handle of the boid at the given index.
+    inline BoidHandle handleAt(size_t i) const {
+        uint32_t slot = _slotOf[i];
+        return BoidHandle(slot, _slots[slot].generation);
+    }
+
+    /// Returns the number of boids.
+    inline size_t size() const {
+        return _size;
+    }
+
+    /// Returns the number of boids that fit before the arrays grow.
+    inline size_t capacity() const {
+        return _capacity;
+    }
+
+    /// Returns if there are no boids.
+    inline bool empty() const {
+        return !_size;
+    }
+
+    /// Returns the version of the indices of the boids (see _version).
+    inline uint32_t getVersion() const {
+        return _version;
+    }
+
+    /// Position in the x axis.
+    inline float *px() { return _px; }
+    inline const float *px() const { return _px; }
+
+    /// Position in the y axis.
+    inline float *py() { return _py; }
+    inline const float *py() const { return _py; }
+
+    /// Position in the z axis.
+    inline float *pz() { return _pz; }
+    inline const float *pz() const { return _pz; }
+
+    /// Velocity in the x axis.
+    inline float *vx() { return _vx; }
+    inline const float *vx() const { return _vx; }
+
+    /// Velocity in the y axis.
+    inline float *vy() { return _vy; }
+    inline const float *vy() const { return _vy; }
+
+    /// Velocity in the z axis.
+    inline float *vz() { return _vz; }
+    inline const float *vz() const { return _vz; }
+
+    /// Module of the velocity.
+    inline float *speed() { return _speed; }
+    inline const float *speed() const { return _speed; }
+
+    /// Phase of the wings.
+    inline float *wing() { return _wing; }
+    inline const float *wing() const { return _wing; }
+
+    /**
+     * Next buffers, where the integration writes the positions and
+     * velocities at the end of the tick. They hold the previous state until
+     * then.
+     **/
+    inline float *nextPx() { return _previousPx; }
+    inline float *nextPy() { return _previousPy; }
+    inline float *nextPz() { return _previousPz; }
+    inline float *nextVx() { return _previousVx; }
+    inline float *nextVy() { return _previousVy; }
+    inline float *nextVz() { return _previousVz; }
+
+    /// Position at the end of the previous tick.
+    inline const float *previousPx() const { return _previousPx; }
+    inline const float *previousPy() const { return _previousPy; }
+    inline const float *previousPz() const { return _previousPz; }
+
+    /// Velocity at the end of the previous tick.
+    inline const float *previousVx() const { return _previousVx; }
+    inline const float *previousVy() const { return _previousVy; }
+    inline const float *previousVz() const { return _previousVz; }
+};
+
+// FollowBoid needs the complete BoidStore, and defines operator[].
+#include "FollowBoid.hpp"
+
+#endif // !GAMEOBJECT_BOIDSTORE_HPP
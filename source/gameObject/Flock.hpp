@@ -0,0 +1,127 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef GAMEOBJECT_FLOCK_HPP
+#define GAMEOBJECT_FLOCK_HPP
+
+#include "BoidStore.hpp"
+#include "FlockStats.hpp"
+#include "ObjectiveBoid.hpp"
+#include "../defs.hpp"
+#include "../spatial/KdTree.hpp"
+#include "../spatial/NeighborList.hpp"
+#include "../spatial/Octree.hpp"
+#include "../spatial/PlacementGrid.hpp"
+#include "../spatial/SpatialGrid.hpp"
+#include "../util/Noncopyable.hpp"
+#include <algorithm>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * A flock: a leader and the follow boids that follow it, with the structures
+ * the systems build over the boids every tick.
+ * The boids only flock with the boids of their own flock, so each flock has
+ * its own grid, neighbor lists and tree, and costs the same however many
+ * other flocks there are. The bounding box of its aggregates is the bounding
+ * volume the flocks are tested against each other with.
+ **/
+struct Flock : public NonCopyable {
+    /// The boid the flock follows.
+    ObjectiveBoid leader;
+
+    /// Point the leader flies to, when no one steers it.
+    Point waypoint;
+
+    /// The follow boids.
+    BoidStore boids;
+
+    /// Grid with the follow boids. See World::updateGrid().
+    SpatialGrid grid;
+
+    /// Neighbor lists of the follow boids. See World::updateNeighborList().
+    NeighborList neighborList;
+
+    /// Tree with the follow boids. See World::updateKdTree().
+    KdTree kdTree;
+
+    /// Octree with the follow boids. See World::updateOctree().
+    Octree octree;
+
+    /// Grid of the leader and the follow boids, kept by World::addBoids()
+    /// between the boids added in the same tick.
+    PlacementGrid placement;
+
+    /// Points of the placement grid that may still have space around them.
+    std::vector<unsigned> placementActive;
+
+    /// Tick and version of the boids (see BoidStore::getVersion()) the
+    /// placement grid was left at.
+    uint32_t placementTick, placementVersion;
+
+    /// Aggregates of the follow boids, with their bounding box.
+    FlockStats stats;
+
+    /// Middle position of the follow boids, relative to the leader. This is
+    /// 0 when there is no boid.
+    Point middle;
+
+    /**
+     * Creates a flock with no follow boids.
+     * @param neighborRadius Radius inside which the boids are flockmates.
+     * @param boidSpace Radius of the sphere around a boid that other boids
+     * won't enter.
+     * @param skin Skin of the neighbor lists.
+     **/
+    Flock(float neighborRadius, float boidSpace, float skin)
+            : leader(0, true, Point(), ObjectiveBoidInitialSpeed,
+                    Vector(0.0, 0.0, -1.0)),
+            grid(neighborRadius),
+            neighborList(std::max(neighborRadius, boidSpace), skin),
+            placement(2 * boidSpace), placementTick(0), placementVersion(0) {
+
+    }
+
+    /// Updates the middle position from the centroid of the aggregates.
+    inline void updateMiddlePosition() {
+        Point centroid = stats.getCentroid();
+        if(stats.empty())
+            middle = Point(0.0, 0.0, 0.0);
+        else
+            middle = Point(centroid.x - leader.position.x,
+                    centroid.y - leader.position.y,
+                    centroid.z - leader.position.z);
+    }
+
+    /// Returns the middle absolute position of the follow boids.
+    inline Point getAbsoluteMiddlePosition() const {
+        return Point(leader.position.x + middle.x,
+                leader.position.y + middle.y, leader.position.z + middle.z);
+    }
+};
+
+#endif // !GAMEOBJECT_FLOCK_HPP
@@ -0,0 +1,117 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "FlockStats.hpp"
+#include "../defs.hpp"
+#include <limits>
+
+void FlockStats::Partial::clear() {
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    count = 0;
+    sumX = sumY = sumZ = 0.0;
+    sumVx = sumVy = sumVz = 0.0;
+    minX = minY = minZ = infinity;
+    maxX = maxY = maxZ = -infinity;
+    maxSpeed2 = 0.0;
+}
+
+void FlockStats::Partial::merge(const Partial &other) {
+    count += other.count;
+    sumX += other.sumX;
+    sumY += other.sumY;
+    sumZ += other.sumZ;
+    sumVx += other.sumVx;
+    sumVy += other.sumVy;
+    sumVz += other.sumVz;
+
+    if(other.minX < minX) minX = other.minX;
+    if(other.minY < minY) minY = other.minY;
+    if(other.minZ < minZ) minZ = other.minZ;
+    if(other.maxX > maxX) maxX = other.maxX;
+    if(other.maxY > maxY) maxY = other.maxY;
+    if(other.maxZ > maxZ) maxZ = other.maxZ;
+    if(other.maxSpeed2 > maxSpeed2) maxSpeed2 = other.maxSpeed2;
+}
+
+/**
+ * Calculates the aggregates of each chunk of the boids. Each chunk writes
+ * its own Partial, so the chunks are independent.
+ **/
+struct FlockStats::ChunkTask {
+    const BoidStore &boids;
+    Partial *partials;
+
+    ChunkTask(const BoidStore &_boids, Partial *_partials)
+        : boids(_boids), partials(_partials) {
+
+    }
+
+    void operator()(size_t begin, size_t end, unsigned) {
+        const float *px = boids.px(), *py = boids.py(), *pz = boids.pz();
+        const float *vx = boids.vx(), *vy = boids.vy(), *vz = boids.vz();
+
+        Partial &partial = partials[begin / BoidsPerChunk];
+        partial.clear();
+        for(size_t i = begin; i < end; ++i)
+            partial.add(px[i], py[i], pz[i], vx[i], vy[i], vz[i]);
+    }
+};
+
+FlockStats::FlockStats() {
+    _total.clear();
+}
+
+void FlockStats::update(const BoidStore &boids, ThreadPool &pool) {
+    size_t size = boids.size();
+    _partials.resize(ThreadPool::getNumChunks(0, size, BoidsPerChunk));
+
+    ChunkTask chunks(boids, _partials.empty() ? 0 : &_partials[0]);
+    pool.parallelFor(0, size, BoidsPerChunk, chunks);
+
+    // Combine the chunks in order, for the same sums with any number of
+    // threads.
+    _total.clear();
+    for(size_t c = 0; c < _partials.size(); ++c)
+        _total.merge(_partials[c]);
+}
+
+void FlockStats::remove(const Point &position, const Vector &velocity) {
+    // The last boid leaves nothing behind, not even rounding errors.
+    if(_total.count <= 1) {
+        _total.clear();
+        return;
+    }
+
+    --_total.count;
+    _total.sumX -= toFloat(position.x);
+    _total.sumY -= toFloat(position.y);
+    _total.sumZ -= toFloat(position.z);
+    _total.sumVx -= toFloat(velocity.x);
+    _total.sumVy -= toFloat(velocity.y);
+    _total.sumVz -= toFloat(velocity.z);
+}
@@ -0,0 +1,183 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef GAMEOBJECT_FLOCKSTATS_HPP
+#define GAMEOBJECT_FLOCKSTATS_HPP
+
+#include "BoidStore.hpp"
+#include "../math/Point.hpp"
+#include "../math/Vector.hpp"
+#include "../util/Noncopyable.hpp"
+#include "../util/ThreadPool.hpp"
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Aggregates of the follow boids: their number, the sums of their positions
+ * and velocities, their bounding box and their largest speed, from which
+ * come the centroid, the mean velocity and the minimum and maximum altitude.
+ * update() rescans the boids once per tick with a parallel reduction that
+ * combines the chunks in order, so the results are the same with any number
+ * of threads. Between two updates, add() and remove() keep the aggregates up
+ * to date as boids are spawned and despawned. A removal can't shrink the
+ * bounding box or the largest speed, so until the next update() they may be
+ * bigger than the ones of the flock, but never smaller.
+ **/
+class FlockStats : public NonCopyable {
+    /// Aggregates of a range of boids.
+    struct Partial {
+        /// Number of boids.
+        size_t count;
+
+        /// Sum of the positions.
+        double sumX, sumY, sumZ;
+
+        /// Sum of the velocities.
+        double sumVx, sumVy, sumVz;
+
+        /// Bounding box.
+        float minX, minY, minZ;
+        float maxX, maxY, maxZ;
+
+        /// Largest squared speed.
+        float maxSpeed2;
+
+        /// Empties the aggregates.
+        void clear();
+
+        /// Adds a boid to the aggregates.
+        inline void add(float x, float y, float z, float vx, float vy,
+                float vz) {
+            ++count;
+            sumX += x;
+            sumY += y;
+            sumZ += z;
+            sumVx += vx;
+            sumVy += vy;
+            sumVz += vz;
+
+            if(x < minX) minX = x;
+            if(y < minY) minY = y;
+            if(z < minZ) minZ = z;
+            if(x > maxX) maxX = x;
+            if(y > maxY) maxY = y;
+            if(z > maxZ) maxZ = z;
+
+            float speed2 = vx * vx + vy * vy + vz * vz;
+            if(speed2 > maxSpeed2) maxSpeed2 = speed2;
+        }
+
+        /// Adds the aggregates of other boids.
+        void merge(const Partial &other);
+    };
+
+    /// Calculates the aggregates of each chunk of the boids.
+    struct ChunkTask;
+
+    /// Aggregates of all the boids.
+    Partial _total;
+
+    /// Aggregates of each chunk, in the last update().
+    std::vector<Partial> _partials;
+
+public:
+    FlockStats();
+
+    /// Rescans the boids, replacing the aggregates with theirs.
+    void update(const BoidStore &boids, ThreadPool &pool);
+
+    /// Adds a boid that was spawned.
+    inline void add(const Point &position, const Vector &velocity) {
+        _total.add(toFloat(position.x), toFloat(position.y),
+                toFloat(position.z), toFloat(velocity.x), toFloat(velocity.y),
+                toFloat(velocity.z));
+    }
+
+    /// Removes a boid that was despawned.
+    void remove(const Point &position, const Vector &velocity);
+
+    /// Removes all the boids.
+    inline void clear() {
+        _total.clear();
+    }
+
+    /// Returns the number of boids.
+    inline size_t size() const {
+        return _total.count;
+    }
+
+    /// Returns if there are no boids.
+    inline bool empty() const {
+        return !_total.count;
+    }
+
+    /// Returns the centroid of the boids, or the origin if there is none.
+    inline Point getCentroid() const {
+        if(empty())
+            return Point();
+
+        return Point(_total.sumX / _total.count, _total.sumY / _total.count,
+                _total.sumZ / _total.count);
+    }
+
+    /// Returns the largest speed of the boids, or zero if there is none.
+    inline float getMaxSpeed() const {
+        return std::sqrt(_total.maxSpeed2);
+    }
+
+    /// Returns the mean velocity of the boids, or zero if there is none.
+    inline Vector getMeanVelocity() const {
+        if(empty())
+            return Vector();
+
+        return Vector(_total.sumVx / _total.count,
+                _total.sumVy / _total.count, _total.sumVz / _total.count);
+    }
+
+    /// Returns the minimum corner of the bounding box of the boids.
+    inline Point getMin() const {
+        return Point(_total.minX, _total.minY, _total.minZ);
+    }
+
+    /// Returns the maximum corner of the bounding box of the boids.
+    inline Point getMax() const {
+        return Point(_total.maxX, _total.maxY, _total.maxZ);
+    }
+
+    /// Returns the altitude of the lowest boid, or +infinity if there is none.
+    inline float getMinAltitude() const {
+        return _total.minY;
+    }
+
+    /// Returns the altitude of the highest boid, or -infinity if there is none.
+    inline float getMaxAltitude() const {
+        return _total.maxY;
+    }
+};
+
+#endif // !GAMEOBJECT_FLOCKSTATS_HPP
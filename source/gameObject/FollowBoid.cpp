@@ -26,17 +26,12 @@
  */
 
 #include "FollowBoid.hpp"
-#include "../Engine.hpp"
+#include "Boid.hpp"
 
 
-Point FollowBoid::getAbsolutePosition() const {
-    Point abs = getEngine().getObjectiveBoid().position;
-    abs.x += position.x;
-    abs.y += position.y;
-    abs.z += position.z;
-    return abs;
-}
-
-Point FollowBoid::getRelativePosition() const {
-    return position;
+Point FollowBoid::getRelativePosition(const Boid &leader) const {
+    Point position = getPosition();
+    Point objective = leader.position;
+    return Point(position.x - objective.x, position.y - objective.y,
+            position.z - objective.z);
 }
@@ -28,33 +28,140 @@
 #ifndef GAMEOBJECT_FOLLOWBOID_HPP
 #define GAMEOBJECT_FOLLOWBOID_HPP
 
-#include "Boid.hpp"
+#include "BoidStore.hpp"
+#include "../math/Point.hpp"
+#include "../math/Vector.hpp"
+#include <cstddef>
+
+struct Boid;
 
 /**
  * A boid that follows the objective boid.
+ * The follow boids are kept in a BoidStore, and this is only a view of one of
+ * them: it holds the store and the index of the boid, and reads and writes
+ * the arrays of the store. It is invalidated when boids are removed from the
+ * store; hold the BoidHandle of getHandle() to find the boid again.
  **/
-struct FollowBoid : public Boid {
+class FollowBoid {
+    /// The store of the boid.
+    BoidStore *_store;
+
+    /// Index of the boid in the store.
+    size_t _index;
+
+public:
+    FollowBoid(BoidStore &store, size_t index)
+            : _store(&store), _index(index) {
+
+    }
+
+    /// Returns the index of the boid in the store.
+    inline size_t getIndex() const {
+        return _index;
+    }
+
+    /// Returns the stable handle of the boid.
+    inline BoidHandle getHandle() const {
+        return _store->handleAt(_index);
+    }
+
+    /// Returns the position of the boid.
+    inline Point getPosition() const {
+        return Point(_store->px()[_index], _store->py()[_index],
+                _store->pz()[_index]);
+    }
+
+    /// Sets the position of the boid.
+    inline void setPosition(const Point &position) {
+        _store->px()[_index] = toFloat(position.x);
+        _store->py()[_index] = toFloat(position.y);
+        _store->pz()[_index] = toFloat(position.z);
+    }
+
+    /// Returns the velocity of the boid.
+    inline Vector getVelocity() const {
+        return Vector(_store->vx()[_index], _store->vy()[_index],
+                _store->vz()[_index]);
+    }
+
+    /// Sets the velocity of the boid, updating its speed.
+    inline void setVelocity(const Vector &velocity) {
+        _store->vx()[_index] = toFloat(velocity.x);
+        _store->vy()[_index] = toFloat(velocity.y);
+        _store->vz()[_index] = toFloat(velocity.z);
+        _store->updateSpeed(_index);
+    }
+
+    /// Returns the speed of the boid.
+    inline float getSpeed() const {
+        return _store->speed()[_index];
+    }
+
     /**
-     * This point is used by the collision system to restore the boid to his
-     * original relative position after avoiding a collision.
+     * Returns the direction the boid is moving to, or (0.0, 0.0, 1.0) if it
+     * is stopped.
      **/
-    Point oldPosition;
+    inline Vector getDirection() const {
+        float speed = getSpeed();
+        if(speed == 0.0)
+            return Vector(0.0, 0.0, 1.0);
+
+        return getVelocity() / speed;
+    }
+
+    /**
+     * Returns the position between the previous and the current tick.
+     * @param alpha 0 for the previous tick, 1 for the current one.
+     **/
+    inline Point interpolatePosition(float alpha) const {
+        const BoidStore &s = *_store;
+        size_t i = _index;
+        return Point(
+            s.previousPx()[i] + (s.px()[i] - s.previousPx()[i]) * alpha,
+            s.previousPy()[i] + (s.py()[i] - s.previousPy()[i]) * alpha,
+            s.previousPz()[i] + (s.pz()[i] - s.previousPz()[i]) * alpha);
+    }
 
     /**
-     * Constructor.
-     * Creates the boid with the given position (relative to the objective boid).
-     * The objective boid must already have been created.
+     * Like interpolatePosition(), but for the direction. Returns
+     * (0.0, 0.0, 1.0) if the boid is stopped.
      **/
-    FollowBoid(unsigned _displayList, bool _displayListGoingUp,
-            Point _position, float _speed,
-            Vector _direction, Vector _up = Vector(0.0, 1.0, 0.0))
-        : Boid(_displayList, _displayListGoingUp, _position, _speed,
-                _direction, _up), oldPosition(_position) {
+    inline Vector interpolateDirection(float alpha) const {
+        const BoidStore &s = *_store;
+        size_t i = _index;
+        Vector v(s.previousVx()[i] + (s.vx()[i] - s.previousVx()[i]) * alpha,
+                s.previousVy()[i] + (s.vy()[i] - s.previousVy()[i]) * alpha,
+                s.previousVz()[i] + (s.vz()[i] - s.previousVz()[i]) * alpha);
+        if(v.module() == 0.0)
+            return Vector(0.0, 0.0, 1.0);
 
+        return v.normalize();
     }
 
-    Point getAbsolutePosition() const;
-    Point getRelativePosition() const;
+    /// Returns the phase of the wings of the boid.
+    inline float getWingPhase() const {
+        return _store->wing()[_index];
+    }
+
+    /**
+     * Returns the absolute position (not relative to any other boid) of this
+     * boid.
+     **/
+    inline Point getAbsolutePosition() const {
+        return getPosition();
+    }
+
+    /// Returns the position of the boid with relation to the leader of its
+    /// flock.
+    Point getRelativePosition(const Boid &leader) const;
 };
 
+inline FollowBoid BoidStore::operator[](size_t i) {
+    return FollowBoid(*this, i);
+}
+
+inline FollowBoid BoidStore::operator[](BoidHandle handle) {
+    return FollowBoid(*this, indexOf(handle));
+}
+
 #endif // !GAMEOBJECT_FOLLOWBOID_HPP
@@ -50,6 +50,11 @@ struct GameObject  {
     /// Up vector of the object. Defaults to (0.0, 1.0, 0.0).
     Vector up;
 
+    /// Position, direction and up vector at the end of the previous tick.
+    Point previousPosition;
+    Vector previousDirection;
+    Vector previousUp;
+
     /**
      * Constructor.
      * Creates an object at the given position with the given direction, up
@@ -63,8 +68,39 @@ struct GameObject  {
     GameObject(unsigned _displayList, Point _position, float _speed,
             Vector _direction, Vector _up = Vector(0.0, 1.0, 0.0))
             : displayList(_displayList), position(_position), speed(_speed),
-            direction(_direction), up(_up) {
+            direction(_direction), up(_up), previousPosition(_position),
+            previousDirection(_direction), previousUp(_up) {
+
+    }
+
+    /**
+     * Saves the position, direction and up vector as the ones of the
+     * previous tick. Called before each tick.
+     **/
+    inline void savePreviousState() {
+        previousPosition = position;
+        previousDirection = direction;
+        previousUp = up;
+    }
+
+    /**
+     * Returns the position between the previous and the current tick.
+     * @param alpha 0 for the previous tick, 1 for the current one.
+     **/
+    inline Point interpolatePosition(float alpha) const {
+        return previousPosition + (position - previousPosition) * alpha;
+    }
+
+    /// Like interpolatePosition(), but for the direction.
+    inline Vector interpolateDirection(float alpha) const {
+        Vector v = previousDirection + (direction - previousDirection) * alpha;
+        return v.module() > 0.0 ? v.normalize() : direction;
+    }
 
+    /// Like interpolatePosition(), but for the up vector.
+    inline Vector interpolateUp(float alpha) const {
+        Vector v = previousUp + (up - previousUp) * alpha;
+        return v.module() > 0.0 ? v.normalize() : up;
     }
 };
 
@@ -57,16 +57,24 @@ struct ObjectiveBoid : public Boid {
             : Boid(_displayList, _displayListGoingUp, _position, _speed,
                     _direction, _up),
             keySensitivity(DefaultObjectiveBoidKeySensitivity) {
-        // Convert the direction to angles.
+        // Convert the direction to angles, with the functions of Scalar in
+        // the deterministic mode (see Scalar).
+        using std::asin;
+        using std::acos;
+        using std::cos;
+        using std::sin;
         direction.normalize();
-        float vertRads = asin(-direction.y);
-        verticalAngle = toDegrees(vertRads);
-        horizontalAngle = toDegrees(acos(-direction.z / cos(vertRads)));
+        Scalar vertRads = asin(-direction.y);
+        Scalar cosVert = cos(vertRads);
+        verticalAngle = toDegrees(toFloat(vertRads));
+        horizontalAngle = cosVert != 0 ? toDegrees(toFloat(acos(-direction.z
+                        / cosVert))) : 0.0;
 
         // Update the right direction.
-        right.x = cos(toRads(horizontalAngle));
+        Scalar horizRads = toRads(horizontalAngle);
+        right.x = cos(horizRads);
         right.y = 0.0;
-        right.z = sin(toRads(horizontalAngle));
+        right.z = sin(horizRads);
     }
 
     Point getAbsolutePosition() const {
@@ -26,8 +26,15 @@
  */
 
 #include "Engine.hpp"
+#include "EngineOptions.hpp"
+
+int main(int argc, char **argv) {
+    EngineOptions options;
+    if(!parseEngineOptions(argc, argv, options)) {
+        printEngineUsage(argv[0]);
+        return 1;
+    }
 
-int main() {
     // Gives control to the engine.
-    return getEngine().run();
+    return getEngine().run(options);
 }
@@ -73,8 +73,8 @@ public:
         Vector w0 = Vector(-direction.y, direction.x, 0.0);
         //Vector u0 = Vector::cross(w0, direction);
 
-        float alphaInRads = asin(direction.z);
-        float betaInRads = asin(Vector::dot(w0, up));
+        float alphaInRads = asin(toFloat(direction.z));
+        float betaInRads = asin(toFloat(Vector::dot(w0, up)));
 
         alpha = -toDegrees(alphaInRads);
         beta = toDegrees(betaInRads);
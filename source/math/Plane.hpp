@@ -45,10 +45,10 @@ void findPlaneEquation(const Point &p0, const Point &p1, const Point &p2,
 
     // Find the intersection and save A, B, C and D of the plane's equation.
     Vector cross = Vector::cross(v0, v1);
-    planeOut[0] = cross.x;
-    planeOut[1] = cross.y;
-    planeOut[2] = cross.z;
-    planeOut[3] = -(planeOut[0] * p0.x + planeOut[1] * p0.y + planeOut[2] * p0.z);
+    planeOut[0] = toFloat(cross.x);
+    planeOut[1] = toFloat(cross.y);
+    planeOut[2] = toFloat(cross.z);
+    planeOut[3] = -toFloat(cross.x * p0.x + cross.y * p0.y + cross.z * p0.z);
 }
 
 #endif // !MATH_PLANE_HPP
@@ -38,13 +38,13 @@ class Point {
 
 public:
     /// Value in the x direction.
-    float x;
+    Scalar x;
 
     /// Value in the y direction.
-    float y;
+    Scalar y;
 
     /// Value in the z direction.
-    float z;
+    Scalar z;
 
     /**
      * h value.
@@ -58,7 +58,7 @@ public:
      * different than 1.0 for points and 0.0 for vectors, then you made
      * something wrong.
      **/
-    float h;
+    Scalar h;
 
     /**
      * Constructor for points.
@@ -67,7 +67,8 @@ public:
      * @param zVal the value in the z direction.
      * @param hVal h value.
      **/
-    Point(float xVal = 0.0, float yVal = 0.0, float zVal = 0.0, float hVal = 1.0)
+    Point(Scalar xVal = 0.0, Scalar yVal = 0.0, Scalar zVal = 0.0,
+            Scalar hVal = 1.0)
         : x(xVal), y(yVal), z(zVal), h(hVal) {
 
     }
@@ -75,10 +76,10 @@ public:
     /**
      * Calculates the distance between two points.
      **/
-    static float distance(const Point &p1, const Point &p2) {
-        return std::sqrt(std::pow(p1.x - p2.x, 2)
-                + std::pow(p1.y - p2.y, 2)
-                + std::pow(p1.z - p2.z, 2));
+    static Scalar distance(const Point &p1, const Point &p2) {
+        using std::sqrt;
+        Scalar dx = p1.x - p2.x, dy = p1.y - p2.y, dz = p1.z - p2.z;
+        return sqrt(dx * dx + dy * dy + dz * dz);
     }
 
     /// += operator for point-vector addition.
@@ -146,7 +147,8 @@ namespace glext {
      * @param point The (p)oint to use as a vertex.
      **/
     inline void glVertexp(const Point &point) {
-        glVertex4f(point.x, point.y, point.z, point.h);
+        glVertex4f(toFloat(point.x), toFloat(point.y), toFloat(point.z),
+                toFloat(point.h));
     }
 
     /**
@@ -154,7 +156,7 @@ namespace glext {
      * @param opint The (p)oint to translate to.
      **/
     inline void glTranslatep(const Point &point) {
-        glTranslatef(point.x, point.y, point.z);
+        glTranslatef(toFloat(point.x), toFloat(point.y), toFloat(point.z));
     }
 }
 
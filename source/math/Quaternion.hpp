@@ -41,7 +41,7 @@ class Quaternion {
 
 public:
     /// Represents the real part of the quaternion.
-    float w;
+    Scalar w;
 
     /// Represents the pure (xi + yj + zk) part of the quaternion.
     Vector v;
@@ -52,7 +52,7 @@ public:
      * @param v Real vector representing the pure (xi + yj + zk) part of the
      * quaternion.
      **/
-    Quaternion(float _w, Vector _v)
+    Quaternion(Scalar _w, Vector _v)
         : w(_w), v(_v) {
 
     }
@@ -66,7 +66,8 @@ public:
      * @param _y j part (representing yj) of the quaternion.
      * @param _z k part (representing zk) of the quaternion.
      **/
-    Quaternion(float _w = 1.0, float _x = 0.0, float _y = 0.0, float _z = 0.0)
+    Quaternion(Scalar _w = 1.0, Scalar _x = 0.0, Scalar _y = 0.0,
+            Scalar _z = 0.0)
             : w(_w), v(_x, _y, _z) {
 
     }
@@ -74,8 +75,9 @@ public:
     /**
      * Returns the magnitude of the quaternion.
      **/
-    inline double magnitude() {
-        return std::sqrt((this->w * this->w)
+    inline Scalar magnitude() {
+        using std::sqrt;
+        return sqrt((this->w * this->w)
                 + (this->v.module() * this->v.module()));
     }
 
@@ -95,7 +97,7 @@ public:
      * @param matrix The matrix to replace the data.
      **/
     inline void toMatrix(Matrix4d &matrix) {
-        float ww = this->w * this->w,
+        Scalar ww = this->w * this->w,
             xx = this->v.x * this->v.x,
             yy = this->v.y * this->v.y,
             zz = this->v.z * this->v.z,
@@ -106,17 +108,17 @@ public:
             xz2 = 2.0 * this->v.x * this->v.z,
             yz2 = 2.0 * this->v.y * this->v.z;
 
-        matrix[0] = ww + xx - yy - zz;
-        matrix[1] = xy2 + wz2;
-        matrix[2] = xz2 - wy2;
+        matrix[0] = toFloat(ww + xx - yy - zz);
+        matrix[1] = toFloat(xy2 + wz2);
+        matrix[2] = toFloat(xz2 - wy2);
         matrix[3] = 0.0;
-        matrix[4] = xy2 - wz2;
-        matrix[5] = ww - xx + yy - zz;
-        matrix[6] = yz2 + wx2;
+        matrix[4] = toFloat(xy2 - wz2);
+        matrix[5] = toFloat(ww - xx + yy - zz);
+        matrix[6] = toFloat(yz2 + wx2);
         matrix[7] = 0.0;
-        matrix[8] = xz2 + wy2;
-        matrix[9] = yz2 - wx2;
-        matrix[10] = ww - xx - yy + zz;
+        matrix[8] = toFloat(xz2 + wy2);
+        matrix[9] = toFloat(yz2 - wx2);
+        matrix[10] = toFloat(ww - xx - yy + zz);
         matrix[11] = 0.0;
         matrix[12] = 0.0;
         matrix[13] = 0.0;
@@ -171,7 +173,7 @@ public:
      * @param q2 The second quaternion of the dot product.
      * @return The dot product between q1 and q2.
      **/
-    static inline float dot(const Quaternion &q1, const Quaternion &q2) {
+    static inline Scalar dot(const Quaternion &q1, const Quaternion &q2) {
         return q1.w * q2.w + q1.v.x * q2.v.x + q1.v.y * q2.v.y
             + q1.v.z * q2.v.z;
     }
@@ -192,7 +194,7 @@ public:
             q2.v.z = -q2.v.z;
         }
 
-        theta = acos(dot(q1, q2));
+        theta = acos(toFloat(dot(q1, q2)));
 
         // To avoid division by 0 and by very small numbers, the approximation
         // of sin(angle) by angle is used when theta is mall (0.000001 is chosen
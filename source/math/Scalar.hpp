@@ -0,0 +1,338 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MATH_SCALAR_HPP
+#define MATH_SCALAR_HPP
+
+/**
+ * The scalar of the math types (Vector, Point): float, or a fixed-point
+ * number when BOIDS_FIXED_POINT is defined.
+ * Fixed-point arithmetic is integer arithmetic, so it gives the same bits on
+ * any compiler, instruction set and optimization level, which float only
+ * does with care. Use toFloat() where a Scalar goes into floats, like the
+ * arrays of the boids and OpenGL.
+ **/
+
+#include "math.hpp"
+#include <algorithm>
+#include <iostream>
+#include <stdint.h>
+
+#ifdef BOIDS_FIXED_POINT
+
+/**
+ * A signed fixed-point number with FractionBits fractional bits, stored in
+ * 64 bits. The products are taken in 64 bits too, so they must stay below
+ * 2^(63 - 2 * FractionBits) (about 2 * 10^9), which is far more than the
+ * distances of the world.
+ * The conversions from float round to the nearest number; products truncate
+ * towards negative infinity and quotients towards zero.
+ **/
+class Fixed {
+public:
+    /// Number of fractional bits.
+    static const int FractionBits = 16;
+
+private:
+    /// The number times 2^FractionBits.
+    int64_t _raw;
+
+    /// 2^FractionBits. Scale by it instead of shifting, as shifting a
+    /// negative number left is undefined.
+    static inline int64_t scale() {
+        return (int64_t) 1 << FractionBits;
+    }
+
+    /// 2^FractionBits, as a double.
+    static inline double one() {
+        return (double) scale();
+    }
+
+    /// Rounds a double to the nearest raw value.
+    static inline int64_t round(double value) {
+        return (int64_t) std::floor(value * one() + 0.5);
+    }
+
+public:
+    Fixed() : _raw(0) {
+
+    }
+
+    Fixed(int value) : _raw((int64_t) value * scale()) {
+
+    }
+
+    Fixed(float value) : _raw(round(value)) {
+
+    }
+
+    Fixed(double value) : _raw(round(value)) {
+
+    }
+
+    /// Creates the number with the given raw value.
+    static inline Fixed fromRaw(int64_t raw) {
+        Fixed fixed;
+        fixed._raw = raw;
+        return fixed;
+    }
+
+    /// Returns the number times 2^FractionBits.
+    inline int64_t raw() const {
+        return _raw;
+    }
+
+    /// Returns the number as a float.
+    inline float toFloat() const {
+        return (float) (_raw / one());
+    }
+
+    /// Returns the number as a double.
+    inline double toDouble() const {
+        return _raw / one();
+    }
+
+    inline Fixed &operator+=(Fixed right) {
+        _raw += right._raw;
+        return *this;
+    }
+
+    inline Fixed &operator-=(Fixed right) {
+        _raw -= right._raw;
+        return *this;
+    }
+
+    inline Fixed &operator*=(Fixed right) {
+        _raw = (_raw * right._raw) >> FractionBits;
+        return *this;
+    }
+
+    /// The divisor must not be zero.
+    inline Fixed &operator/=(Fixed right) {
+        _raw = _raw * scale() / right._raw;
+        return *this;
+    }
+
+    inline Fixed operator-() const {
+        return fromRaw(-_raw);
+    }
+};
+
+inline Fixed operator+(Fixed left, Fixed right) { return left += right; }
+inline Fixed operator-(Fixed left, Fixed right) { return left -= right; }
+inline Fixed operator*(Fixed left, Fixed right) { return left *= right; }
+inline Fixed operator/(Fixed left, Fixed right) { return left /= right; }
+
+inline bool operator==(Fixed left, Fixed right) {
+    return left.raw() == right.raw();
+}
+
+inline bool operator!=(Fixed left, Fixed right) {
+    return left.raw() != right.raw();
+}
+
+inline bool operator<(Fixed left, Fixed right) {
+    return left.raw() < right.raw();
+}
+
+inline bool operator>(Fixed left, Fixed right) {
+    return left.raw() > right.raw();
+}
+
+inline bool operator<=(Fixed left, Fixed right) {
+    return left.raw() <= right.raw();
+}
+
+inline bool operator>=(Fixed left, Fixed right) {
+    return left.raw() >= right.raw();
+}
+
+/**
+ * Helpers of the functions of Fixed below, which work with more fractional
+ * bits than Fixed has, so that their errors stay below its resolution.
+ **/
+namespace fixedpoint {
+    /// Fractional bits of the intermediate results.
+    const int Bits = 30;
+
+    /// 1, pi / 2, pi and 2 * pi with Bits fractional bits.
+    const int64_t One = (int64_t) 1 << Bits;
+    const int64_t HalfPi = 1686629713ll;
+    const int64_t Pi = 3373259426ll;
+    const int64_t TwoPi = 6746518852ll;
+
+    /// Converts a Fixed to Bits fractional bits.
+    inline int64_t widen(Fixed value) {
+        return value.raw() * ((int64_t) 1 << (Bits - Fixed::FractionBits));
+    }
+
+    /// Converts a number with Bits fractional bits to the nearest Fixed.
+    inline Fixed narrow(int64_t value) {
+        const int shift = Bits - Fixed::FractionBits;
+        return Fixed::fromRaw((value + ((int64_t) 1 << (shift - 1)))
+                >> shift);
+    }
+
+    /// Multiplies two numbers with Bits fractional bits, both below 2.
+    inline int64_t mul(int64_t left, int64_t right) {
+        return (left * right) >> Bits;
+    }
+
+    /// Square root of an integer, rounded down, found one bit at a time.
+    inline uint64_t sqrt(uint64_t remainder) {
+        uint64_t root = 0;
+        uint64_t bit = (uint64_t) 1 << 62;
+        while(bit > remainder)
+            bit >>= 2;
+
+        while(bit) {
+            if(remainder >= root + bit) {
+                remainder -= root + bit;
+                root = (root >> 1) + bit;
+            }
+            else {
+                root >>= 1;
+            }
+            bit >>= 2;
+        }
+
+        return root;
+    }
+
+    /// Sine of x, with Bits fractional bits, from the Taylor series up to
+    /// x^11, exact to 10^-7 in [-pi, pi].
+    inline int64_t sin(int64_t x) {
+        // Reduce x to [-pi / 2, pi / 2], where the series converges fast.
+        x %= TwoPi;
+        if(x > Pi)
+            x -= TwoPi;
+        else if(x < -Pi)
+            x += TwoPi;
+        if(x > HalfPi)
+            x = Pi - x;
+        else if(x < -HalfPi)
+            x = -Pi - x;
+
+        // The coefficients are (-1)^k / (2k + 1)!.
+        int64_t x2 = mul(x, x);
+        int64_t sum = -27;
+        sum = 2959 + mul(x2, sum);
+        sum = -213044 + mul(x2, sum);
+        sum = 8947849 + mul(x2, sum);
+        sum = -178956971 + mul(x2, sum);
+        sum = One + mul(x2, sum);
+        return mul(x, sum);
+    }
+
+    /// Arcsine of x, with Bits fractional bits, from the Taylor series up
+    /// to x^15, exact to 10^-7 in [-1 / 2, 1 / 2].
+    inline int64_t asinSeries(int64_t x) {
+        // The coefficients are (2k)! / (4^k (k!)^2 (2k + 1)).
+        int64_t x2 = mul(x, x);
+        int64_t sum = 14994637;
+        sum = 18632389 + mul(x2, sum);
+        sum = 24021923 + mul(x2, sum);
+        sum = 32622364 + mul(x2, sum);
+        sum = 47934903 + mul(x2, sum);
+        sum = 80530637 + mul(x2, sum);
+        sum = 178956971 + mul(x2, sum);
+        sum = One + mul(x2, sum);
+        return mul(x, sum);
+    }
+
+    /// Arcsine of x, with Bits fractional bits. x is clamped to [-1, 1].
+    inline int64_t asin(int64_t x) {
+        bool negative = x < 0;
+        int64_t a = std::min(negative ? -x : x, One);
+
+        // Past 1 / 2, asin(a) = pi / 2 - 2 asin(sqrt((1 - a) / 2)).
+        int64_t angle;
+        if(a <= One / 2)
+            angle = asinSeries(a);
+        else
+            angle = HalfPi - 2 * asinSeries((int64_t) sqrt(
+                        (uint64_t) ((One - a) / 2) << Bits));
+
+        return negative ? -angle : angle;
+    }
+}
+
+/// Square root, rounded down. The number must not be negative.
+inline Fixed sqrt(Fixed value) {
+    // The root of raw * 2^FractionBits is the raw value of the root.
+    return Fixed::fromRaw((int64_t) fixedpoint::sqrt(
+                (uint64_t) value.raw() << Fixed::FractionBits));
+}
+
+/**
+ * Sine, cosine, arcsine and arccosine, in radians. Unlike the ones of the
+ * math library, which differ in the last bits between libraries, these only
+ * use integer arithmetic, so they give the same bits on any machine. The
+ * arguments of asin() and acos() are clamped to [-1, 1].
+ **/
+inline Fixed sin(Fixed value) {
+    return fixedpoint::narrow(fixedpoint::sin(fixedpoint::widen(value)));
+}
+
+inline Fixed cos(Fixed value) {
+    return fixedpoint::narrow(fixedpoint::sin(fixedpoint::widen(value)
+                + fixedpoint::HalfPi));
+}
+
+inline Fixed asin(Fixed value) {
+    return fixedpoint::narrow(fixedpoint::asin(fixedpoint::widen(value)));
+}
+
+inline Fixed acos(Fixed value) {
+    return fixedpoint::narrow(fixedpoint::HalfPi
+            - fixedpoint::asin(fixedpoint::widen(value)));
+}
+
+/// Writes the number to an output stream.
+inline std::ostream &operator<<(std::ostream &os, Fixed value) {
+    return os << value.toDouble();
+}
+
+typedef Fixed Scalar;
+
+/// Returns the scalar as a float.
+inline float toFloat(Fixed value) {
+    return value.toFloat();
+}
+
+#else // !BOIDS_FIXED_POINT
+
+typedef float Scalar;
+
+/// Returns the scalar as a float.
+inline float toFloat(float value) {
+    return value;
+}
+
+#endif // BOIDS_FIXED_POINT
+
+#endif // !MATH_SCALAR_HPP
@@ -29,6 +29,7 @@
 #include <iostream>
 #include "math.hpp"
 #include "Matrix4d.hpp"
+#include "Scalar.hpp"
 
 /**
  * An implementation of a Vector (as in linear algebra).
@@ -39,13 +40,13 @@ class Vector {
 
 public:
     /// Value in the x direction.
-    float x;
+    Scalar x;
 
     /// Value in the y direction.
-    float y;
+    Scalar y;
 
     /// Value in the z direction.
-    float z;
+    Scalar z;
 
     /**
      * h value.
@@ -59,7 +60,7 @@ public:
      * different than 1.0 for points and 0.0 for vectors, then you made
      * something wrong.
      **/
-    float h;
+    Scalar h;
 
     /**
      * Constructor for vectors.
@@ -68,7 +69,8 @@ public:
      * @param zVal the value in the z direction.
      * @param hVal h value. Normally is 0.0 for vectors.
      **/
-    Vector(float xVal = 0.0, float yVal = 0.0, float zVal = 0.0, float hVal = 0.0)
+    Vector(Scalar xVal = 0.0, Scalar yVal = 0.0, Scalar zVal = 0.0,
+            Scalar hVal = 0.0)
         : x(xVal), y(yVal), z(zVal), h(hVal) {
 
     }
@@ -89,17 +91,17 @@ public:
         Vector localAxis = cross(up, direction);
 
         Matrix4d matrix;
-        matrix[0] = localAxis.x;
-        matrix[1] = localAxis.y;
-        matrix[2] = localAxis.z;
+        matrix[0] = toFloat(localAxis.x);
+        matrix[1] = toFloat(localAxis.y);
+        matrix[2] = toFloat(localAxis.z);
         matrix[3] = 0.0;
-        matrix[4] = up.x;
-        matrix[5] = up.y;
-        matrix[6] = up.z;
+        matrix[4] = toFloat(up.x);
+        matrix[5] = toFloat(up.y);
+        matrix[6] = toFloat(up.z);
         matrix[7] = 0.0;
-        matrix[8] = direction.x;
-        matrix[9] = direction.y;
-        matrix[10] = direction.z;
+        matrix[8] = toFloat(direction.x);
+        matrix[9] = toFloat(direction.y);
+        matrix[10] = toFloat(direction.z);
         matrix[11] = 0.0;
         matrix[12] = 0.0;
         matrix[13] = 0.0;
@@ -113,7 +115,7 @@ public:
      * Returns the vector for convenience.
      * @param factor How much to multiply the vector.
      **/
-    inline Vector &scale(float factor) {
+    inline Vector &scale(Scalar factor) {
         this->x *= factor;
         this->y *= factor;
         this->z *= factor;
@@ -126,7 +128,7 @@ public:
      * Returns the vector for convenience.
      * @param factor How much to divide the vector.
      **/
-    inline Vector &divScale(float factor) {
+    inline Vector &divScale(Scalar factor) {
         this->x /= factor;
         this->y /= factor;
         this->z /= factor;
@@ -136,8 +138,9 @@ public:
     /**
      * Returns the module of the vector.
      **/
-    inline double module() const {
-        return std::sqrt((this->x * this->x)
+    inline Scalar module() const {
+        using std::sqrt;
+        return sqrt((this->x * this->x)
                 + (this->y * this->y)
                 + (this->z * this->z));
     }
@@ -146,8 +149,8 @@ public:
      * Normalizes the vector. Returns it for convenience.
      **/
     inline Vector &normalize() {
-        double mod = this->module();
-        if(mod)
+        Scalar mod = this->module();
+        if(mod != 0)
             this->divScale(mod);
 
         return *this;
@@ -159,7 +162,7 @@ public:
      * @param v2 The second vector of the dot product.
      * @return The dot product between v1 and v2.
      **/
-    static inline float dot(const Vector &v1, const Vector &v2) {
+    static inline Scalar dot(const Vector &v1, const Vector &v2) {
         return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
     }
 
@@ -179,9 +182,9 @@ public:
      * Orthogonal projection of v with relation to w.
      **/
     static inline Vector proj(Vector w, const Vector &v) {
-        float dotProd = dot(v, w);
-        float module2 = std::pow(w.module(), 2);
-        float factor = dotProd / module2;
+        Scalar dotProd = dot(v, w);
+        Scalar module2 = dot(w, w);
+        Scalar factor = dotProd / module2;
 
         w *= factor;
         return w;
@@ -205,8 +208,8 @@ public:
         return *this;
     }
 
-    // -= operator for floats.
-    Vector &operator-=(const float &right) {
+    // -= operator for scalars.
+    Vector &operator-=(const Scalar &right) {
         this->x -= right;
         this->y -= right;
         this->z -= right;
@@ -214,19 +217,19 @@ public:
     }
 
     /// *= operator representing a scale.
-    Vector &operator*=(const float &factor) {
+    Vector &operator*=(const Scalar &factor) {
         this->scale(factor);
         return *this;
     }
 
     /// /= operator representing a scale division.
-    Vector &operator/=(const float &factor) {
+    Vector &operator/=(const Scalar &factor) {
         this->divScale(factor);
         return *this;
     }
 
     /// unary * operator representing the vector's module.
-    float operator*() const {
+    Scalar operator*() const {
         return this->module();
     }
 };
@@ -243,27 +246,27 @@ inline Vector operator-(Vector left, const Vector &right) {
     return left;
 }
 
-/// - operator for vectors with floats.
-inline Vector operator-(Vector left, float right) {
+/// - operator for vectors with scalars.
+inline Vector operator-(Vector left, Scalar right) {
     left -= right;
     return left;
 }
 
 /// * operator for scaling vectors.
-inline Vector operator*(Vector left, const float &right) {
+inline Vector operator*(Vector left, const Scalar &right) {
     left *= right;
     return left;
 }
 
 /// * operator for scaling vectors.
-inline Vector operator*(const float &left, Vector right) {
+inline Vector operator*(const Scalar &left, Vector right) {
     right *= left;
     return right;
 }
 
 /// / operator for scaling vectors.
-inline Vector operator/(Vector left, const float &right) {
-    left *= right;
+inline Vector operator/(Vector left, const Scalar &right) {
+    left /= right;
     return left;
 }
 
@@ -295,7 +298,8 @@ namespace glext {
      * @param vector The (v)ector to use as normal.
      **/
     inline void glNormalv(const Vector &vector) {
-        glNormal3f(vector.x, vector.y, vector.z);
+        glNormal3f(toFloat(vector.x), toFloat(vector.y),
+                toFloat(vector.z));
     }
 }
 
@@ -0,0 +1,392 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "kernels.hpp"
+#include <algorithm>
+#include <cmath>
+
+// integrate() runs over whole Floats, into the padding of the store.
+static_assert(simd::Width <= BoidStore::Padding,
+        "The padding of the boid store must hold a whole simd::Float.");
+
+void simd::sumFlockmates(const Particles &particles,
+        const unsigned *candidates, size_t count, float x, float y, float z,
+        float radius, float separationRadius, FlockmateSums &sums) {
+    const Float qx = set(x), qy = set(y), qz = set(z);
+    const Float radius2 = set(radius * radius);
+    const Float separation2 = set(separationRadius * separationRadius);
+    const Float separation = set(separationRadius);
+    const Float one = set(1.0f);
+    const Float total = set((float) count);
+
+    Float sx = zero(), sy = zero(), sz = zero();
+    Float ax = zero(), ay = zero(), az = zero();
+    Float cx = zero(), cy = zero(), cz = zero();
+    Float neighbors = zero();
+
+    for(size_t k = 0; k < count; k += Width) {
+        const unsigned *indices = candidates + k;
+        Float valid = lessThan(add(set((float) k), lanes()), total);
+
+        Float jx = gather(particles.x, indices);
+        Float jy = gather(particles.y, indices);
+        Float jz = gather(particles.z, indices);
+        Float dx = sub(qx, jx);
+        Float dy = sub(qy, jy);
+        Float dz = sub(qz, jz);
+        Float dist2 = mulAdd(dx, dx, mulAdd(dy, dy, mul(dz, dz)));
+
+        // Flockmates are inside the radius, but not at the same place.
+        Float mates = maskAnd(valid, maskAnd(greaterThan(dist2, zero()),
+                    lessThan(dist2, radius2)));
+        if(!any(mates))
+            continue;
+
+        ax = add(ax, select(mates, gather(particles.vx, indices)));
+        ay = add(ay, select(mates, gather(particles.vy, indices)));
+        az = add(az, select(mates, gather(particles.vz, indices)));
+        cx = add(cx, select(mates, jx));
+        cy = add(cy, select(mates, jy));
+        cz = add(cz, select(mates, jz));
+        neighbors = add(neighbors, select(mates, one));
+
+        // Push away from the close ones, stronger the closer they are. The
+        // factor is infinite or NaN in the lanes masked out, so mask it
+        // before multiplying.
+        Float close = maskAnd(mates, lessThan(dist2, separation2));
+        Float factor = select(close, div(separation, dist2));
+        sx = mulAdd(dx, factor, sx);
+        sy = mulAdd(dy, factor, sy);
+        sz = mulAdd(dz, factor, sz);
+    }
+
+    sums.separationX = sum(sx);
+    sums.separationY = sum(sy);
+    sums.separationZ = sum(sz);
+    sums.alignmentX = sum(ax);
+    sums.alignmentY = sum(ay);
+    sums.alignmentZ = sum(az);
+    sums.cohesionX = sum(cx);
+    sums.cohesionY = sum(cy);
+    sums.cohesionZ = sum(cz);
+    sums.neighbors = (unsigned) sum(neighbors);
+}
+
+void simd::sumFlockmatesScalar(const Particles &particles,
+        const unsigned *candidates, size_t count, float x, float y, float z,
+        float radius, float separationRadius, FlockmateSums &sums) {
+    const float radius2 = radius * radius;
+    const float separation2 = separationRadius * separationRadius;
+
+    sums.separationX = sums.separationY = sums.separationZ = 0.0f;
+    sums.alignmentX = sums.alignmentY = sums.alignmentZ = 0.0f;
+    sums.cohesionX = sums.cohesionY = sums.cohesionZ = 0.0f;
+    sums.neighbors = 0;
+
+    for(size_t k = 0; k < count; ++k) {
+        unsigned j = candidates[k];
+        float dx = x - particles.x[j];
+        float dy = y - particles.y[j];
+        float dz = z - particles.z[j];
+        float dist2 = dx * dx + dy * dy + dz * dz;
+        if(dist2 == 0.0f || dist2 >= radius2)
+            continue;
+
+        sums.alignmentX += particles.vx[j];
+        sums.alignmentY += particles.vy[j];
+        sums.alignmentZ += particles.vz[j];
+        sums.cohesionX += particles.x[j];
+        sums.cohesionY += particles.y[j];
+        sums.cohesionZ += particles.z[j];
+        ++sums.neighbors;
+
+        if(dist2 < separation2) {
+            float factor = separationRadius / dist2;
+            sums.separationX += dx * factor;
+            sums.separationY += dy * factor;
+            sums.separationZ += dz * factor;
+        }
+    }
+}
+
+void simd::sumCollisions(const float *px, const float *py, const float *pz,
+        const unsigned *candidates, size_t count, float x, float y, float z,
+        float distance, float &cx, float &cy, float &cz) {
+    const Float qx = set(x), qy = set(y), qz = set(z);
+    const Float distance1 = set(distance);
+    const Float distance2 = set(distance * distance);
+    const Float half = set(0.5f);
+    const Float total = set((float) count);
+
+    Float sx = zero(), sy = zero(), sz = zero();
+
+    for(size_t k = 0; k < count; k += Width) {
+        const unsigned *indices = candidates + k;
+        Float valid = lessThan(add(set((float) k), lanes()), total);
+
+        Float dx = sub(qx, gather(px, indices));
+        Float dy = sub(qy, gather(py, indices));
+        Float dz = sub(qz, gather(pz, indices));
+        Float dist2 = mulAdd(dx, dx, mulAdd(dy, dy, mul(dz, dz)));
+
+        Float overlaps = maskAnd(valid, maskAnd(greaterThan(dist2, zero()),
+                    lessThan(dist2, distance2)));
+        if(!any(overlaps))
+            continue;
+
+        // Move away half of the overlap.
+        Float dist = sqrt(dist2);
+        Float factor = select(overlaps,
+                div(mul(sub(distance1, dist), half), dist));
+        sx = mulAdd(dx, factor, sx);
+        sy = mulAdd(dy, factor, sy);
+        sz = mulAdd(dz, factor, sz);
+    }
+
+    cx = sum(sx);
+    cy = sum(sy);
+    cz = sum(sz);
+}
+
+void simd::sumCollisionsScalar(const float *px, const float *py,
+        const float *pz, const unsigned *candidates, size_t count, float x,
+        float y, float z, float distance, float &cx, float &cy, float &cz) {
+    cx = cy = cz = 0.0f;
+
+    for(size_t k = 0; k < count; ++k) {
+        unsigned j = candidates[k];
+        float dx = x - px[j];
+        float dy = y - py[j];
+        float dz = z - pz[j];
+        float dist2 = dx * dx + dy * dy + dz * dz;
+        if(dist2 == 0.0f || dist2 >= distance * distance)
+            continue;
+
+        float dist = std::sqrt(dist2);
+        float factor = (distance - dist) * 0.5f / dist;
+        cx += dx * factor;
+        cy += dy * factor;
+        cz += dz * factor;
+    }
+}
+
+void simd::integrate(BoidStore &boids, const float *ax, const float *ay,
+        const float *az, size_t begin, size_t end, float dt, float maxSpeed) {
+    const float *px = boids.px(), *py = boids.py(), *pz = boids.pz();
+    const float *vx = boids.vx(), *vy = boids.vy(), *vz = boids.vz();
+    float *nextPx = boids.nextPx(), *nextPy = boids.nextPy(),
+          *nextPz = boids.nextPz();
+    float *nextVx = boids.nextVx(), *nextVy = boids.nextVy(),
+          *nextVz = boids.nextVz();
+    float *speed = boids.speed();
+    const Float step = set(dt);
+    const Float limit = set(maxSpeed);
+    const Float one = set(1.0f);
+
+    // The padding of the store is zero and stays zero.
+    for(size_t i = begin; i < end; i += Width) {
+        Float x = mulAdd(load(ax + i), step, load(vx + i));
+        Float y = mulAdd(load(ay + i), step, load(vy + i));
+        Float z = mulAdd(load(az + i), step, load(vz + i));
+
+        Float s = sqrt(mulAdd(x, x, mulAdd(y, y, mul(z, z))));
+        Float tooFast = greaterThan(s, limit);
+        Float scale = select(tooFast, div(limit, s), one);
+        x = mul(x, scale);
+        y = mul(y, scale);
+        z = mul(z, scale);
+
+        store(nextVx + i, x);
+        store(nextVy + i, y);
+        store(nextVz + i, z);
+        store(speed + i, select(tooFast, limit, s));
+        store(nextPx + i, mulAdd(x, step, load(px + i)));
+        store(nextPy + i, mulAdd(y, step, load(py + i)));
+        store(nextPz + i, mulAdd(z, step, load(pz + i)));
+    }
+}
+
+void simd::integrateScalar(BoidStore &boids, const float *ax,
+        const float *ay, const float *az, size_t begin, size_t end, float dt,
+        float maxSpeed) {
+    const float *px = boids.px(), *py = boids.py(), *pz = boids.pz();
+    const float *vx = boids.vx(), *vy = boids.vy(), *vz = boids.vz();
+    float *nextPx = boids.nextPx(), *nextPy = boids.nextPy(),
+          *nextPz = boids.nextPz();
+    float *nextVx = boids.nextVx(), *nextVy = boids.nextVy(),
+          *nextVz = boids.nextVz();
+    float *speed = boids.speed();
+
+    for(size_t i = begin; i < end; ++i) {
+        float x = vx[i] + ax[i] * dt;
+        float y = vy[i] + ay[i] * dt;
+        float z = vz[i] + az[i] * dt;
+
+        float s = std::sqrt(x * x + y * y + z * z);
+        if(s > maxSpeed) {
+            float scale = maxSpeed / s;
+            x *= scale;
+            y *= scale;
+            z *= scale;
+            s = maxSpeed;
+        }
+        speed[i] = s;
+
+        nextVx[i] = x;
+        nextVy[i] = y;
+        nextVz[i] = z;
+        nextPx[i] = px[i] + x * dt;
+        nextPy[i] = py[i] + y * dt;
+        nextPz[i] = pz[i] + z * dt;
+    }
+}
+
+void simd::avoidCone(BoidStore &boids, const Cone &cone, size_t begin,
+        size_t end, float clearance, float lookahead, float maxTurn,
+        float maxSpeed) {
+    float *px = boids.px(), *py = boids.py(), *pz = boids.pz();
+    float *vx = boids.vx(), *vy = boids.vy(), *vz = boids.vz();
+    float *speed = boids.speed();
+
+    // With r the distance to the axis, the signed distance to the side is
+    // (height * r + radius * y - radius * height) / slant, and the normal of
+    // the side is (height * dx / r, radius, height * dz / r) / slant.
+    float slant = std::sqrt(cone.height * cone.height
+            + cone.radius * cone.radius);
+    const Float normalR = set(cone.height / slant);
+    const Float normalY = set(cone.radius / slant);
+    const Float offset = set(cone.radius * cone.height / slant);
+    const Float centerX = set(cone.x), centerZ = set(cone.z);
+
+    // No boid outside this box can get close to the cone in time.
+    float reach = cone.radius + clearance + lookahead * maxSpeed;
+    const Float minX = set(cone.x - reach), maxX = set(cone.x + reach);
+    const Float minZ = set(cone.z - reach), maxZ = set(cone.z + reach);
+    const Float maxY = set(cone.height + clearance + lookahead * maxSpeed);
+
+    const Float total = set((float) end);
+    const Float clear = set(clearance), ahead = set(lookahead);
+    const Float turnLimit = set(maxTurn);
+    const Float tiny = set(1e-6f);
+
+    for(size_t i = begin; i < end; i += Width) {
+        Float x = load(px + i), y = load(py + i), z = load(pz + i);
+        Float near = maskAnd(lessThan(add(set((float) i), lanes()), total),
+                maskAnd(lessThan(y, maxY),
+                    maskAnd(maskAnd(greaterThan(x, minX), lessThan(x, maxX)),
+                        maskAnd(greaterThan(z, minZ), lessThan(z, maxZ)))));
+        if(!any(near))
+            continue;
+
+        // The tiny bit keeps the normal defined on the axis.
+        Float dx = sub(x, centerX), dz = sub(z, centerZ);
+        Float r = sqrt(mulAdd(dx, dx, mulAdd(dz, dz, tiny)));
+        Float distance = sub(mulAdd(normalR, r, mul(normalY, y)), offset);
+        Float radial = div(normalR, r);
+        Float nx = mul(dx, radial), nz = mul(dz, radial);
+
+        Float u = load(vx + i), v = load(vy + i), w = load(vz + i);
+        Float outward = mulAdd(u, nx, mulAdd(v, normalY, mul(w, nz)));
+
+        // Out of the cone, without the velocity into it.
+        Float inside = lessThan(distance, zero());
+        Float depth = max(sub(zero(), distance), zero());
+        Float kept = select(inside, max(outward, zero()), outward);
+
+        // Turn away from where the boid will be, if too close to the cone.
+        Float predicted = mulAdd(kept, ahead, max(distance, zero()));
+        Float turn = min(div(max(sub(clear, predicted), zero()), ahead),
+                turnLimit);
+        Float active = maskAnd(near,
+                maskOr(inside, lessThan(predicted, clear)));
+        if(!any(active))
+            continue;
+
+        Float change = add(sub(kept, outward), turn);
+        store(px + i, select(active, mulAdd(nx, depth, x), x));
+        store(py + i, select(active, mulAdd(normalY, depth, y), y));
+        store(pz + i, select(active, mulAdd(nz, depth, z), z));
+
+        u = select(active, mulAdd(nx, change, u), u);
+        v = select(active, mulAdd(normalY, change, v), v);
+        w = select(active, mulAdd(nz, change, w), w);
+        store(vx + i, u);
+        store(vy + i, v);
+        store(vz + i, w);
+        store(speed + i, select(active,
+                    sqrt(mulAdd(u, u, mulAdd(v, v, mul(w, w)))),
+                    load(speed + i)));
+    }
+}
+
+void simd::avoidConeScalar(BoidStore &boids, const Cone &cone, size_t begin,
+        size_t end, float clearance, float lookahead, float maxTurn,
+        float maxSpeed) {
+    float *px = boids.px(), *py = boids.py(), *pz = boids.pz();
+    float *vx = boids.vx(), *vy = boids.vy(), *vz = boids.vz();
+    float *speed = boids.speed();
+
+    float slant = std::sqrt(cone.height * cone.height
+            + cone.radius * cone.radius);
+    float normalR = cone.height / slant, normalY = cone.radius / slant;
+    float offset = cone.radius * cone.height / slant;
+    float reach = cone.radius + clearance + lookahead * maxSpeed;
+    float maxY = cone.height + clearance + lookahead * maxSpeed;
+
+    for(size_t i = begin; i < end; ++i) {
+        if(!(py[i] < maxY && px[i] > cone.x - reach
+                    && px[i] < cone.x + reach && pz[i] > cone.z - reach
+                    && pz[i] < cone.z + reach))
+            continue;
+
+        float dx = px[i] - cone.x, dz = pz[i] - cone.z;
+        float r = std::sqrt(dx * dx + dz * dz + 1e-6f);
+        float distance = normalR * r + normalY * py[i] - offset;
+        float nx = dx * (normalR / r), nz = dz * (normalR / r);
+        float outward = vx[i] * nx + vy[i] * normalY + vz[i] * nz;
+
+        bool inside = distance < 0.0f;
+        float kept = inside ? std::max(outward, 0.0f) : outward;
+        float predicted = std::max(distance, 0.0f) + kept * lookahead;
+        if(!inside && predicted >= clearance)
+            continue;
+
+        if(inside) {
+            px[i] -= nx * distance;
+            py[i] -= normalY * distance;
+            pz[i] -= nz * distance;
+        }
+
+        float turn = std::min(std::max(clearance - predicted, 0.0f)
+                / lookahead, maxTurn);
+        float change = kept - outward + turn;
+        vx[i] += nx * change;
+        vy[i] += normalY * change;
+        vz[i] += nz * change;
+        speed[i] = std::sqrt(vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i]);
+    }
+}
@@ -0,0 +1,154 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SIMD_KERNELS_HPP
+#define SIMD_KERNELS_HPP
+
+#include "simd.hpp"
+#include "../gameObject/BoidStore.hpp"
+#include <cstddef>
+
+/**
+ * The inner loops of the simulation, vectorized with the wrappers of
+ * simd.hpp. Every kernel has a plain scalar version with the same arguments,
+ * kept as the reference to check the vectorized one against (see the
+ * "kernels" benchmark). Both give the same results up to the rounding of
+ * the floats, which depends on the order of the sums.
+ * The kernels that test candidates take them as indices into arrays, and
+ * read them with gathers. The candidate array must have room for count
+ * rounded up to simd::Width indices, all valid: the lanes past count are
+ * masked out, but still read.
+ **/
+namespace simd {
+    /// Positions and velocities of a set of particles, as separate arrays.
+    struct Particles {
+        const float *x, *y, *z;
+        const float *vx, *vy, *vz;
+    };
+
+    /// A cone standing on the ground (y = 0), with its apex above the center.
+    struct Cone {
+        /// Center of the base.
+        float x, z;
+
+        /// Radius of the base.
+        float radius;
+
+        /// Height of the apex.
+        float height;
+    };
+
+    /// Sums of the flocking rules over the flockmates of a boid.
+    struct FlockmateSums {
+        /// Sum of (p - pj) * separationRadius / |p - pj|^2 over the
+        /// flockmates closer than the separation radius.
+        float separationX, separationY, separationZ;
+
+        /// Sum of the velocities of the flockmates.
+        float alignmentX, alignmentY, alignmentZ;
+
+        /// Sum of the positions of the flockmates.
+        float cohesionX, cohesionY, cohesionZ;
+
+        /// Number of flockmates.
+        unsigned neighbors;
+    };
+
+    /**
+     * Sums the flocking rules for the boid at (x, y, z) over the candidates
+     * closer than radius. Candidates at exactly (x, y, z), like the boid
+     * itself, are skipped.
+     **/
+    void sumFlockmates(const Particles &particles, const unsigned *candidates,
+            size_t count, float x, float y, float z, float radius,
+            float separationRadius, FlockmateSums &sums);
+
+    /// Scalar reference of sumFlockmates().
+    void sumFlockmatesScalar(const Particles &particles,
+            const unsigned *candidates, size_t count, float x, float y,
+            float z, float radius, float separationRadius,
+            FlockmateSums &sums);
+
+    /**
+     * Sums how much the point at (x, y, z) must move to get half way out of
+     * the candidates closer than distance, storing it in (cx, cy, cz).
+     * Candidates at exactly (x, y, z) are skipped.
+     **/
+    void sumCollisions(const float *px, const float *py, const float *pz,
+            const unsigned *candidates, size_t count, float x, float y,
+            float z, float distance, float &cx, float &cy, float &cz);
+
+    /// Scalar reference of sumCollisions().
+    void sumCollisionsScalar(const float *px, const float *py,
+            const float *pz, const unsigned *candidates, size_t count,
+            float x, float y, float z, float distance, float &cx, float &cy,
+            float &cz);
+
+    /**
+     * Moves the boids with semi-implicit Euler: adds the accelerations times
+     * dt to the velocities, limits the speed to maxSpeed, and moves the
+     * boids with the new velocities. Reads the current buffers of the store
+     * and writes the next ones (see BoidStore::swapBuffers()), and updates
+     * the speeds.
+     * Runs over the boids [begin, end). begin must be a multiple of
+     * BoidStore::Padding, and a range that ends with the store runs into its
+     * padding. The acceleration arrays must have room for the size of the
+     * store rounded up to BoidStore::Padding, with zero in the padding.
+     **/
+    void integrate(BoidStore &boids, const float *ax, const float *ay,
+            const float *az, size_t begin, size_t end, float dt,
+            float maxSpeed);
+
+    /**
+     * Keeps the boids [begin, end) out of the cone, in place in the current
+     * buffers of the store. The boids inside it are moved out to its side
+     * and lose the velocity into it. The boids that will come closer than
+     * clearance to it within lookahead seconds turn away from it, changing
+     * their velocity by up to maxTurn along its normal. The speeds are
+     * updated.
+     * Only the side of the cone is tested, as its base lies on the ground.
+     * The boids out of the bounding box of the cone grown by what they can
+     * fly at maxSpeed in lookahead seconds, plus clearance, are skipped
+     * before any of this, a whole Float at a time.
+     * begin must be a multiple of simd::Width.
+     **/
+    void avoidCone(BoidStore &boids, const Cone &cone, size_t begin,
+            size_t end, float clearance, float lookahead, float maxTurn,
+            float maxSpeed);
+
+    /// Scalar reference of avoidCone().
+    void avoidConeScalar(BoidStore &boids, const Cone &cone, size_t begin,
+            size_t end, float clearance, float lookahead, float maxTurn,
+            float maxSpeed);
+
+    /// Scalar reference of integrate().
+    void integrateScalar(BoidStore &boids, const float *ax, const float *ay,
+            const float *az, size_t begin, size_t end, float dt,
+            float maxSpeed);
+}
+
+#endif // !SIMD_KERNELS_HPP
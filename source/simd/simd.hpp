@@ -0,0 +1,253 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SIMD_SIMD_HPP
+#define SIMD_SIMD_HPP
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(BOIDS_FIXED_POINT)
+    // The fixed-point mode needs the same bits on every machine, which the
+    // widths and fused instructions of the SIMD sets don't give.
+#elif defined(__AVX__)
+#   include <immintrin.h>
+#   define SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64)
+#   include <emmintrin.h>
+#   define SIMD_SSE2
+#endif
+
+/**
+ * Thin wrappers over the widest SIMD instruction set the compiler was allowed
+ * to use: AVX (8 floats), SSE2 (4 floats) or plain floats. The kernels are
+ * written once with these, and get the instruction set chosen by the compiler
+ * flags (see BOIDS_NATIVE_ARCH in CMakeLists.txt), or plain floats in the
+ * fixed-point mode (see BOIDS_FIXED_POINT).
+ * A mask is a Float with all the bits of the lane set or unset, as returned
+ * by the comparisons.
+ **/
+namespace simd {
+#if defined(SIMD_AVX)
+    /// Name of the instruction set.
+#   if defined(__AVX2__)
+    const char *const InstructionSet = "AVX2";
+#   else
+    const char *const InstructionSet = "AVX";
+#   endif
+
+    /// Number of floats in a Float.
+    const size_t Width = 8;
+
+    typedef __m256 Float;
+
+    inline Float load(const float *p) { return _mm256_loadu_ps(p); }
+    inline void store(float *p, Float a) { _mm256_storeu_ps(p, a); }
+    inline Float set(float a) { return _mm256_set1_ps(a); }
+    inline Float zero() { return _mm256_setzero_ps(); }
+
+    /// Index of each lane: (0, 1, ..., Width - 1).
+    inline Float lanes() {
+        return _mm256_set_ps(7.0, 6.0, 5.0, 4.0, 3.0, 2.0, 1.0, 0.0);
+    }
+
+    /// Loads p[indices[0]], ..., p[indices[Width - 1]].
+    inline Float gather(const float *p, const unsigned *indices) {
+#   if defined(__AVX2__)
+        return _mm256_i32gather_ps(p,
+                _mm256_loadu_si256((const __m256i *) indices), 4);
+#   else
+        return _mm256_set_ps(p[indices[7]], p[indices[6]], p[indices[5]],
+                p[indices[4]], p[indices[3]], p[indices[2]], p[indices[1]],
+                p[indices[0]]);
+#   endif
+    }
+
+    inline Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+    inline Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+    inline Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+    inline Float div(Float a, Float b) { return _mm256_div_ps(a, b); }
+    inline Float sqrt(Float a) { return _mm256_sqrt_ps(a); }
+    inline Float min(Float a, Float b) { return _mm256_min_ps(a, b); }
+    inline Float max(Float a, Float b) { return _mm256_max_ps(a, b); }
+
+    /// a * b + c.
+    inline Float mulAdd(Float a, Float b, Float c) {
+#   if defined(__FMA__)
+        return _mm256_fmadd_ps(a, b, c);
+#   else
+        return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#   endif
+    }
+
+    inline Float lessThan(Float a, Float b) {
+        return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+    }
+
+    inline Float greaterThan(Float a, Float b) {
+        return _mm256_cmp_ps(a, b, _CMP_GT_OQ);
+    }
+
+    inline Float maskAnd(Float a, Float b) { return _mm256_and_ps(a, b); }
+    inline Float maskOr(Float a, Float b) { return _mm256_or_ps(a, b); }
+
+    /// Lanes of a where the mask is set, zero elsewhere.
+    inline Float select(Float mask, Float a) { return _mm256_and_ps(mask, a); }
+
+    /// Lanes of a where the mask is set, b elsewhere.
+    inline Float select(Float mask, Float a, Float b) {
+        return _mm256_blendv_ps(b, a, mask);
+    }
+
+    /// Returns if any lane of the mask is set.
+    inline bool any(Float mask) { return _mm256_movemask_ps(mask) != 0; }
+
+    /// Sum of all the lanes.
+    inline float sum(Float a) {
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(a),
+                _mm256_extractf128_ps(a, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+        return _mm_cvtss_f32(s);
+    }
+#elif defined(SIMD_SSE2)
+    /// Name of the instruction set.
+    const char *const InstructionSet = "SSE2";
+
+    /// Number of floats in a Float.
+    const size_t Width = 4;
+
+    typedef __m128 Float;
+
+    inline Float load(const float *p) { return _mm_loadu_ps(p); }
+    inline void store(float *p, Float a) { _mm_storeu_ps(p, a); }
+    inline Float set(float a) { return _mm_set1_ps(a); }
+    inline Float zero() { return _mm_setzero_ps(); }
+
+    /// Index of each lane: (0, 1, ..., Width - 1).
+    inline Float lanes() { return _mm_set_ps(3.0, 2.0, 1.0, 0.0); }
+
+    /// Loads p[indices[0]], ..., p[indices[Width - 1]].
+    inline Float gather(const float *p, const unsigned *indices) {
+        return _mm_set_ps(p[indices[3]], p[indices[2]], p[indices[1]],
+                p[indices[0]]);
+    }
+
+    inline Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+    inline Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+    inline Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+    inline Float div(Float a, Float b) { return _mm_div_ps(a, b); }
+    inline Float sqrt(Float a) { return _mm_sqrt_ps(a); }
+    inline Float min(Float a, Float b) { return _mm_min_ps(a, b); }
+    inline Float max(Float a, Float b) { return _mm_max_ps(a, b); }
+
+    /// a * b + c.
+    inline Float mulAdd(Float a, Float b, Float c) {
+        return _mm_add_ps(_mm_mul_ps(a, b), c);
+    }
+
+    inline Float lessThan(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+    inline Float greaterThan(Float a, Float b) { return _mm_cmpgt_ps(a, b); }
+    inline Float maskAnd(Float a, Float b) { return _mm_and_ps(a, b); }
+    inline Float maskOr(Float a, Float b) { return _mm_or_ps(a, b); }
+
+    /// Lanes of a where the mask is set, zero elsewhere.
+    inline Float select(Float mask, Float a) { return _mm_and_ps(mask, a); }
+
+    /// Lanes of a where the mask is set, b elsewhere.
+    inline Float select(Float mask, Float a, Float b) {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    /// Returns if any lane of the mask is set.
+    inline bool any(Float mask) { return _mm_movemask_ps(mask) != 0; }
+
+    /// Sum of all the lanes.
+    inline float sum(Float a) {
+        __m128 s = _mm_add_ps(a, _mm_movehl_ps(a, a));
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+        return _mm_cvtss_f32(s);
+    }
+#else
+    /// Name of the instruction set.
+    const char *const InstructionSet = "none";
+
+    /// Number of floats in a Float.
+    const size_t Width = 1;
+
+    /**
+     * Without SIMD, a Float is a float, and a mask is kept as 1.0 or 0.0
+     * instead of as bits.
+     **/
+    typedef float Float;
+
+    inline Float load(const float *p) { return *p; }
+    inline void store(float *p, Float a) { *p = a; }
+    inline Float set(float a) { return a; }
+    inline Float zero() { return 0.0f; }
+
+    /// Index of the only lane.
+    inline Float lanes() { return 0.0f; }
+
+    /// Loads p[indices[0]].
+    inline Float gather(const float *p, const unsigned *indices) {
+        return p[indices[0]];
+    }
+
+    inline Float add(Float a, Float b) { return a + b; }
+    inline Float sub(Float a, Float b) { return a - b; }
+    inline Float mul(Float a, Float b) { return a * b; }
+    inline Float div(Float a, Float b) { return a / b; }
+    inline Float sqrt(Float a) { return std::sqrt(a); }
+    inline Float min(Float a, Float b) { return a < b ? a : b; }
+    inline Float max(Float a, Float b) { return a > b ? a : b; }
+
+    /// a * b + c.
+    inline Float mulAdd(Float a, Float b, Float c) { return a * b + c; }
+
+    inline Float lessThan(Float a, Float b) { return a < b ? 1.0f : 0.0f; }
+    inline Float greaterThan(Float a, Float b) { return a > b ? 1.0f : 0.0f; }
+    inline Float maskAnd(Float a, Float b) { return a * b; }
+    inline Float maskOr(Float a, Float b) { return a != 0.0f ? a : b; }
+
+    /// a where the mask is set, zero elsewhere.
+    inline Float select(Float mask, Float a) { return mask != 0.0f ? a : 0.0f; }
+
+    /// a where the mask is set, b elsewhere.
+    inline Float select(Float mask, Float a, Float b) {
+        return mask != 0.0f ? a : b;
+    }
+
+    /// Returns if the mask is set.
+    inline bool any(Float mask) { return mask != 0.0f; }
+
+    /// The value itself.
+    inline float sum(Float a) { return a; }
+#endif
+}
+
+#endif // !SIMD_SIMD_HPP
@@ -0,0 +1,253 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "KdTree.hpp"
+#include "../defs.hpp"
+#include "../simd/simd.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace {
+    /// Orders point indices by one of their coordinates.
+    struct CoordinateLess {
+        const float *coordinate;
+
+        CoordinateLess(const float *_coordinate) : coordinate(_coordinate) {
+
+        }
+
+        bool operator()(unsigned a, unsigned b) const {
+            return coordinate[a] < coordinate[b];
+        }
+    };
+}
+
+struct KdTree::Nearest {
+    /// Number of points to find.
+    size_t k;
+
+    /// Number of points found.
+    size_t count;
+
+    /// Point to leave out.
+    size_t skip;
+
+    /// The points found and their squared distances, closest first.
+    unsigned *points;
+    float *distances2;
+
+    Nearest(size_t _k, size_t _skip, unsigned *_points, float *_distances2)
+        : k(_k), count(0), skip(_skip), points(_points),
+        distances2(_distances2) {
+
+    }
+
+    /// Squared distance a point must beat to be one of the nearest.
+    inline float worst() const {
+        return count < k ? std::numeric_limits<float>::infinity()
+            : distances2[count - 1];
+    }
+
+    /// Keeps the point if it is nearer than the ones found.
+    inline void offer(unsigned p, float distance2) {
+        if(p == skip || distance2 >= worst())
+            return;
+
+        // Insert it in order, dropping the farthest one if full.
+        size_t i = count < k ? count++ : k - 1;
+        for(; i > 0 && distances2[i - 1] > distance2; --i) {
+            points[i] = points[i - 1];
+            distances2[i] = distances2[i - 1];
+        }
+        points[i] = p;
+        distances2[i] = distance2;
+    }
+};
+
+/// Builds the subtrees below the top levels of the tree.
+struct KdTree::BuildTask {
+    KdTree &tree;
+
+    BuildTask(KdTree &_tree) : tree(_tree) {
+
+    }
+
+    void operator()(size_t begin, size_t end, unsigned) {
+        for(size_t s = begin; s < end; ++s)
+            tree.split(tree._subtrees[s].first, tree._subtrees[s].second, 0,
+                    -1);
+    }
+};
+
+/**
+ * Finds the nearest points of each point. Each point writes its own
+ * nearest points, so the chunks are independent.
+ **/
+struct KdTree::NearestTask {
+    KdTree &tree;
+
+    NearestTask(KdTree &_tree) : tree(_tree) {
+
+    }
+
+    void operator()(size_t begin, size_t end, unsigned) {
+        size_t k = tree._numNearest;
+        std::vector<float> distances2(k);
+        for(size_t p = begin; p < end; ++p) {
+            Nearest nearest(k, p, &tree._nearest[p * k], &distances2[0]);
+            tree.search(0, tree.size(), tree._x[p], tree._y[p], tree._z[p],
+                    nearest);
+        }
+    }
+};
+
+KdTree::KdTree()
+        : _numNearest(0), _inputX(0), _inputY(0), _inputZ(0) {
+
+}
+
+void KdTree::split(size_t begin, size_t end, int depth, int maxDepth) {
+    if(end - begin <= LeafSize)
+        return;
+
+    if(depth == maxDepth) {
+        _subtrees.push_back(std::make_pair(begin, end));
+        return;
+    }
+
+    // Split in the axis where the points are most spread.
+    const float *coordinates[] = { _inputX, _inputY, _inputZ };
+    unsigned *indices = &_sortedIndices[0];
+    float widest = -1.0f;
+    int axis = 0;
+    for(int a = 0; a < 3; ++a) {
+        const float *coordinate = coordinates[a];
+        float low = coordinate[indices[begin]], high = low;
+        for(size_t p = begin + 1; p < end; ++p) {
+            low = std::min(low, coordinate[indices[p]]);
+            high = std::max(high, coordinate[indices[p]]);
+        }
+        if(high - low > widest) {
+            widest = high - low;
+            axis = a;
+        }
+    }
+
+    // The median goes in the middle, the points below it before and the
+    // points above it after.
+    size_t middle = begin + (end - begin) / 2;
+    _axis[middle] = axis;
+    std::nth_element(indices + begin, indices + middle, indices + end,
+            CoordinateLess(coordinates[axis]));
+
+    split(begin, middle, depth + 1, maxDepth);
+    split(middle + 1, end, depth + 1, maxDepth);
+}
+
+void KdTree::search(size_t begin, size_t end, float x, float y, float z,
+        Nearest &nearest) const {
+    if(end - begin <= LeafSize) {
+        for(size_t p = begin; p < end; ++p) {
+            float dx = _x[p] - x, dy = _y[p] - y, dz = _z[p] - z;
+            nearest.offer(p, dx * dx + dy * dy + dz * dz);
+        }
+        return;
+    }
+
+    size_t middle = begin + (end - begin) / 2;
+    float dx = _x[middle] - x, dy = _y[middle] - y, dz = _z[middle] - z;
+    nearest.offer(middle, dx * dx + dy * dy + dz * dz);
+
+    // Search the side of the query first, and the other side only if it
+    // can hold a nearer point.
+    int axis = _axis[middle];
+    float difference = axis == 0 ? x - _x[middle]
+        : (axis == 1 ? y - _y[middle] : z - _z[middle]);
+    if(difference < 0) {
+        search(begin, middle, x, y, z, nearest);
+        if(difference * difference < nearest.worst())
+            search(middle + 1, end, x, y, z, nearest);
+    }
+    else {
+        search(middle + 1, end, x, y, z, nearest);
+        if(difference * difference < nearest.worst())
+            search(begin, middle, x, y, z, nearest);
+    }
+}
+
+void KdTree::build(const float *x, const float *y, const float *z,
+        size_t size, ThreadPool &pool) {
+    _inputX = x;
+    _inputY = y;
+    _inputZ = z;
+
+    _sortedIndices.resize(size);
+    for(size_t i = 0; i < size; ++i)
+        _sortedIndices[i] = i;
+    _axis.assign(size, 0);
+    _nearest.clear();
+    _numNearest = 0;
+
+    // The top levels in order, the subtrees below them in parallel.
+    _subtrees.clear();
+    if(size)
+        split(0, size, 0, ParallelDepth);
+    BuildTask subtrees(*this);
+    pool.parallelFor(0, _subtrees.size(), 1, subtrees);
+
+    _x.resize(size);
+    _y.resize(size);
+    _z.resize(size);
+    for(size_t p = 0; p < size; ++p) {
+        _x[p] = x[_sortedIndices[p]];
+        _y[p] = y[_sortedIndices[p]];
+        _z[p] = z[_sortedIndices[p]];
+    }
+}
+
+size_t KdTree::findNearest(float x, float y, float z, size_t k, size_t skip,
+        unsigned *nearest, float *distances2) const {
+    if(!k)
+        return 0;
+
+    Nearest found(k, skip, nearest, distances2);
+    search(0, size(), x, y, z, found);
+    return found.count;
+}
+
+void KdTree::findAllNearest(size_t k, ThreadPool &pool) {
+    size_t size = this->size();
+    _numNearest = size ? std::min(k, size - 1) : 0;
+
+    // The kernels read whole Floats, so leave room for the last one.
+    _nearest.assign(size * _numNearest + simd::Width, 0);
+    if(!_numNearest)
+        return;
+
+    NearestTask nearest(*this);
+    pool.parallelFor(0, size, BoidsPerChunk, nearest);
+}
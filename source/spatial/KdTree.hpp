@@ -0,0 +1,158 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SPATIAL_KDTREE_HPP
+#define SPATIAL_KDTREE_HPP
+
+#include "../util/Noncopyable.hpp"
+#include "../util/ThreadPool.hpp"
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * A kd-tree over points in 3D, to find the k nearest points to each one.
+ * The tree is implicit: build() puts the points in tree order, where the
+ * node of the range [begin, end) is the median point at begin + (end -
+ * begin) / 2, and its children are the ranges before and after it. Each node
+ * splits its range in the axis where the range is widest. Ranges of up to
+ * LeafSize points are leaves, searched point by point.
+ * The top levels are split in order and the subtrees below them in parallel,
+ * always at the same depth, so the tree only depends on the points, never on
+ * the number of threads.
+ * Like in the grid, the points are referred to by their position in the tree
+ * order (see getSortedIndices()).
+ **/
+class KdTree : public NonCopyable {
+public:
+    /// Largest number of points of a leaf.
+    static const size_t LeafSize = 8;
+
+    /// Depth of the subtrees that are built in parallel.
+    static const int ParallelDepth = 6;
+
+private:
+    /// Positions of the points, in tree order.
+    std::vector<float> _x, _y, _z;
+
+    /// Index of the points in tree order.
+    std::vector<unsigned> _sortedIndices;
+
+    /// Splitting axis (0, 1 or 2) of the node at each position.
+    std::vector<unsigned char> _axis;
+
+    /// Ranges of the subtrees built in parallel.
+    std::vector<std::pair<size_t, size_t> > _subtrees;
+
+    /// Number of nearest points of each point found by findAllNearest().
+    size_t _numNearest;
+
+    /**
+     * The nearest points of each point, in tree order, _numNearest per
+     * point, padded at the end for the kernels.
+     **/
+    std::vector<unsigned> _nearest;
+
+    /// The input points of build().
+    const float *_inputX, *_inputY, *_inputZ;
+
+    /// Loop bodies run by the thread pool.
+    struct BuildTask;
+    struct NearestTask;
+
+    /// The k nearest points found so far by a search, closest first.
+    struct Nearest;
+
+    /**
+     * Splits the range into a subtree, and then its children.
+     * @param depth Depth of the range. The ranges at maxDepth are not split
+     * and are added to the subtrees instead.
+     **/
+    void split(size_t begin, size_t end, int depth, int maxDepth);
+
+    /// Searches the subtree of the range for points nearer than the ones found.
+    void search(size_t begin, size_t end, float x, float y, float z,
+            Nearest &nearest) const;
+
+public:
+    KdTree();
+
+    /**
+     * Builds the tree over the given points.
+     * @param x, y, z Position of the points.
+     * @param size Number of points.
+     **/
+    void build(const float *x, const float *y, const float *z, size_t size,
+            ThreadPool &pool);
+
+    /**
+     * Finds the k points nearest to a position.
+     * @param skip A point to leave out, in tree order, or ~0u.
+     * @param nearest Where the tree order of the points is written, closest
+     * first.
+     * @param distances2 Where their squared distance is written.
+     * @return The number of points found: k, or fewer if there are fewer
+     * points.
+     **/
+    size_t findNearest(float x, float y, float z, size_t k, size_t skip,
+            unsigned *nearest, float *distances2) const;
+
+    /**
+     * Finds the k nearest points of every point, leaving out the point
+     * itself. The searches of the points are split between the threads.
+     **/
+    void findAllNearest(size_t k, ThreadPool &pool);
+
+    /**
+     * Returns the nearest points of the point at tree position p found by
+     * findAllNearest(), closest first. They can be read simd::Width - 1
+     * indices past the end.
+     **/
+    inline const unsigned *getNearest(size_t p) const {
+        return &_nearest[p * _numNearest];
+    }
+
+    /// Returns the number of nearest points of each point.
+    inline size_t getNumNearest() const {
+        return _numNearest;
+    }
+
+    /**
+     * Returns the index of each point in the tree order: the point at
+     * position p of the tree order is the point getSortedIndices()[p].
+     **/
+    inline const unsigned *getSortedIndices() const {
+        return _sortedIndices.empty() ? 0 : &_sortedIndices[0];
+    }
+
+    /// Returns the number of points.
+    inline size_t size() const {
+        return _sortedIndices.size();
+    }
+};
+
+#endif // !SPATIAL_KDTREE_HPP
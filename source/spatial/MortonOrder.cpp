@@ -0,0 +1,123 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "MortonOrder.hpp"
+#include "../defs.hpp"
+#include <algorithm>
+#include <cmath>
+
+/**
+ * Calculates the code of each point. Each point writes its own code, so the
+ * chunks are independent.
+ **/
+struct MortonOrder::CodeTask {
+    MortonOrder &order;
+    const float *x, *y, *z;
+    float invCellSize, firstX, firstY, firstZ;
+
+    CodeTask(MortonOrder &_order, const float *_x, const float *_y,
+            const float *_z, float _invCellSize, float _firstX,
+            float _firstY, float _firstZ)
+        : order(_order), x(_x), y(_y), z(_z), invCellSize(_invCellSize),
+        firstX(_firstX), firstY(_firstY), firstZ(_firstZ) {
+
+    }
+
+    /// Returns the cell of a coordinate, counted from the first cell.
+    inline uint32_t quantize(float value, float first) const {
+        const float last = (1 << BitsPerAxis) - 1;
+        float cell = std::floor(value * invCellSize) - first;
+        return (uint32_t) std::max(0.0f, std::min(cell, last));
+    }
+
+    void operator()(size_t begin, size_t end, unsigned) {
+        for(size_t i = begin; i < end; ++i)
+            order._codes[i] = (uint32_t) encode(quantize(x[i], firstX),
+                    quantize(y[i], firstY), quantize(z[i], firstZ));
+    }
+};
+
+MortonOrder::MortonOrder() : _counts(1 << RadixBits) {
+
+}
+
+void MortonOrder::sort(const float *x, const float *y, const float *z,
+        size_t size, float cellSize, ThreadPool &pool) {
+    _order.resize(size);
+    if(!size)
+        return;
+
+    // The first cell is the aligned corner of the bounding box.
+    float minX = x[0], minY = y[0], minZ = z[0];
+    for(size_t i = 1; i < size; ++i) {
+        minX = std::min(minX, x[i]);
+        minY = std::min(minY, y[i]);
+        minZ = std::min(minZ, z[i]);
+    }
+    const float invCellSize = 1.0f / cellSize;
+    const float alignment = 1 << AlignmentBits;
+    float firstX = std::floor(std::floor(minX * invCellSize) / alignment)
+        * alignment;
+    float firstY = std::floor(std::floor(minY * invCellSize) / alignment)
+        * alignment;
+    float firstZ = std::floor(std::floor(minZ * invCellSize) / alignment)
+        * alignment;
+
+    _codes.resize(size);
+    CodeTask codes(*this, x, y, z, invCellSize, firstX, firstY, firstZ);
+    pool.parallelFor(0, size, BoidsPerChunk, codes);
+
+    // Least significant digit first. Each pass is a stable counting sort,
+    // so the points keep the order of the digits already sorted.
+    _sortedCodes.resize(size);
+    _scratch.resize(size);
+    for(size_t i = 0; i < size; ++i)
+        _order[i] = i;
+
+    const uint32_t mask = (1 << RadixBits) - 1;
+    for(int shift = 0; shift < 3 * BitsPerAxis; shift += RadixBits) {
+        std::fill(_counts.begin(), _counts.end(), 0);
+        for(size_t i = 0; i < size; ++i)
+            ++_counts[(_codes[i] >> shift) & mask];
+
+        // Turn the counts into the start of each digit.
+        unsigned start = 0;
+        for(size_t d = 0; d < _counts.size(); ++d) {
+            unsigned count = _counts[d];
+            _counts[d] = start;
+            start += count;
+        }
+
+        for(size_t i = 0; i < size; ++i) {
+            unsigned p = _counts[(_codes[i] >> shift) & mask]++;
+            _sortedCodes[p] = _codes[i];
+            _scratch[p] = _order[i];
+        }
+        _codes.swap(_sortedCodes);
+        _order.swap(_scratch);
+    }
+}
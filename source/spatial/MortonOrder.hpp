@@ -0,0 +1,131 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SPATIAL_MORTONORDER_HPP
+#define SPATIAL_MORTONORDER_HPP
+
+#include "../util/Noncopyable.hpp"
+#include "../util/ThreadPool.hpp"
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Sorts points along a Morton curve (Z-order curve): their positions are
+ * quantized to cells, and the bits of the three coordinates of the cells are
+ * interleaved into one code. Points close in space have close codes, so
+ * storing the points in the order of their codes keeps the neighbors of a
+ * point close to it in memory.
+ * The cells start at the corner of the bounding box of the points, aligned
+ * to 2^AlignmentBits cells. With the cells of a SpatialGrid, the curve then
+ * visits the cells in the same order as the blocks of the grid.
+ * The codes are calculated in parallel and sorted with a radix sort, linear
+ * in the number of points. The sort is stable, so the order only depends on
+ * the points, never on the number of threads.
+ **/
+class MortonOrder : public NonCopyable {
+public:
+    /// Bits of each coordinate in the codes. The cells past them are
+    /// clamped to the last one.
+    static const int BitsPerAxis = 10;
+
+    /// The first cell is a multiple of 2^AlignmentBits cells.
+    static const int AlignmentBits = 3;
+
+    /// Bits of the codes sorted by each pass of the radix sort.
+    static const int RadixBits = 10;
+
+private:
+    /// Code of each point, in input order and then in sorted order.
+    std::vector<uint32_t> _codes, _sortedCodes;
+
+    /// Index of the points in Morton order, and scratch space for the sort.
+    std::vector<unsigned> _order, _scratch;
+
+    /// Number of points of each digit of a pass.
+    std::vector<unsigned> _counts;
+
+    /// Loop body run by the thread pool.
+    struct CodeTask;
+
+    /// Spreads the 21 low bits of value, two zero bits between each.
+    static inline unsigned long long spreadBits(uint32_t value) {
+        unsigned long long bits = value & 0x1fffff;
+        bits = (bits | (bits << 32)) & 0x1f00000000ffffull;
+        bits = (bits | (bits << 16)) & 0x1f0000ff0000ffull;
+        bits = (bits | (bits << 8)) & 0x100f00f00f00f00full;
+        bits = (bits | (bits << 4)) & 0x10c30c30c30c30c3ull;
+        bits = (bits | (bits << 2)) & 0x1249249249249249ull;
+        return bits;
+    }
+
+public:
+    /**
+     * Returns the Morton code of the integer coordinates: their bits
+     * interleaved, x in the lowest bit. Only the 21 low bits of each
+     * coordinate are used.
+     **/
+    static inline unsigned long long encode(uint32_t x, uint32_t y,
+            uint32_t z) {
+        return spreadBits(x) | (spreadBits(y) << 1) | (spreadBits(z) << 2);
+    }
+
+    MortonOrder();
+
+    /**
+     * Sorts the points by the Morton code of their cell. The points of a cell
+     * keep their order.
+     * @param x, y, z Position of the points.
+     * @param size Number of points.
+     * @param cellSize Size of the side of the cells.
+     **/
+    void sort(const float *x, const float *y, const float *z, size_t size,
+            float cellSize, ThreadPool &pool);
+
+    /**
+     * Returns the index of each point in Morton order: the point at position
+     * p of the order is the point getOrder()[p].
+     **/
+    inline const unsigned *getOrder() const {
+        return _order.empty() ? 0 : &_order[0];
+    }
+
+    /**
+     * Returns the code of each point in Morton order: the code of the point
+     * at position p of the order is getCodes()[p].
+     **/
+    inline const uint32_t *getCodes() const {
+        return _codes.empty() ? 0 : &_codes[0];
+    }
+
+    /// Returns the number of points.
+    inline size_t size() const {
+        return _order.size();
+    }
+};
+
+#endif // !SPATIAL_MORTONORDER_HPP
@@ -0,0 +1,159 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "NeighborList.hpp"
+#include "../simd/simd.hpp"
+#include <algorithm>
+
+/**
+ * Lists the neighbors of the boids of each chunk. Each chunk writes its own
+ * lists, so the chunks are independent.
+ **/
+struct NeighborList::BuildTask {
+    NeighborList &list;
+    const SpatialGrid &grid;
+    float radius;
+
+    BuildTask(NeighborList &_list, const SpatialGrid &_grid, float _radius)
+        : list(_list), grid(_grid), radius(_radius) {
+
+    }
+
+    void operator()(size_t begin, size_t end, unsigned thread) {
+        std::vector<unsigned> &candidates = list._candidates[thread];
+        std::vector<unsigned> &neighbors = list._chunks[begin / BoidsPerChunk];
+        const float *x = &list._x[0], *y = &list._y[0], *z = &list._z[0];
+        const float radius2 = radius * radius;
+
+        neighbors.clear();
+        for(size_t p = begin; p < end; ++p) {
+            candidates.clear();
+            grid.findCandidates(x[p], y[p], z[p], radius, candidates);
+
+            // Keep the candidates inside the radius, in the order of the
+            // grid.
+            list._begin[p] = neighbors.size();
+            for(size_t c = 0; c < candidates.size(); ++c) {
+                unsigned q = candidates[c];
+                float dx = x[q] - x[p];
+                float dy = y[q] - y[p];
+                float dz = z[q] - z[p];
+                if(dx * dx + dy * dy + dz * dz < radius2)
+                    neighbors.push_back(q);
+            }
+            list._count[p] = neighbors.size() - list._begin[p];
+        }
+
+        // The kernels read whole Floats, so leave room for the last one.
+        neighbors.resize(neighbors.size() + simd::Width, 0);
+    }
+};
+
+/**
+ * Finds the largest displacement of the boids of each chunk since the
+ * build.
+ **/
+struct NeighborList::DisplacementTask {
+    NeighborList &list;
+    const BoidStore &boids;
+
+    DisplacementTask(NeighborList &_list, const BoidStore &_boids)
+        : list(_list), boids(_boids) {
+
+    }
+
+    void operator()(size_t begin, size_t end, unsigned) {
+        const float *px = boids.px(), *py = boids.py(), *pz = boids.pz();
+        float largest = 0.0f;
+        for(size_t i = begin; i < end; ++i) {
+            float dx = px[i] - list._x0[i];
+            float dy = py[i] - list._y0[i];
+            float dz = pz[i] - list._z0[i];
+            largest = std::max(largest, dx * dx + dy * dy + dz * dz);
+        }
+        list._displacements[begin / BoidsPerChunk] = largest;
+    }
+};
+
+NeighborList::NeighborList(float radius, float skin)
+        : _radius(radius), _skin(skin), _built(false), _version(0), _size(0),
+        _numBuilds(0) {
+
+}
+
+void NeighborList::setRadius(float radius, float skin) {
+    _radius = radius;
+    _skin = skin;
+    _built = false;
+}
+
+bool NeighborList::needsRebuild(const BoidStore &boids, float margin,
+        ThreadPool &pool) {
+    if(!_built || boids.getVersion() != _version || boids.size() != _size)
+        return true;
+
+    size_t size = boids.size();
+    _displacements.resize(ThreadPool::getNumChunks(0, size, BoidsPerChunk));
+    DisplacementTask displacements(*this, boids);
+    pool.parallelFor(0, size, BoidsPerChunk, displacements);
+
+    float largest = 0.0f;
+    for(size_t c = 0; c < _displacements.size(); ++c)
+        largest = std::max(largest, _displacements[c]);
+
+    // Two boids coming at each other close the gap twice as fast.
+    return 2 * (std::sqrt(largest) + margin) > _skin;
+}
+
+void NeighborList::build(const SpatialGrid &grid, const BoidStore &boids,
+        ThreadPool &pool) {
+    size_t size = grid.size();
+
+    // Remember where the boids were, to know how much they moved.
+    _x0.assign(boids.px(), boids.px() + size);
+    _y0.assign(boids.py(), boids.py() + size);
+    _z0.assign(boids.pz(), boids.pz() + size);
+
+    _x.resize(size);
+    _y.resize(size);
+    _z.resize(size);
+    grid.gather(boids.px(), _x.empty() ? 0 : &_x[0]);
+    grid.gather(boids.py(), _y.empty() ? 0 : &_y[0]);
+    grid.gather(boids.pz(), _z.empty() ? 0 : &_z[0]);
+
+    _begin.resize(size);
+    _count.resize(size);
+    _chunks.resize(ThreadPool::getNumChunks(0, size, BoidsPerChunk));
+    _candidates.resize(pool.getNumThreads());
+    BuildTask lists(*this, grid, _radius + _skin);
+    pool.parallelFor(0, size, BoidsPerChunk, lists);
+
+    _built = true;
+    _version = boids.getVersion();
+    _size = size;
+    ++_numBuilds;
+}
@@ -0,0 +1,161 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SPATIAL_NEIGHBORLIST_HPP
+#define SPATIAL_NEIGHBORLIST_HPP
+
+#include "SpatialGrid.hpp"
+#include "../defs.hpp"
+#include "../gameObject/BoidStore.hpp"
+#include "../util/Noncopyable.hpp"
+#include "../util/ThreadPool.hpp"
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Verlet neighbor lists: for each boid, the boids that were closer than
+ * radius + skin when the lists were built.
+ * While no boid has moved more than skin / 2 since the build, every pair of
+ * boids closer than radius is still in the lists, so the lists can replace
+ * the grid queries for many ticks. needsRebuild() tracks the largest
+ * displacement since the build, and the lists are rebuilt from a freshly
+ * rebuilt grid only when the skin could be violated.
+ * The lists follow the sorted order of the grid they were built with: the
+ * list of the boid at sorted position p holds sorted positions too, ready
+ * for the SIMD kernels.
+ **/
+class NeighborList : public NonCopyable {
+    /// Radius of the neighbors that must be in the lists.
+    float _radius;
+
+    /// Extra distance the boids can move before the lists are stale.
+    float _skin;
+
+    /// If the lists were built.
+    bool _built;
+
+    /// Version of the boids when the lists were built.
+    uint32_t _version;
+
+    /// Number of boids of the lists.
+    size_t _size;
+
+    /// Number of builds.
+    unsigned long _numBuilds;
+
+    /// Positions of the boids at the last build, in the order of the store.
+    std::vector<float> _x0, _y0, _z0;
+
+    /// Positions of the boids in the order of the grid, for the build.
+    std::vector<float> _x, _y, _z;
+
+    /**
+     * Where the list of the boid at each sorted position starts in the lists
+     * of its chunk, and how long it is.
+     **/
+    std::vector<unsigned> _begin, _count;
+
+    /**
+     * The lists of each chunk of BoidsPerChunk sorted positions, one after
+     * the other, padded at the end for the kernels (see simd::Width). Each
+     * chunk is built by its own task, with no merge.
+     **/
+    std::vector<std::vector<unsigned> > _chunks;
+
+    /// Candidate neighbors of the boid being listed, for each thread.
+    std::vector<std::vector<unsigned> > _candidates;
+
+    /// Largest squared displacement of the boids of each chunk.
+    std::vector<float> _displacements;
+
+    /// Loop bodies run by the thread pool.
+    struct BuildTask;
+    struct DisplacementTask;
+
+public:
+    /**
+     * Creates empty lists.
+     * @param radius Radius of the neighbors that must be in the lists.
+     * @param skin Extra distance the boids can move between two builds.
+     **/
+    NeighborList(float radius, float skin);
+
+    /// Changes the radius and the skin. The lists must be rebuilt.
+    void setRadius(float radius, float skin);
+
+    /**
+     * Returns if the lists must be rebuilt before they are used: if boids
+     * were added or removed since the build, or if they could have moved
+     * more than the skin allows.
+     * @param margin How much more the boids move before the last use of the
+     * lists, on top of how much they have moved already.
+     **/
+    bool needsRebuild(const BoidStore &boids, float margin, ThreadPool &pool);
+
+    /**
+     * Builds the lists.
+     * @param grid Grid just rebuilt with the current positions of the boids.
+     **/
+    void build(const SpatialGrid &grid, const BoidStore &boids,
+            ThreadPool &pool);
+
+    /**
+     * Returns the list of the boid at sorted position p. The list can be
+     * read simd::Width - 1 indices past its end.
+     **/
+    inline const unsigned *getNeighbors(size_t p) const {
+        return &_chunks[p / BoidsPerChunk][_begin[p]];
+    }
+
+    /// Returns the length of the list of the boid at sorted position p.
+    inline size_t getNumNeighbors(size_t p) const {
+        return _count[p];
+    }
+
+    /// Returns the number of boids of the lists.
+    inline size_t size() const {
+        return _size;
+    }
+
+    /// Returns the radius of the neighbors that must be in the lists.
+    inline float getRadius() const {
+        return _radius;
+    }
+
+    /// Returns the extra distance the boids can move between two builds.
+    inline float getSkin() const {
+        return _skin;
+    }
+
+    /// Returns how many times the lists were built.
+    inline unsigned long getNumBuilds() const {
+        return _numBuilds;
+    }
+};
+
+#endif // !SPATIAL_NEIGHBORLIST_HPP
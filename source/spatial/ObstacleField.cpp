@@ -0,0 +1,376 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ObstacleField.hpp"
+#include "../defs.hpp"
+#include "../math/math.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdint.h>
+
+namespace {
+    /// First bytes of the files of the fields.
+    const char FileMagic[4] = { 'B', 'S', 'D', 'F' };
+
+    /// Version of the format of the files.
+    const uint32_t FileVersion = 1;
+
+    /// Number of bricks classified or baked at a time by a thread.
+    const size_t BricksPerChunk = 16;
+
+    /// Writes a value as its bytes.
+    template<typename T>
+    void write(std::ostream &out, const T &value) {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    /// Reads a value written by write().
+    template<typename T>
+    bool read(std::istream &in, T &value) {
+        return (bool) in.read(reinterpret_cast<char *>(&value),
+                sizeof(value));
+    }
+}
+
+const float ObstacleField::Band = BrickCells * ObstacleFieldCellSize;
+
+float Obstacle::distance(float px, float py, float pz) const {
+    float dx = px - x, dz = pz - z;
+    float r = std::sqrt(dx * dx + dz * dz);
+
+    if(shape == PillarShape) {
+        // Distance to the side or to the top, whichever is closer outside,
+        // or farther inside.
+        float side = r - radius, top = py - height;
+        float outX = std::max(side, 0.0f), outY = std::max(top, 0.0f);
+        return std::sqrt(outX * outX + outY * outY)
+            + std::min(std::max(side, top), 0.0f);
+    }
+
+    // In the plane of the axis, the cone is the triangle (0, 0), (radius, 0),
+    // (0, height). The distance is to the nearest point of its side, from
+    // (radius, 0) to (0, height), or of its base.
+    float ex = -radius, ey = height;
+    float t = ((r - radius) * ex + py * ey) / (ex * ex + ey * ey);
+    t = std::min(std::max(t, 0.0f), 1.0f);
+    float sx = r - radius - ex * t, sy = py - ey * t;
+    float baseX = std::max(r - radius, 0.0f);
+    float closest = std::sqrt(std::min(sx * sx + sy * sy,
+                baseX * baseX + py * py));
+
+    bool inside = py > 0.0f && height * r + radius * py < radius * height;
+    return inside ? -closest : closest;
+}
+
+/// Marks the bricks closer than the band to an obstacle.
+struct ObstacleField::ClassifyTask {
+    ObstacleField &field;
+
+    ClassifyTask(ObstacleField &_field) : field(_field) {
+
+    }
+
+    void operator()(size_t begin, size_t end, unsigned) {
+        // The distance changes at most as much as the position, so if the
+        // center of a brick is farther than the band plus half its diagonal,
+        // all its samples are farther than the band.
+        const float size = BrickCells * ObstacleFieldCellSize;
+        const float reach = Band + std::sqrt(3.0f) * size / 2;
+        for(size_t b = begin; b < end; ++b) {
+            size_t bx = b % field._bricksX;
+            size_t by = b / field._bricksX % field._bricksY;
+            size_t bz = b / field._bricksX / field._bricksY;
+            float distance = field.distance(field._minX + (bx + 0.5f) * size,
+                    field._minY + (by + 0.5f) * size,
+                    field._minZ + (bz + 0.5f) * size);
+            field._brickOffsets[b] = distance < reach ? 0 : -1;
+        }
+    }
+};
+
+/// Samples the distance at the corners of the cells of the stored bricks.
+struct ObstacleField::BakeTask {
+    ObstacleField &field;
+
+    BakeTask(ObstacleField &_field) : field(_field) {
+
+    }
+
+    void operator()(size_t begin, size_t end, unsigned) {
+        std::vector<Obstacle> close;
+        for(size_t b = begin; b < end; ++b) {
+            int offset = field._brickOffsets[b];
+            if(offset < 0)
+                continue;
+
+            const float cell = ObstacleFieldCellSize;
+            size_t bx = b % field._bricksX;
+            size_t by = b / field._bricksX % field._bricksY;
+            size_t bz = b / field._bricksX / field._bricksY;
+            float x = field._minX + bx * BrickCells * cell;
+            float y = field._minY + by * BrickCells * cell;
+            float z = field._minZ + bz * BrickCells * cell;
+
+            // The samples are at most half a diagonal from the center, so
+            // only the obstacles within a diagonal of the nearest one to the
+            // center can be the nearest to a sample.
+            const float size = BrickCells * cell;
+            const float diagonal = std::sqrt(3.0f) * size;
+            std::vector<float> centerDistances(field._obstacles.size());
+            float nearest = std::numeric_limits<float>::infinity();
+            for(size_t o = 0; o < field._obstacles.size(); ++o) {
+                centerDistances[o] = field._obstacles[o].distance(
+                        x + size / 2, y + size / 2, z + size / 2);
+                nearest = std::min(nearest, centerDistances[o]);
+            }
+            close.clear();
+            for(size_t o = 0; o < field._obstacles.size(); ++o)
+                if(centerDistances[o] <= nearest + diagonal)
+                    close.push_back(field._obstacles[o]);
+
+            float *samples = &field._samples[offset];
+            for(unsigned k = 0; k < BrickSamples; ++k)
+                for(unsigned j = 0; j < BrickSamples; ++j)
+                    for(unsigned i = 0; i < BrickSamples; ++i) {
+                        float distance = nearest + diagonal;
+                        for(size_t o = 0; o < close.size(); ++o)
+                            distance = std::min(distance, close[o].distance(
+                                        x + i * cell, y + j * cell,
+                                        z + k * cell));
+                        *samples++ = distance;
+                    }
+        }
+    }
+};
+
+ObstacleField::ObstacleField()
+        : _minX(-GroundSize / 2), _minY(0.0), _minZ(-GroundSize / 2) {
+    const float size = BrickCells * ObstacleFieldCellSize;
+    _bricksX = std::ceil(GroundSize / size);
+    _bricksY = std::ceil(MaximumHeight / size);
+    _bricksZ = std::ceil(GroundSize / size);
+}
+
+float ObstacleField::distance(float x, float y, float z) const {
+    float nearest = std::numeric_limits<float>::infinity();
+    for(size_t o = 0; o < _obstacles.size(); ++o)
+        nearest = std::min(nearest, _obstacles[o].distance(x, y, z));
+    return nearest;
+}
+
+void ObstacleField::add(const Obstacle &obstacle) {
+    _obstacles.push_back(obstacle);
+}
+
+void ObstacleField::clear() {
+    _obstacles.clear();
+    _brickOffsets.clear();
+    _samples.clear();
+}
+
+void ObstacleField::bake(ThreadPool &pool) {
+    size_t numBricks = (size_t) _bricksX * _bricksY * _bricksZ;
+    _brickOffsets.assign(numBricks, -1);
+    _samples.clear();
+    if(_obstacles.empty())
+        return;
+
+    ClassifyTask classify(*this);
+    pool.parallelFor(0, numBricks, BricksPerChunk, classify);
+
+    // The stored bricks are placed in order.
+    int offset = 0;
+    for(size_t b = 0; b < numBricks; ++b) {
+        if(_brickOffsets[b] < 0)
+            continue;
+
+        _brickOffsets[b] = offset;
+        offset += BrickSize;
+    }
+
+    _samples.resize(offset);
+    BakeTask samples(*this);
+    pool.parallelFor(0, numBricks, BricksPerChunk, samples);
+}
+
+bool ObstacleField::save(const std::string &file) const {
+    // Write to another file first, so that a field is never read half
+    // written.
+    std::string temporary = file + ".tmp";
+    bool written;
+    {
+        std::ofstream out(temporary.c_str(), std::ios::binary);
+        if(!out)
+            return false;
+
+        out.write(FileMagic, sizeof(FileMagic));
+        write(out, FileVersion);
+        write(out, (uint32_t) _obstacles.size());
+        for(size_t o = 0; o < _obstacles.size(); ++o) {
+            const Obstacle &obstacle = _obstacles[o];
+            write(out, (uint32_t) obstacle.shape);
+            write(out, obstacle.x);
+            write(out, obstacle.z);
+            write(out, obstacle.radius);
+            write(out, obstacle.height);
+        }
+
+        write(out, ObstacleFieldCellSize);
+        write(out, (uint32_t) _brickOffsets.size());
+        write(out, (uint32_t) _samples.size());
+        if(!_brickOffsets.empty())
+            out.write(reinterpret_cast<const char *>(&_brickOffsets[0]),
+                    _brickOffsets.size() * sizeof(int));
+        if(!_samples.empty())
+            out.write(reinterpret_cast<const char *>(&_samples[0]),
+                    _samples.size() * sizeof(float));
+        written = !out.fail();
+    }
+
+#ifdef _WIN32
+    // rename() doesn't replace an existing file on Windows.
+    if(written)
+        std::remove(file.c_str());
+#endif
+
+    // Don't leave a half written file behind.
+    if(!written || std::rename(temporary.c_str(), file.c_str())) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool ObstacleField::load(const std::string &file) {
+    std::ifstream in(file.c_str(), std::ios::binary);
+    char magic[sizeof(FileMagic)];
+    uint32_t version, numObstacles;
+    if(!in || !in.read(magic, sizeof(magic))
+            || std::memcmp(magic, FileMagic, sizeof(magic))
+            || !read(in, version) || version != FileVersion
+            || !read(in, numObstacles) || numObstacles != _obstacles.size())
+        return false;
+
+    // Only a field of the same obstacles, bit by bit, can be used.
+    for(size_t o = 0; o < _obstacles.size(); ++o) {
+        const Obstacle &obstacle = _obstacles[o];
+        uint32_t shape;
+        float x, z, radius, height;
+        if(!read(in, shape) || !read(in, x) || !read(in, z)
+                || !read(in, radius) || !read(in, height)
+                || shape != (uint32_t) obstacle.shape
+                || std::memcmp(&x, &obstacle.x, sizeof(x))
+                || std::memcmp(&z, &obstacle.z, sizeof(z))
+                || std::memcmp(&radius, &obstacle.radius, sizeof(radius))
+                || std::memcmp(&height, &obstacle.height, sizeof(height)))
+            return false;
+    }
+
+    float cellSize;
+    uint32_t numBricks, numSamples;
+    if(!read(in, cellSize) || cellSize != ObstacleFieldCellSize
+            || !read(in, numBricks)
+            || numBricks != (size_t) _bricksX * _bricksY * _bricksZ
+            || !read(in, numSamples) || numSamples % BrickSize)
+        return false;
+
+    std::vector<int> offsets(numBricks);
+    std::vector<float> samples(numSamples);
+    if(numBricks && !in.read(reinterpret_cast<char *>(&offsets[0]),
+                numBricks * sizeof(int)))
+        return false;
+    if(numSamples && !in.read(reinterpret_cast<char *>(&samples[0]),
+                numSamples * sizeof(float)))
+        return false;
+
+    // Don't trust the offsets to be inside the samples.
+    for(size_t b = 0; b < numBricks; ++b)
+        if(offsets[b] >= 0 && (offsets[b] % BrickSize
+                    || offsets[b] + BrickSize > numSamples))
+            return false;
+
+    _brickOffsets.swap(offsets);
+    _samples.swap(samples);
+    return true;
+}
+
+float ObstacleField::sample(float x, float y, float z, float &gx, float &gy,
+        float &gz) const {
+    const float invCellSize = 1.0f / ObstacleFieldCellSize;
+    float fx = (x - _minX) * invCellSize;
+    float fy = (y - _minY) * invCellSize;
+    float fz = (z - _minZ) * invCellSize;
+
+    // Outside the field, or in an empty brick.
+    int offset = -1;
+    if(fx >= 0.0f && fy >= 0.0f && fz >= 0.0f
+            && fx < _bricksX * BrickCells && fy < _bricksY * BrickCells
+            && fz < _bricksZ * BrickCells && !_brickOffsets.empty()) {
+        unsigned cx = fx, cy = fy, cz = fz;
+        offset = _brickOffsets[((cz >> BrickBits) * _bricksY
+                + (cy >> BrickBits)) * _bricksX + (cx >> BrickBits)];
+        if(offset >= 0) {
+            const unsigned mask = BrickCells - 1;
+            offset += ((cz & mask) * BrickSamples + (cy & mask))
+                * BrickSamples + (cx & mask);
+            fx -= cx;
+            fy -= cy;
+            fz -= cz;
+        }
+    }
+
+    if(offset < 0) {
+        gx = gy = gz = 0.0f;
+        return Band;
+    }
+
+    // The corners of the cell.
+    const unsigned dy = BrickSamples, dz = BrickSamples * BrickSamples;
+    const float *s = &_samples[offset];
+    float c000 = s[0], c100 = s[1], c010 = s[dy], c110 = s[dy + 1];
+    float c001 = s[dz], c101 = s[dz + 1], c011 = s[dz + dy];
+    float c111 = s[dz + dy + 1];
+
+    // Interpolate along x, then y, then z.
+    float c00 = c000 + (c100 - c000) * fx, c10 = c010 + (c110 - c010) * fx;
+    float c01 = c001 + (c101 - c001) * fx, c11 = c011 + (c111 - c011) * fx;
+    float c0 = c00 + (c10 - c00) * fy, c1 = c01 + (c11 - c01) * fy;
+
+    // The derivatives of the interpolation.
+    float dx0 = (c100 - c000) + ((c110 - c010) - (c100 - c000)) * fy;
+    float dx1 = (c101 - c001) + ((c111 - c011) - (c101 - c001)) * fy;
+    gx = (dx0 + (dx1 - dx0) * fz) * invCellSize;
+    gy = ((c10 - c00) + ((c11 - c01) - (c10 - c00)) * fz) * invCellSize;
+    gz = (c1 - c0) * invCellSize;
+
+    return c0 + (c1 - c0) * fz;
+}
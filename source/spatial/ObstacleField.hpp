@@ -0,0 +1,181 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SPATIAL_OBSTACLEFIELD_HPP
+#define SPATIAL_OBSTACLEFIELD_HPP
+
+#include "../util/Noncopyable.hpp"
+#include "../util/ThreadPool.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// A static obstacle standing on the ground (y = 0).
+struct Obstacle {
+    /// Shapes of the obstacles.
+    enum Shape {
+        /// A cone with its apex above the center of its base, like the tower.
+        ConeShape,
+
+        /// A vertical cylinder with a flat top.
+        PillarShape
+    };
+
+    Shape shape;
+
+    /// Center of the base.
+    float x, z;
+
+    /// Radius of the base.
+    float radius;
+
+    /// Height of the top.
+    float height;
+
+    /**
+     * Returns the signed distance from a point to the obstacle: positive
+     * outside, negative inside.
+     **/
+    float distance(float px, float py, float pz) const;
+};
+
+/**
+ * The static obstacles of the world, baked into a signed distance field, so
+ * that the distance to the nearest one and its gradient cost the same
+ * lookup however many obstacles there are.
+ * The field covers the ground (GroundSize by GroundSize) up to
+ * MaximumHeight with cells of ObstacleFieldCellSize, and is sparse: the
+ * cells are grouped in bricks of BrickCells^3 cells, and only the bricks
+ * closer than Band to an obstacle are stored. Everywhere else, and outside
+ * the field, the distance is Band and the gradient is zero.
+ * Each brick stores the distance at the corners of its cells, with the
+ * corners it shares with the next bricks, so a trilinear lookup never
+ * crosses bricks.
+ * The bricks are baked in parallel, each one by itself, so the field only
+ * depends on the obstacles. It can be saved to a file and loaded back
+ * instead of baked, for the same obstacles.
+ **/
+class ObstacleField : public NonCopyable {
+public:
+    /// Number of cells of a side of a brick, as a power of two.
+    static const unsigned BrickBits = 3;
+
+    /// Number of cells of a side of a brick.
+    static const unsigned BrickCells = 1 << BrickBits;
+
+    /// Number of samples of a side of a brick: the corners of its cells.
+    static const unsigned BrickSamples = BrickCells + 1;
+
+    /// Number of samples of a brick.
+    static const unsigned BrickSize = BrickSamples * BrickSamples
+        * BrickSamples;
+
+    /// Distance of the empty bricks, the size of the side of a brick.
+    static const float Band;
+
+private:
+    /// The obstacles.
+    std::vector<Obstacle> _obstacles;
+
+    /// Corner of the field with the lowest coordinates.
+    float _minX, _minY, _minZ;
+
+    /// Number of bricks along each axis.
+    unsigned _bricksX, _bricksY, _bricksZ;
+
+    /// First sample of each brick in _samples, or -1 if it is empty.
+    std::vector<int> _brickOffsets;
+
+    /// Samples of the stored bricks, z major, then y, then x.
+    std::vector<float> _samples;
+
+    /// Loop bodies run by the thread pool.
+    struct ClassifyTask;
+    struct BakeTask;
+
+    /// Returns the distance from a point to the nearest obstacle.
+    float distance(float x, float y, float z) const;
+
+public:
+    ObstacleField();
+
+    /// Adds an obstacle. The field must be baked again.
+    void add(const Obstacle &obstacle);
+
+    /// Removes all the obstacles and empties the field.
+    void clear();
+
+    /**
+     * Bakes the obstacles into the field, splitting the bricks between the
+     * threads.
+     **/
+    void bake(ThreadPool &pool);
+
+    /**
+     * Saves the field to a file.
+     * @return false if the file couldn't be written.
+     **/
+    bool save(const std::string &file) const;
+
+    /**
+     * Loads the field saved in a file, if it was baked from the same
+     * obstacles.
+     * @return false if the file couldn't be read or has other obstacles, in
+     * which case the field is left as it was.
+     **/
+    bool load(const std::string &file);
+
+    /**
+     * Returns the distance from a point to the nearest obstacle, interpolated
+     * between the corners of its cell, and stores its gradient in (gx, gy,
+     * gz).
+     **/
+    float sample(float x, float y, float z, float &gx, float &gy,
+            float &gz) const;
+
+    /// Returns the obstacles.
+    inline const std::vector<Obstacle> &getObstacles() const {
+        return _obstacles;
+    }
+
+    /// Returns if there are no obstacles.
+    inline bool empty() const {
+        return _obstacles.empty();
+    }
+
+    /// Returns the number of bricks of the field.
+    inline size_t getNumBricks() const {
+        return _brickOffsets.size();
+    }
+
+    /// Returns the number of bricks stored.
+    inline size_t getNumStoredBricks() const {
+        return _samples.size() / BrickSize;
+    }
+};
+
+#endif // !SPATIAL_OBSTACLEFIELD_HPP
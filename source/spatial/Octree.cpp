@@ -0,0 +1,302 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Octree.hpp"
+#include "../defs.hpp"
+#include <algorithm>
+
+/// Builds the subtrees below the top levels of the tree.
+struct Octree::BuildTask {
+    Octree &tree;
+
+    BuildTask(Octree &_tree) : tree(_tree) {
+
+    }
+
+    void operator()(size_t begin, size_t end, unsigned) {
+        for(size_t s = begin; s < end; ++s)
+            tree.split(tree._subtreeNodes[s], 0, ParallelDepth, -1);
+    }
+};
+
+/**
+ * Finds the centroid of each point. Each point writes its own centroid, so
+ * the chunks are independent.
+ **/
+struct Octree::CentroidTask {
+    Octree &tree;
+    float openingAngle2, softening2;
+    bool exact;
+
+    CentroidTask(Octree &_tree, float openingAngle, float softening,
+            bool _exact)
+        : tree(_tree), openingAngle2(openingAngle * openingAngle),
+        softening2(softening * softening), exact(_exact) {
+
+    }
+
+    void operator()(size_t begin, size_t end, unsigned) {
+        const unsigned *order = tree._order.getOrder();
+        for(size_t p = begin; p < end; ++p) {
+            double weight = 0.0, x = 0.0, y = 0.0, z = 0.0;
+            if(exact) {
+                for(size_t i = 0; i < tree.size(); ++i) {
+                    if(i == p)
+                        continue;
+
+                    float dx = tree._x[i] - tree._x[p];
+                    float dy = tree._y[i] - tree._y[p];
+                    float dz = tree._z[i] - tree._z[p];
+                    double w = 1.0 / (dx * dx + dy * dy + dz * dz
+                            + softening2);
+                    weight += w;
+                    x += w * tree._x[i];
+                    y += w * tree._y[i];
+                    z += w * tree._z[i];
+                }
+            }
+            else
+                tree.sumPull(p, openingAngle2, softening2, weight, x, y, z);
+
+            // Alone, the point pulls itself.
+            unsigned i = order[p];
+            if(weight > 0.0) {
+                tree._centroidX[i] = (float) (x / weight);
+                tree._centroidY[i] = (float) (y / weight);
+                tree._centroidZ[i] = (float) (z / weight);
+            }
+            else {
+                tree._centroidX[i] = tree._x[p];
+                tree._centroidY[i] = tree._y[p];
+                tree._centroidZ[i] = tree._z[p];
+            }
+        }
+    }
+};
+
+void Octree::split(std::vector<Node> &nodes, unsigned n, int depth,
+        int maxDepth) {
+    Node node = nodes[n];
+    if(node.end - node.begin > LeafSize && depth < MaxDepth) {
+        if(depth == maxDepth) {
+            _subtrees.push_back(n);
+            return;
+        }
+
+        // The points of a child share the next 3 bits of their codes, and
+        // are contiguous in the order.
+        const uint32_t *codes = _order.getCodes();
+        const int shift = 3 * (MaxDepth - 1 - depth);
+        unsigned firstChild = nodes.size(), numChildren = 0;
+        for(unsigned p = node.begin; p < node.end; ) {
+            uint32_t digit = (codes[p] >> shift) & 7;
+            Node child = Node();
+            child.size = node.size * 0.5f;
+            child.begin = p;
+            while(p < node.end && ((codes[p] >> shift) & 7) == digit)
+                ++p;
+            child.end = p;
+            nodes.push_back(child);
+            ++numChildren;
+        }
+        nodes[n].firstChild = firstChild;
+        nodes[n].numChildren = numChildren;
+
+        for(unsigned c = 0; c < numChildren; ++c)
+            split(nodes, firstChild + c, depth + 1, maxDepth);
+
+        // The nodes above the subtrees are summed after them.
+        if(maxDepth < 0)
+            sumChildren(nodes, n);
+        return;
+    }
+
+    // A leaf: the center of mass of its points.
+    double x = 0.0, y = 0.0, z = 0.0;
+    for(unsigned p = node.begin; p < node.end; ++p) {
+        x += _x[p];
+        y += _y[p];
+        z += _z[p];
+    }
+    double mass = node.end - node.begin;
+    nodes[n].x = (float) (x / mass);
+    nodes[n].y = (float) (y / mass);
+    nodes[n].z = (float) (z / mass);
+    nodes[n].mass = (float) mass;
+}
+
+void Octree::sumChildren(std::vector<Node> &nodes, unsigned n) {
+    double x = 0.0, y = 0.0, z = 0.0, mass = 0.0;
+    const Node &node = nodes[n];
+    for(unsigned c = node.firstChild; c < node.firstChild + node.numChildren;
+            ++c) {
+        const Node &child = nodes[c];
+        x += (double) child.x * child.mass;
+        y += (double) child.y * child.mass;
+        z += (double) child.z * child.mass;
+        mass += child.mass;
+    }
+    nodes[n].x = (float) (x / mass);
+    nodes[n].y = (float) (y / mass);
+    nodes[n].z = (float) (z / mass);
+    nodes[n].mass = (float) mass;
+}
+
+void Octree::sumTop(unsigned n, int depth) {
+    const Node &node = _nodes[n];
+    if(depth == ParallelDepth || !node.numChildren)
+        return;
+
+    for(unsigned c = node.firstChild; c < node.firstChild + node.numChildren;
+            ++c)
+        sumTop(c, depth + 1);
+    sumChildren(_nodes, n);
+}
+
+void Octree::sumPull(size_t p, float openingAngle2, float softening2,
+        double &weight, double &x, double &y, double &z) const {
+    // At most 7 siblings wait at each level, and the deepest children.
+    unsigned stack[7 * MaxDepth + 8];
+    size_t top = 0;
+    stack[top++] = 0;
+
+    const float px = _x[p], py = _y[p], pz = _z[p];
+    while(top) {
+        const Node &node = _nodes[stack[--top]];
+        if(!node.numChildren) {
+            for(unsigned i = node.begin; i < node.end; ++i) {
+                if(i == p)
+                    continue;
+
+                float dx = _x[i] - px, dy = _y[i] - py, dz = _z[i] - pz;
+                double w = 1.0 / (dx * dx + dy * dy + dz * dz + softening2);
+                weight += w;
+                x += w * _x[i];
+                y += w * _y[i];
+                z += w * _z[i];
+            }
+            continue;
+        }
+
+        // A node far enough counts as one point at its center of mass. The
+        // node of the point itself is always opened, to leave it out.
+        if(p < node.begin || p >= node.end) {
+            float dx = node.x - px, dy = node.y - py, dz = node.z - pz;
+            float distance2 = dx * dx + dy * dy + dz * dz;
+            if(node.size * node.size < openingAngle2 * distance2) {
+                double w = node.mass / (distance2 + softening2);
+                weight += w;
+                x += w * node.x;
+                y += w * node.y;
+                z += w * node.z;
+                continue;
+            }
+        }
+
+        for(unsigned c = node.firstChild;
+                c < node.firstChild + node.numChildren; ++c)
+            stack[top++] = c;
+    }
+}
+
+void Octree::build(const float *x, const float *y, const float *z,
+        size_t size, ThreadPool &pool) {
+    _nodes.clear();
+    _x.resize(size);
+    _y.resize(size);
+    _z.resize(size);
+    if(!size)
+        return;
+
+    // The cells split the widest side of the bounding box in about
+    // 2^MaxDepth, leaving room for the alignment of the first one.
+    float minX = x[0], minY = y[0], minZ = z[0];
+    float maxX = minX, maxY = minY, maxZ = minZ;
+    for(size_t i = 1; i < size; ++i) {
+        minX = std::min(minX, x[i]);
+        minY = std::min(minY, y[i]);
+        minZ = std::min(minZ, z[i]);
+        maxX = std::max(maxX, x[i]);
+        maxY = std::max(maxY, y[i]);
+        maxZ = std::max(maxZ, z[i]);
+    }
+    float extent = std::max(maxX - minX, std::max(maxY - minY, maxZ - minZ));
+    const int cells = (1 << MaxDepth) - 3 * (1 << MortonOrder::AlignmentBits);
+    float cellSize = extent > 0.0f ? extent / cells : 1.0f;
+    _order.sort(x, y, z, size, cellSize, pool);
+
+    const unsigned *order = _order.getOrder();
+    for(size_t p = 0; p < size; ++p) {
+        _x[p] = x[order[p]];
+        _y[p] = y[order[p]];
+        _z[p] = z[order[p]];
+    }
+
+    Node root = Node();
+    root.size = cellSize * (1 << MaxDepth);
+    root.end = size;
+    _nodes.push_back(root);
+
+    // The top levels in order, the subtrees below them in parallel.
+    _subtrees.clear();
+    split(_nodes, 0, 0, ParallelDepth);
+    _subtreeNodes.resize(_subtrees.size());
+    for(size_t s = 0; s < _subtrees.size(); ++s)
+        _subtreeNodes[s].assign(1, _nodes[_subtrees[s]]);
+    BuildTask subtrees(*this);
+    pool.parallelFor(0, _subtrees.size(), 1, subtrees);
+
+    // Move the subtrees after the top levels. The root of each one takes
+    // the place of its node.
+    for(size_t s = 0; s < _subtrees.size(); ++s) {
+        std::vector<Node> &nodes = _subtreeNodes[s];
+        unsigned offset = _nodes.size() - 1;
+        for(size_t n = 0; n < nodes.size(); ++n)
+            if(nodes[n].numChildren)
+                nodes[n].firstChild += offset;
+        _nodes[_subtrees[s]] = nodes[0];
+        _nodes.insert(_nodes.end(), nodes.begin() + 1, nodes.end());
+    }
+    sumTop(0, 0);
+}
+
+void Octree::findCentroids(float openingAngle, float softening,
+        ThreadPool &pool) {
+    _centroidX.resize(size());
+    _centroidY.resize(size());
+    _centroidZ.resize(size());
+    CentroidTask centroids(*this, openingAngle, softening, false);
+    pool.parallelFor(0, size(), BoidsPerChunk, centroids);
+}
+
+void Octree::findCentroidsExact(float softening, ThreadPool &pool) {
+    _centroidX.resize(size());
+    _centroidY.resize(size());
+    _centroidZ.resize(size());
+    CentroidTask centroids(*this, 0.0f, softening, true);
+    pool.parallelFor(0, size(), BoidsPerChunk, centroids);
+}
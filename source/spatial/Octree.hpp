@@ -0,0 +1,190 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SPATIAL_OCTREE_HPP
+#define SPATIAL_OCTREE_HPP
+
+#include "MortonOrder.hpp"
+#include "../util/Noncopyable.hpp"
+#include "../util/ThreadPool.hpp"
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * An octree over points in 3D, with the center of mass of the points of
+ * each node, to find how the whole set of points pulls each one of them in
+ * O(log n) with the Barnes-Hut approximation.
+ * The pull of a set of points on a position is the centroid of the points
+ * weighted by 1 / (d^2 + softening^2), where d is their distance to the
+ * position: the whole set counts, but the close points count more. A node
+ * whose cube is small compared to its distance (size / d < the opening
+ * angle) counts as one point of its mass at its center of mass, and the
+ * others are opened. An opening angle of 0 opens every node, and is exact.
+ * The points are sorted along a Morton curve of 2^MaxDepth cells per axis,
+ * so the points of every node are contiguous: the children of a node are
+ * the ranges of its points with the same next 3 bits of their codes. Ranges
+ * of up to LeafSize points are leaves, summed point by point.
+ * The top levels are split in order and the subtrees below them in
+ * parallel, always at the same depth, so the tree only depends on the
+ * points, never on the number of threads.
+ **/
+class Octree : public NonCopyable {
+public:
+    /// Largest number of points of a leaf.
+    static const size_t LeafSize = 8;
+
+    /// Depth of the cells of the Morton codes, below which nodes aren't
+    /// split.
+    static const int MaxDepth = MortonOrder::BitsPerAxis;
+
+    /// Depth of the subtrees that are built in parallel.
+    static const int ParallelDepth = 2;
+
+private:
+    /// A node: a cube with the points of a range of the Morton order.
+    struct Node {
+        /// Center of mass of the points.
+        float x, y, z;
+
+        /// Number of points.
+        float mass;
+
+        /// Side of the cube.
+        float size;
+
+        /// Range of the points in the Morton order.
+        unsigned begin, end;
+
+        /// Index of the first child and number of children, 0 for leaves.
+        /// The children of a node are contiguous.
+        unsigned firstChild, numChildren;
+    };
+
+    /// The sort of the points along the Morton curve.
+    MortonOrder _order;
+
+    /// Positions of the points, in Morton order.
+    std::vector<float> _x, _y, _z;
+
+    /// The nodes. The root is the first one.
+    std::vector<Node> _nodes;
+
+    /// Nodes at ParallelDepth, whose subtrees are built in parallel.
+    std::vector<unsigned> _subtrees;
+
+    /// The nodes of each subtree, its root first, before they are merged.
+    std::vector<std::vector<Node> > _subtreeNodes;
+
+    /// Centroid weighted by distance of every point, in input order.
+    std::vector<float> _centroidX, _centroidY, _centroidZ;
+
+    /// Loop bodies run by the thread pool.
+    struct BuildTask;
+    struct CentroidTask;
+
+    /**
+     * Splits the node in its children, and then the children.
+     * @param depth Depth of the node. The nodes at maxDepth are not split
+     * and are added to the subtrees instead.
+     **/
+    void split(std::vector<Node> &nodes, unsigned n, int depth,
+            int maxDepth);
+
+    /// Sets the center of mass of a node from the ones of its children.
+    static void sumChildren(std::vector<Node> &nodes, unsigned n);
+
+    /// Sums the centers of mass of the nodes above the subtrees.
+    void sumTop(unsigned n, int depth);
+
+    /**
+     * Sums the weights and the weighted positions of the points that pull
+     * the point at position p of the Morton order.
+     * @param openingAngle2 Square of the opening angle.
+     * @param softening2 Square of the softening.
+     **/
+    void sumPull(size_t p, float openingAngle2, float softening2,
+            double &weight, double &x, double &y, double &z) const;
+
+public:
+    /**
+     * Builds the tree over the given points.
+     * @param x, y, z Position of the points.
+     * @param size Number of points.
+     **/
+    void build(const float *x, const float *y, const float *z, size_t size,
+            ThreadPool &pool);
+
+    /**
+     * Finds the centroid weighted by distance of the other points, as seen
+     * by each point (see getCentroidX()). The traversals of the points are
+     * split between the threads.
+     * @param openingAngle Largest size / distance of a node that counts as
+     * one point.
+     * @param softening Distance added to the weights, so the closest points
+     * don't take over.
+     **/
+    void findCentroids(float openingAngle, float softening,
+            ThreadPool &pool);
+
+    /**
+     * Finds the same centroids as findCentroids(), but summing every pair
+     * of points. Quadratic, only a reference to test the tree with.
+     **/
+    void findCentroidsExact(float softening, ThreadPool &pool);
+
+    /**
+     * Returns the x of the centroid of each point found by findCentroids(),
+     * in the order the points were given to build(). A point with no other
+     * point sees itself as the centroid.
+     **/
+    inline const float *getCentroidX() const {
+        return _centroidX.empty() ? 0 : &_centroidX[0];
+    }
+
+    /// Like getCentroidX(), but for y.
+    inline const float *getCentroidY() const {
+        return _centroidY.empty() ? 0 : &_centroidY[0];
+    }
+
+    /// Like getCentroidX(), but for z.
+    inline const float *getCentroidZ() const {
+        return _centroidZ.empty() ? 0 : &_centroidZ[0];
+    }
+
+    /// Returns the number of points.
+    inline size_t size() const {
+        return _x.size();
+    }
+
+    /// Returns the number of nodes.
+    inline size_t getNumNodes() const {
+        return _nodes.size();
+    }
+};
+
+#endif // !SPATIAL_OCTREE_HPP
@@ -0,0 +1,92 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "PlacementGrid.hpp"
+#include <utility>
+
+PlacementGrid::PlacementGrid(float distance)
+        : _invCellSize(1.0 / distance), _distance2(distance * distance) {
+
+}
+
+void PlacementGrid::clear(float distance, size_t capacity) {
+    _invCellSize = 1.0 / distance;
+    _distance2 = distance * distance;
+    _x.clear();
+    _y.clear();
+    _z.clear();
+    _next.clear();
+    _first.clear();
+
+    _x.reserve(capacity);
+    _y.reserve(capacity);
+    _z.reserve(capacity);
+    _next.reserve(capacity);
+    _first.reserve(capacity);
+}
+
+unsigned PlacementGrid::insert(const Point &point) {
+    unsigned index = _x.size();
+    _x.push_back(toFloat(point.x));
+    _y.push_back(toFloat(point.y));
+    _z.push_back(toFloat(point.z));
+
+    CellKey key = cellKey(cellCoordinate(toFloat(point.x)),
+            cellCoordinate(toFloat(point.y)),
+            cellCoordinate(toFloat(point.z)));
+    std::pair<std::unordered_map<CellKey, unsigned>::iterator, bool>
+        cell = _first.insert(std::make_pair(key, index));
+    _next.push_back(cell.second ? ~0u : cell.first->second);
+    cell.first->second = index;
+
+    return index;
+}
+
+bool PlacementGrid::isFree(const Point &point) const {
+    int cx = cellCoordinate(toFloat(point.x));
+    int cy = cellCoordinate(toFloat(point.y));
+    int cz = cellCoordinate(toFloat(point.z));
+
+    for(int x = cx - 1; x <= cx + 1; ++x)
+        for(int y = cy - 1; y <= cy + 1; ++y)
+            for(int z = cz - 1; z <= cz + 1; ++z) {
+                std::unordered_map<CellKey, unsigned>::const_iterator
+                    cell = _first.find(cellKey(x, y, z));
+                if(cell == _first.end())
+                    continue;
+
+                for(unsigned p = cell->second; p != ~0u; p = _next[p]) {
+                    float dx = _x[p] - toFloat(point.x);
+                    float dy = _y[p] - toFloat(point.y);
+                    float dz = _z[p] - toFloat(point.z);
+                    if(dx * dx + dy * dy + dz * dz < _distance2)
+                        return false;
+                }
+            }
+
+    return true;
+}
@@ -0,0 +1,108 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SPATIAL_PLACEMENTGRID_HPP
+#define SPATIAL_PLACEMENTGRID_HPP
+
+#include "../math/Point.hpp"
+#include <cmath>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Grid of the points placed by World::addBoids(), where points can be
+ * inserted one at a time. The cells are as big as the minimum distance
+ * between the points, so the points closer than it to a position are in
+ * the 27 cells around it.
+ **/
+class PlacementGrid {
+    /// Key of a cell: its three integer coordinates packed in 21 bits.
+    typedef unsigned long long CellKey;
+
+    /// 1.0 / size of the side of a cell.
+    float _invCellSize;
+
+    /// Squared minimum distance.
+    float _distance2;
+
+    /// Positions of the points.
+    std::vector<float> _x, _y, _z;
+
+    /// First point of each cell.
+    std::unordered_map<CellKey, unsigned> _first;
+
+    /// Next point of the cell of each point, or ~0u for the last one.
+    std::vector<unsigned> _next;
+
+    /// Returns the cell coordinate of a position coordinate.
+    inline int cellCoordinate(float value) const {
+        return (int) std::floor(value * _invCellSize);
+    }
+
+    /// Packs the coordinates of a cell into its key.
+    static inline CellKey cellKey(int x, int y, int z) {
+        const CellKey mask = (1 << 21) - 1;
+        return ((CellKey) x & mask) | (((CellKey) y & mask) << 21)
+            | (((CellKey) z & mask) << 42);
+    }
+
+public:
+    /**
+     * Creates an empty grid.
+     * @param distance Minimum distance between the points.
+     **/
+    PlacementGrid(float distance);
+
+    /**
+     * Removes all the points and sets the minimum distance.
+     * @param distance Minimum distance between the points.
+     * @param capacity Number of points to reserve space for.
+     **/
+    void clear(float distance, size_t capacity);
+
+    /**
+     * Inserts a point.
+     * @return The index of the point.
+     **/
+    unsigned insert(const Point &point);
+
+    /// Returns the point with the given index.
+    inline Point getPoint(unsigned index) const {
+        return Point(_x[index], _y[index], _z[index]);
+    }
+
+    /// Returns the number of points.
+    inline size_t size() const {
+        return _x.size();
+    }
+
+    /// Returns if no point is closer than the minimum distance to point.
+    bool isFree(const Point &point) const;
+};
+
+#endif // !SPATIAL_PLACEMENTGRID_HPP
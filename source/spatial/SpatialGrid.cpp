@@ -0,0 +1,150 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "SpatialGrid.hpp"
+
+namespace {
+    /// Appends the points of the cells to a vector.
+    struct CandidateVisitor {
+        std::vector<unsigned> &candidates;
+
+        CandidateVisitor(std::vector<unsigned> &_candidates)
+            : candidates(_candidates) {
+
+        }
+
+        void operator()(unsigned begin, unsigned end) {
+            for(unsigned p = begin; p < end; ++p)
+                candidates.push_back(p);
+        }
+    };
+}
+
+SpatialGrid::SpatialGrid(float cellSize)
+        : _cellSize(cellSize), _invCellSize(1.0 / cellSize), _shift(58) {
+
+}
+
+void SpatialGrid::resize(size_t size) {
+    _x.resize(size);
+    _y.resize(size);
+    _z.resize(size);
+}
+
+void SpatialGrid::setPoints(const float *x, const float *y, const float *z,
+        size_t size) {
+    _x.assign(x, x + size);
+    _y.assign(y, y + size);
+    _z.assign(z, z + size);
+}
+
+void SpatialGrid::rebuild() {
+    size_t size = _x.size();
+
+    // Use at least twice as many buckets as points to keep the cells that
+    // share a bucket rare.
+    size_t numBuckets = 64;
+    _shift = 58;
+    while(numBuckets < 2 * size) {
+        numBuckets *= 2;
+        --_shift;
+    }
+
+    _keys.resize(size);
+    _bucketStart.assign(numBuckets + 1, 0);
+    _sortedIndices.resize(size);
+    _sortedKeys.resize(size);
+    _sortedX.resize(size);
+    _sortedY.resize(size);
+    _sortedZ.resize(size);
+
+    // Count the points of each bucket.
+    for(size_t i = 0; i < size; ++i) {
+        _keys[i] = cellKey(cellCoordinate(_x[i]), cellCoordinate(_y[i]),
+                cellCoordinate(_z[i]));
+        ++_bucketStart[bucket(_keys[i]) + 1];
+    }
+
+    // Prefix sum: where each bucket starts.
+    for(size_t b = 0; b < numBuckets; ++b)
+        _bucketStart[b + 1] += _bucketStart[b];
+
+    // Scatter the points into their buckets, using a cursor for each bucket.
+    // This keeps the insertion order inside the buckets.
+    _cursor.assign(_bucketStart.begin(), _bucketStart.end() - 1);
+    for(size_t i = 0; i < size; ++i) {
+        unsigned p = _cursor[bucket(_keys[i])]++;
+        _sortedIndices[p] = i;
+        _sortedKeys[p] = _keys[i];
+        _sortedX[p] = _x[i];
+        _sortedY[p] = _y[i];
+        _sortedZ[p] = _z[i];
+    }
+
+    // Make the cells that share a bucket contiguous.
+    for(size_t b = 0; b < numBuckets; ++b) {
+        unsigned begin = _bucketStart[b];
+        unsigned end = _bucketStart[b + 1];
+        for(unsigned p = begin + 1; p < end; ++p) {
+            if(_sortedKeys[p] != _sortedKeys[begin]) {
+                groupCells(begin, end);
+                break;
+            }
+        }
+    }
+}
+
+void SpatialGrid::groupCells(unsigned begin, unsigned end) {
+    // Insertion sort by key: the buckets are small, and it is stable, which
+    // keeps the insertion order inside each cell.
+    for(unsigned p = begin + 1; p < end; ++p) {
+        unsigned index = _sortedIndices[p];
+        CellKey key = _sortedKeys[p];
+        float x = _sortedX[p], y = _sortedY[p], z = _sortedZ[p];
+
+        unsigned q = p;
+        for(; q > begin && _sortedKeys[q - 1] > key; --q) {
+            _sortedIndices[q] = _sortedIndices[q - 1];
+            _sortedKeys[q] = _sortedKeys[q - 1];
+            _sortedX[q] = _sortedX[q - 1];
+            _sortedY[q] = _sortedY[q - 1];
+            _sortedZ[q] = _sortedZ[q - 1];
+        }
+
+        _sortedIndices[q] = index;
+        _sortedKeys[q] = key;
+        _sortedX[q] = x;
+        _sortedY[q] = y;
+        _sortedZ[q] = z;
+    }
+}
+
+void SpatialGrid::findCandidates(float x, float y, float z, float radius,
+        std::vector<unsigned> &candidates) const {
+    CandidateVisitor visitor(candidates);
+    forEachCell(x, y, z, radius, visitor);
+}
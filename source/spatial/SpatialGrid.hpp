@@ -0,0 +1,332 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SPATIAL_SPATIALGRID_HPP
+#define SPATIAL_SPATIALGRID_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+/**
+ * A uniform grid of cubic cells over the whole (unbounded) space, stored as
+ * a hash table of cells.
+ * Points are inserted by index with setPoint() and then sorted by cell with a
+ * counting sort in rebuild(), which takes linear time. After that, the points
+ * around any position can be visited with forEachNeighbor(), or, for the SIMD
+ * kernels, the cells around it with forEachCell().
+ * The grid copies the positions, so the caller may move its points after
+ * rebuilding; the grid keeps the positions of the last rebuild().
+ **/
+class SpatialGrid {
+    /// Key of a cell: its three integer coordinates packed in 21 bits each.
+    typedef unsigned long long CellKey;
+
+    /// Number of bits of each coordinate of a cell key.
+    static const int CellKeyBits = 21;
+
+    /// The cells are hashed in blocks of 2^BlockBits cells in each axis.
+    static const int BlockBits = 3;
+
+    /// Size of the side of a cell.
+    float _cellSize;
+
+    /// 1.0 / _cellSize.
+    float _invCellSize;
+
+    /// The hash table has 2^(64 - _shift) buckets.
+    int _shift;
+
+    /// Positions of the points in insertion order.
+    std::vector<float> _x, _y, _z;
+
+    /// Key of the cell of each point in insertion order.
+    std::vector<CellKey> _keys;
+
+    /// Scratch space for the counting sort.
+    std::vector<unsigned> _cursor;
+
+    /**
+     * Where each bucket starts in the sorted arrays. Bucket b holds the
+     * sorted points between _bucketStart[b] and _bucketStart[b + 1].
+     **/
+    std::vector<unsigned> _bucketStart;
+
+    /// Index of the points, sorted by bucket.
+    std::vector<unsigned> _sortedIndices;
+
+    /// Key of the cell of the points, sorted by bucket.
+    std::vector<CellKey> _sortedKeys;
+
+    /// Positions of the points, sorted by bucket.
+    std::vector<float> _sortedX, _sortedY, _sortedZ;
+
+    /// Returns the cell coordinate of a position coordinate.
+    inline int cellCoordinate(float value) const {
+        return (int) std::floor(value * _invCellSize);
+    }
+
+    /// Packs the coordinates of a cell into its key.
+    static inline CellKey cellKey(int x, int y, int z) {
+        const CellKey mask = (1 << CellKeyBits) - 1;
+        return ((CellKey) x & mask) | (((CellKey) y & mask) << CellKeyBits)
+            | (((CellKey) z & mask) << (2 * CellKeyBits));
+    }
+
+    /// Spreads the BlockBits bits of a coordinate inside a block, two zero
+    /// bits between each, to interleave them in Morton order.
+    static inline CellKey spreadBlockBits(CellKey value) {
+        return (value & 1) | ((value & 2) << 2) | ((value & 4) << 4);
+    }
+
+    /**
+     * Returns the bucket of the hash table where the cell is. The cells of a
+     * block go to consecutive buckets, in Morton order, from a hashed start,
+     * so the cells close in space are close in the sorted order too, and so
+     * are the boids of a store sorted along a Morton curve (see
+     * MortonOrder).
+     **/
+    inline size_t bucket(CellKey key) const {
+        const CellKey mask = (1 << CellKeyBits) - 1;
+        const CellKey blockMask = (1 << BlockBits) - 1;
+        CellKey x = key & mask;
+        CellKey y = (key >> CellKeyBits) & mask;
+        CellKey z = key >> (2 * CellKeyBits);
+        CellKey block = cellKey(x >> BlockBits, y >> BlockBits,
+                z >> BlockBits);
+        CellKey offset = spreadBlockBits(x & blockMask)
+            | (spreadBlockBits(y & blockMask) << 1)
+            | (spreadBlockBits(z & blockMask) << 2);
+
+        // Fibonacci hashing of the block: the high bits of the product are
+        // well mixed.
+        CellKey start = (block * 11400714819323198485ull) >> _shift;
+        CellKey buckets = (CellKey) 1 << (64 - _shift);
+        return (size_t) ((start + offset) & (buckets - 1));
+    }
+
+    /**
+     * Sorts the points of a bucket by cell, so each cell is contiguous.
+     * Only needed when different cells share the bucket.
+     **/
+    void groupCells(unsigned begin, unsigned end);
+
+    /// Calls the visitor of forEachNeighbor() for the points of a cell.
+    template<typename Visitor>
+    struct PointVisitor {
+        const SpatialGrid &grid;
+        float x, y, z, radius2;
+        Visitor &visitor;
+
+        PointVisitor(const SpatialGrid &_grid, float _x, float _y, float _z,
+                float radius, Visitor &_visitor)
+            : grid(_grid), x(_x), y(_y), z(_z), radius2(radius * radius),
+            visitor(_visitor) {
+
+        }
+
+        void operator()(unsigned begin, unsigned end) {
+            for(unsigned p = begin; p < end; ++p) {
+                float px = grid._sortedX[p] - x;
+                float py = grid._sortedY[p] - y;
+                float pz = grid._sortedZ[p] - z;
+                if(px * px + py * py + pz * pz < radius2)
+                    visitor(grid._sortedIndices[p], grid._sortedX[p],
+                            grid._sortedY[p], grid._sortedZ[p]);
+            }
+        }
+    };
+
+public:
+    /**
+     * Creates an empty grid.
+     * @param cellSize The size of the side of each cell.
+     **/
+    explicit SpatialGrid(float cellSize);
+
+    /**
+     * Sets the number of points of the grid.
+     * All the points must be set with setPoint() before calling rebuild().
+     **/
+    void resize(size_t size);
+
+    /**
+     * Sets the position of the given point.
+     * @param i Index of the point, smaller than size().
+     **/
+    inline void setPoint(size_t i, float x, float y, float z) {
+        _x[i] = x;
+        _y[i] = y;
+        _z[i] = z;
+    }
+
+    /**
+     * Resizes the grid to size points and copies their positions from the
+     * given arrays.
+     **/
+    void setPoints(const float *x, const float *y, const float *z,
+            size_t size);
+
+    /**
+     * Sorts the points by cell. Must be called every time the points move.
+     * This is a counting sort, linear in the number of points.
+     **/
+    void rebuild();
+
+    /**
+     * Calls visitor(index, x, y, z) for every point of the last rebuild() at
+     * a distance smaller than radius of (x, y, z). The visitor also receives
+     * the point with the same position as (x, y, z), if there is one.
+     * The points are visited cell by cell, in the order they are stored in
+     * the grid, so the order is the same for the same set of points.
+     * @param x, y, z Center of the query.
+     * @param radius Radius of the query. Any radius works, but the grid
+     * is fastest with radius close to the cell size.
+     * @param visitor Function (or function object) called for each point.
+     **/
+    template<typename Visitor>
+    void forEachNeighbor(float x, float y, float z, float radius,
+            Visitor &visitor) const;
+
+    /**
+     * Calls visitor(begin, end) for every cell that may have points at a
+     * distance smaller than radius of (x, y, z). The points of the cell are
+     * the ones between begin and end in the sorted order (see
+     * getSortedIndices()). The points are not tested against the radius.
+     * The cells are visited in the same order as in forEachNeighbor().
+     **/
+    template<typename Visitor>
+    void forEachCell(float x, float y, float z, float radius,
+            Visitor &visitor) const;
+
+    /**
+     * Appends to candidates the sorted position (see getSortedIndices()) of
+     * every point in the cells of forEachCell(). This is the input of the
+     * SIMD kernels, which test the distances themselves.
+     **/
+    void findCandidates(float x, float y, float z, float radius,
+            std::vector<unsigned> &candidates) const;
+
+    /**
+     * Returns the index of each point in the sorted order: the point at
+     * position p of the sorted order is the point getSortedIndices()[p].
+     **/
+    inline const unsigned *getSortedIndices() const {
+        return _sortedIndices.empty() ? 0 : &_sortedIndices[0];
+    }
+
+    /**
+     * Copies values, given in the order of the points, into sorted, in the
+     * sorted order. Used to give the SIMD kernels contiguous arrays in the
+     * same order as the cells.
+     **/
+    inline void gather(const float *values, float *sorted) const {
+        gather(values, sorted, 0, _sortedIndices.size());
+    }
+
+    /// Like gather(), but only for the sorted positions [begin, end).
+    inline void gather(const float *values, float *sorted, size_t begin,
+            size_t end) const {
+        for(size_t p = begin; p < end; ++p)
+            sorted[p] = values[_sortedIndices[p]];
+    }
+
+    /// Returns the number of points.
+    inline size_t size() const {
+        return _x.size();
+    }
+
+    /// Returns the size of the side of the cells.
+    inline float getCellSize() const {
+        return _cellSize;
+    }
+};
+
+template<typename Visitor>
+void SpatialGrid::forEachNeighbor(float x, float y, float z, float radius,
+        Visitor &visitor) const {
+    PointVisitor<Visitor> points(*this, x, y, z, radius, visitor);
+    forEachCell(x, y, z, radius, points);
+}
+
+template<typename Visitor>
+void SpatialGrid::forEachCell(float x, float y, float z, float radius,
+        Visitor &visitor) const {
+    if(_x.empty())
+        return;
+
+    const float radius2 = radius * radius;
+    const int reach = (int) std::ceil(radius * _invCellSize);
+    const int cx = cellCoordinate(x);
+    const int cy = cellCoordinate(y);
+    const int cz = cellCoordinate(z);
+
+    // Position of the query inside its cell, to skip the cells that are too
+    // far away from it.
+    const float fx = x - cx * _cellSize;
+    const float fy = y - cy * _cellSize;
+    const float fz = z - cz * _cellSize;
+
+    for(int i = -reach; i <= reach; ++i) {
+        // Distance in x from the query to the nearest face of the cell.
+        float dx = i < 0 ? fx + (-i - 1) * _cellSize
+            : (i > 0 ? (i - 1) * _cellSize + _cellSize - fx : 0.0f);
+
+        for(int j = -reach; j <= reach; ++j) {
+            float dy = j < 0 ? fy + (-j - 1) * _cellSize
+                : (j > 0 ? (j - 1) * _cellSize + _cellSize - fy : 0.0f);
+            float dxy2 = dx * dx + dy * dy;
+            if(dxy2 >= radius2)
+                continue;
+
+            for(int k = -reach; k <= reach; ++k) {
+                float dz = k < 0 ? fz + (-k - 1) * _cellSize
+                    : (k > 0 ? (k - 1) * _cellSize + _cellSize - fz : 0.0f);
+                if(dxy2 + dz * dz >= radius2)
+                    continue;
+
+                // Different cells may share a bucket, so look for the points
+                // of this cell, which are contiguous, by their keys.
+                CellKey key = cellKey(cx + i, cy + j, cz + k);
+                size_t b = bucket(key);
+                unsigned p = _bucketStart[b];
+                unsigned end = _bucketStart[b + 1];
+                while(p < end && _sortedKeys[p] != key)
+                    ++p;
+
+                unsigned begin = p;
+                while(p < end && _sortedKeys[p] == key)
+                    ++p;
+
+                if(begin != p)
+                    visitor(begin, p);
+            }
+        }
+    }
+}
+
+#endif // !SPATIAL_SPATIALGRID_HPP
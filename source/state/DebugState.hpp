@@ -78,13 +78,12 @@ public:
                 << getEngine().getObjectiveBoid().up << std::endl;
 
             // Print the boids.
-            int i = 0;
-            Engine::BoidVector &boids = getEngine().getBoids();
-            for(Engine::BoidVector::iterator it = boids.begin();
-                    it != boids.end(); ++it, ++i) {
-                std::cout << "Boid " << i << " - pos: " << it->position
-                    << " | dir: " << it->direction << " | speed: " << it->speed
-                    << " | up: " << it->up << std::endl;
+            BoidStore &boids = getEngine().getBoids();
+            for(size_t i = 0; i < boids.size(); ++i) {
+                FollowBoid boid = boids[i];
+                std::cout << "Boid " << i << " - pos: " << boid.getPosition()
+                    << " | dir: " << boid.getDirection() << " | speed: "
+                    << boid.getSpeed() << std::endl;
             }
 
             // One more line.
@@ -92,6 +91,7 @@ public:
 
             // Update the systems.
             getEngine().getAnimationSystem().update(dt);
+            getEngine().getFlockingSystem().update(dt);
             getEngine().getCollisionSystem().update(dt);
             getEngine().getMovementSystem().update(dt);
         }
@@ -58,10 +58,7 @@ public:
 
     void update(float dt) {
         // Update the systems.
-        getEngine().getAnimationSystem().update(dt);
-        getEngine().getCameraSystem().update(dt);
-        getEngine().getCollisionSystem().update(dt);
-        getEngine().getMovementSystem().update(dt);
+        getEngine().getScheduler().update(getEngine().getThreadPool(), dt);
     }
 
     void render(float alpha) {
@@ -108,10 +108,12 @@ public:
 
     /**
      * The render function renders the current game state to the screen.
-     * @param dt The time we are after the last physics update to display the
-     * physics-affected objects at the right position.
+     * @param alpha How far the time of the frame is from the previous physics
+     * update (0) to the last one (1). The physics-affected objects are drawn
+     * between the two updates, so the motion is smooth even when the frame
+     * rate doesn't match the update rate.
      **/
-    virtual void render(float dt) = 0;
+    virtual void render(float alpha) = 0;
 
     /**
      * The cleanUp function frees any objects no longer required and sets the
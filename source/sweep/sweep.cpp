@@ -0,0 +1,373 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Parameter sweeps of the simulation.
+ * Runs one world for each combination of the given parameters and seeds,
+ * many at the same time on the threads of a pool, and writes the metrics of
+ * each run to a results file, one comma separated line per run. Like the
+ * benchmarks, it doesn't create the engine, so no window is needed.
+ *
+ * Usage: boids_sweep [-o file] [-s seconds] [--seeds n] [-j threads]
+ *                    [--boid-space x[,x...]] [--radius x[,x...]]
+ *                    [--boids n[,n...]] [--tick-rate n[,n...]]
+ *                    [--skin x] [--nearest k] [--reorder n]
+ */
+
+#include "../defs.hpp"
+#include "../util/ThreadPool.hpp"
+#include "../World.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    /// Options given in the command line.
+    struct Options {
+        /// File the results are written to.
+        std::string output;
+
+        /// Simulated seconds of each run.
+        float seconds;
+
+        /// Number of seeds to run each combination of parameters with.
+        unsigned seeds;
+
+        /// Number of threads. 0 is one per hardware thread.
+        unsigned threads;
+
+        /// Skin of the neighbor lists of the worlds. 0 doesn't use them.
+        float skin;
+
+        /// Number of nearest boids that are flockmates. 0 uses the radius.
+        unsigned nearest;
+
+        /// Number of ticks between two reorders of the boids. 0 never does.
+        unsigned reorder;
+
+        /// Values of each parameter.
+        std::vector<float> boidSpaces;
+        std::vector<float> radii;
+        std::vector<float> flockSizes;
+        std::vector<float> tickRates;
+
+        Options() : output("sweep.csv"), seconds(10.0), seeds(1), threads(0),
+                skin(0.0), nearest(0), reorder(BoidReorderInterval) {
+            boidSpaces.push_back(BoidSpace);
+            radii.push_back(FlockingNeighborRadius);
+            flockSizes.push_back(100);
+            tickRates.push_back(SimulationTickRate);
+        }
+    };
+
+    /// A run of the sweep: the parameters of a world and its metrics.
+    struct Run {
+        WorldParameters parameters;
+        unsigned numBoids;
+        unsigned long seed;
+
+        /// Number of simulated ticks.
+        unsigned ticks;
+
+        /// Wall time of the run, in seconds.
+        double seconds;
+
+        /// Mean speed of the follow boids.
+        double meanSpeed;
+
+        /// Mean distance of the follow boids to their middle.
+        double spread;
+
+        /// Mean distance of the follow boids to their nearest flockmate.
+        double meanNearest;
+
+        /// Fraction of the follow boids with a flockmate inside boidSpace.
+        double tooClose;
+
+        /// Distance from the middle of the flock to the objective boid.
+        double leaderDistance;
+
+        /// Checksum of the final state of the world.
+        uint64_t checksum;
+    };
+
+    /// Returns a monotonic time, in seconds.
+    double now() {
+        return std::chrono::duration<double>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// Finds the nearest boid to a point, other than the boid itself.
+    struct NearestVisitor {
+        unsigned self;
+        float x, y, z;
+        float distance2;
+
+        NearestVisitor(unsigned _self, float _x, float _y, float _z,
+                float radius)
+            : self(_self), x(_x), y(_y), z(_z), distance2(radius * radius) {
+
+        }
+
+        void operator()(unsigned i, float px, float py, float pz) {
+            float dx = px - x, dy = py - y, dz = pz - z;
+            float d2 = dx * dx + dy * dy + dz * dz;
+            if(i != self && d2 < distance2)
+                distance2 = d2;
+        }
+    };
+
+    /// Calculates the metrics of the flock of the world at the end of a run.
+    void measure(World &world, Run &run) {
+        BoidStore &boids = world.getBoids();
+        size_t size = boids.size();
+        if(!size)
+            return;
+
+        // The grid is a tick old: rebuild it with the final positions.
+        world.updateGrid();
+        world.updateStats();
+        Point middle = world.getAbsoluteMiddlePosition();
+        float radius = run.parameters.neighborRadius;
+
+        double speed = 0.0, spread = 0.0, nearest = 0.0;
+        size_t withFlockmates = 0, tooClose = 0;
+        for(size_t i = 0; i < size; ++i) {
+            Point position(boids.px()[i], boids.py()[i], boids.pz()[i]);
+            speed += boids.speed()[i];
+            spread += toFloat(Point::distance(position, middle));
+
+            NearestVisitor visitor(i, boids.px()[i], boids.py()[i],
+                    boids.pz()[i], radius);
+            world.getGrid().forEachNeighbor(boids.px()[i], boids.py()[i],
+                    boids.pz()[i], radius, visitor);
+            if(visitor.distance2 < radius * radius) {
+                float distance = std::sqrt(visitor.distance2);
+                nearest += distance;
+                ++withFlockmates;
+                if(distance < run.parameters.boidSpace)
+                    ++tooClose;
+            }
+        }
+
+        run.meanSpeed = speed / size;
+        run.spread = spread / size;
+        run.meanNearest = withFlockmates ? nearest / withFlockmates : 0.0;
+        run.tooClose = (double) tooClose / size;
+        run.leaderDistance = toFloat(Point::distance(middle,
+                world.getObjectiveBoid().position));
+        run.checksum = world.getChecksum();
+    }
+
+    /**
+     * Runs the worlds of a chunk of the runs. Each run only writes its own
+     * metrics, so the chunks are independent.
+     **/
+    struct RunTask {
+        ThreadPool &pool;
+        std::vector<Run> &runs;
+
+        RunTask(ThreadPool &_pool, std::vector<Run> &_runs)
+            : pool(_pool), runs(_runs) {
+
+        }
+
+        void operator()(size_t begin, size_t end, unsigned) {
+            for(size_t r = begin; r < end; ++r) {
+                Run &run = runs[r];
+                double start = now();
+
+                // The loops of the world run in this thread, as this is
+                // already a loop of the pool.
+                World world(pool, run.parameters);
+                world.init(run.numBoids, run.seed);
+                for(unsigned t = 0; t < run.ticks; ++t)
+                    world.step();
+
+                measure(world, run);
+                run.seconds = now() - start;
+            }
+        }
+    };
+
+    /// Creates a run for each combination of the options.
+    void createRuns(const Options &options, std::vector<Run> &runs) {
+        for(size_t b = 0; b < options.boidSpaces.size(); ++b)
+        for(size_t r = 0; r < options.radii.size(); ++r)
+        for(size_t n = 0; n < options.flockSizes.size(); ++n)
+        for(size_t t = 0; t < options.tickRates.size(); ++t)
+        for(unsigned s = 0; s < options.seeds; ++s) {
+            Run run = Run();
+            run.parameters.boidSpace = options.boidSpaces[b];
+            run.parameters.neighborRadius = options.radii[r];
+            run.parameters.separationRadius = 1.5 * options.boidSpaces[b];
+            run.parameters.tickRate = options.tickRates[t];
+            run.parameters.neighborSkin = options.skin;
+            run.parameters.topologicalNeighbors = options.nearest;
+            run.parameters.reorderInterval = options.reorder;
+            run.numBoids = options.flockSizes[n];
+            run.seed = s + 1;
+            run.ticks = options.seconds * run.parameters.tickRate;
+            runs.push_back(run);
+        }
+    }
+
+    /// Writes the results, one line per run.
+    bool writeResults(const std::string &file, const std::vector<Run> &runs) {
+        std::ofstream out(file.c_str());
+        if(!out)
+            return false;
+
+        out << "boid_space,neighbor_radius,boids,tick_rate,seed,ticks,"
+            << "seconds,mean_speed,spread,mean_nearest,too_close,"
+            << "leader_distance,checksum" << std::endl;
+        for(size_t i = 0; i < runs.size(); ++i) {
+            const Run &run = runs[i];
+            out << run.parameters.boidSpace << ","
+                << run.parameters.neighborRadius << "," << run.numBoids << ","
+                << run.parameters.tickRate << "," << run.seed << ","
+                << run.ticks << "," << run.seconds << "," << run.meanSpeed
+                << "," << run.spread << "," << run.meanNearest << ","
+                << run.tooClose << "," << run.leaderDistance << ","
+                << std::hex << run.checksum << std::dec << std::endl;
+        }
+
+        return out.good();
+    }
+
+    /**
+     * Parses a comma separated list of positive numbers.
+     * @param integer If the numbers must be integers.
+     **/
+    bool parseList(const char *arg, std::vector<float> &list, bool integer) {
+        std::stringstream stream(arg);
+        std::string item;
+
+        list.clear();
+        while(std::getline(stream, item, ',')) {
+            char *end;
+            float number = std::strtod(item.c_str(), &end);
+            if(item.empty() || *end || number <= 0.0
+                    || (integer && number != std::floor(number)))
+                return false;
+            list.push_back(number);
+        }
+
+        return !list.empty();
+    }
+
+    /// Prints the usage.
+    int usage(const char *program) {
+        std::cerr << "Usage: " << program
+            << " [-o file] [-s seconds] [--seeds n] [-j threads]" << std::endl
+            << "       [--boid-space x[,x...]] [--radius x[,x...]]"
+            << " [--boids n[,n...]] [--tick-rate n[,n...]]" << std::endl
+            << "       [--skin x] [--nearest k] [--reorder n]" << std::endl;
+        return 1;
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options;
+
+    for(int i = 1; i < argc; ++i) {
+        if(!std::strcmp(argv[i], "-o") && i + 1 < argc) {
+            options.output = argv[++i];
+        }
+        else if(!std::strcmp(argv[i], "-s") && i + 1 < argc) {
+            options.seconds = std::strtod(argv[++i], NULL);
+            if(options.seconds <= 0.0)
+                return usage(argv[0]);
+        }
+        else if(!std::strcmp(argv[i], "--seeds") && i + 1 < argc) {
+            options.seeds = std::strtoul(argv[++i], NULL, 10);
+            if(!options.seeds)
+                return usage(argv[0]);
+        }
+        else if(!std::strcmp(argv[i], "-j") && i + 1 < argc) {
+            options.threads = std::strtoul(argv[++i], NULL, 10);
+        }
+        else if(!std::strcmp(argv[i], "--boid-space") && i + 1 < argc) {
+            if(!parseList(argv[++i], options.boidSpaces, false))
+                return usage(argv[0]);
+        }
+        else if(!std::strcmp(argv[i], "--radius") && i + 1 < argc) {
+            if(!parseList(argv[++i], options.radii, false))
+                return usage(argv[0]);
+        }
+        else if(!std::strcmp(argv[i], "--boids") && i + 1 < argc) {
+            if(!parseList(argv[++i], options.flockSizes, true))
+                return usage(argv[0]);
+        }
+        else if(!std::strcmp(argv[i], "--tick-rate") && i + 1 < argc) {
+            if(!parseList(argv[++i], options.tickRates, true))
+                return usage(argv[0]);
+        }
+        else if(!std::strcmp(argv[i], "--skin") && i + 1 < argc) {
+            options.skin = std::strtod(argv[++i], NULL);
+            if(options.skin < 0.0)
+                return usage(argv[0]);
+        }
+        else if(!std::strcmp(argv[i], "--nearest") && i + 1 < argc) {
+            options.nearest = std::strtoul(argv[++i], NULL, 10);
+        }
+        else if(!std::strcmp(argv[i], "--reorder") && i + 1 < argc) {
+            options.reorder = std::strtoul(argv[++i], NULL, 10);
+        }
+        else {
+            return usage(argv[0]);
+        }
+    }
+
+    std::vector<Run> runs;
+    createRuns(options, runs);
+
+    // One run per chunk: the runs take very different times, so the threads
+    // steal them from each other.
+    ThreadPool pool(options.threads);
+    RunTask task(pool, runs);
+    double start = now();
+    pool.parallelFor(0, runs.size(), 1, task);
+    double seconds = now() - start;
+
+    if(!writeResults(options.output, runs)) {
+        std::cerr << "Failed to write " << options.output << "." << std::endl;
+        return 2;
+    }
+
+    std::cout << runs.size() << " runs on " << pool.getNumThreads()
+        << " threads in " << seconds << " s, results in " << options.output
+        << std::endl;
+
+    return 0;
+}
@@ -30,8 +30,35 @@
 #include "../glfw.hpp"
 #include "../util/draw.hpp"
 #include "../Engine.hpp"
+#include <cmath>
 #include <iostream>
 
+namespace {
+    /**
+     * Advances the phase of the wings of the follow boids, wrapping around
+     * at the end of the cycle. The step is longer than the cycle when the
+     * system runs less often than the wings flap.
+     **/
+    struct WingTask {
+        float *wing;
+        float step;
+        float cycle;
+
+        WingTask(float *_wing, float _step, float _cycle)
+            : wing(_wing), step(_step), cycle(_cycle) {
+
+        }
+
+        void operator()(size_t begin, size_t end, unsigned) {
+            for(size_t i = begin; i < end; ++i) {
+                wing[i] += step;
+                if(wing[i] >= cycle)
+                    wing[i] = std::fmod(wing[i], cycle);
+            }
+        }
+    };
+}
+
 void AnimationSystem::createBoidDisplayList() {
     // Start at the next display list.
     _beginBoidDisplayList = getEngine().getRenderSystem().getNextDisplayList();
@@ -41,6 +68,10 @@ void AnimationSystem::createBoidDisplayList() {
     // Update the next display list.
     getEngine().getRenderSystem().setNextDisplayList(_endBoidDisplayList);
 
+    // Without OpenGL, the display lists are only numbers for the animation.
+    if(getEngine().isHeadless())
+        return;
+
     // How much the wings will be higher by each frame.
     float wingUpRate = WingAngle / NumBoidDisplayLists;
 
@@ -96,12 +127,18 @@ void AnimationSystem::createBoidDisplayList() {
 }
 
 void AnimationSystem::destroyBoidDisplayList() {
+    if(getEngine().isHeadless())
+        return;
+
     // Destroy all display lists.
     glDeleteLists(_beginBoidDisplayList,
             (_endBoidDisplayList - _beginBoidDisplayList));
 }
 
 void AnimationSystem::destroyTowerDisplayList() {
+    if(getEngine().isHeadless())
+        return;
+
     glDeleteLists(_towerDisplayList, 1);
 }
 
@@ -110,6 +147,9 @@ void AnimationSystem::createTowerDisplayList() {
     _towerDisplayList = getEngine().getRenderSystem().getNextDisplayList();
     getEngine().getRenderSystem().incrementNextDisplayList();
 
+    if(getEngine().isHeadless())
+        return;
+
     // Draw a tower with its base centered at (0, 0, 0).
     glNewList(_towerDisplayList, GL_COMPILE);
         glPushMatrix();
@@ -134,6 +174,8 @@ void AnimationSystem::init() {
 
     // Create the display lists for the cone.
     createTowerDisplayList();
+
+    _leaderFrames = 0.0;
 }
 
 void AnimationSystem::terminate() {
@@ -171,18 +213,39 @@ void AnimationSystem::updateBoid(Boid &boid) {
     }
 }
 
-void AnimationSystem::updateBoids() {
-    // update the objective boid.
-    updateBoid(getEngine().getObjectiveBoid());
-
-    // Update each boid.
-    for(Engine::BoidVector::iterator it = getEngine().getBoids().begin();
-            it != getEngine().getBoids().end(); ++it) {
-        updateBoid(*it);
+void AnimationSystem::updateBoids(float dt) {
+    // The objective boids flap at WingFlapRate too, however often the system
+    // runs. The fraction of a display list left over is kept for the next
+    // update, so rounding only delays a frame and never loses it.
+    _leaderFrames += WingFlapRate * dt;
+    int frames = (int) std::floor(_leaderFrames);
+    _leaderFrames -= frames;
+
+    World &world = getEngine().getWorld();
+    for(size_t f = 0; f < world.getNumFlocks(); ++f) {
+        Flock &flock = world.getFlock(f);
+
+        // update the objective boid.
+        for(int frame = 0; frame < frames; ++frame)
+            updateBoid(flock.leader);
+
+        // Advance the wings of each follow boid.
+        WingTask wings(flock.boids.wing(), WingFlapRate * dt,
+                getWingCycle());
+        getEngine().getThreadPool().parallelFor(0, flock.boids.size(),
+                BoidsPerChunk, wings);
     }
 }
 
+unsigned AnimationSystem::getReads() const {
+    return 0;
+}
+
+unsigned AnimationSystem::getWrites() const {
+    return ObjectiveBoidAnimationComponent | BoidWingComponent;
+}
+
 void AnimationSystem::update(float dt) {
     // Update the boids.
-    updateBoids();
+    updateBoids(dt);
 }
@@ -32,7 +32,7 @@
 #include "../gameObject/Boid.hpp"
 #include "../defs.hpp"
 #include "../util/NonCopyable.hpp"
-#include <cstdlib>
+#include "../util/Random.hpp"
 
 /**
  * This is the animation system, that manages the display lists that render the
@@ -56,6 +56,10 @@ class AnimationSystem : public System, public NonCopyable {
     /// Display list of the tower.
     unsigned _towerDisplayList;
 
+    /// Display lists the objective boids are behind, as they only advance
+    /// whole ones.
+    float _leaderFrames;
+
     /**
      * Creates the display lists for the boids.
      **/
@@ -77,19 +81,21 @@ class AnimationSystem : public System, public NonCopyable {
     void destroyTowerDisplayList();
 
     /**
-     * Updates a single boid.
+     * Advances the display list of a single boid by one.
      **/
     void updateBoid(Boid &boid);
 
     /**
      * Updates all the boids, including the objective boid.
      **/
-    void updateBoids();
+    void updateBoids(float dt);
 
 public:
     void init();
     void terminate();
     void update(float dt);
+    unsigned getReads() const;
+    unsigned getWrites() const;
 
     // Returns the begin boid display list.
     inline unsigned getBeginBoidDisplayList() {
@@ -102,13 +108,33 @@ public:
     }
 
     // Get random boid display list.
-    inline int getRandomBoidDisplayList() {
-        return _beginBoidDisplayList + std::rand() % NumBoidDisplayLists;
+    inline int getRandomBoidDisplayList(RandomStream &random) {
+        return _beginBoidDisplayList + random.next() % NumBoidDisplayLists;
     }
 
     // Get random boid going up or down.
-    inline bool getRandomBoidGoingUp() {
-        return std::rand() % 2;
+    inline bool getRandomBoidGoingUp(RandomStream &random) {
+        return random.next() % 2;
+    }
+
+    /**
+     * Returns the length of a full flap of the wings of the follow boids, in
+     * display lists: up through all of them and down again.
+     * The phase of the wings of a follow boid is a float in
+     * [0, getWingCycle()), from which getWingDisplayList() gets the display
+     * list to draw.
+     **/
+    inline float getWingCycle() const {
+        return WingCycle;
+    }
+
+    /// Returns the display list for the given wing phase.
+    inline unsigned getWingDisplayList(float wingPhase) const {
+        unsigned step = (unsigned) wingPhase;
+        if(step >= (unsigned) NumBoidDisplayLists)
+            step = WingCycle - step;
+
+        return _beginBoidDisplayList + step;
     }
 };
 
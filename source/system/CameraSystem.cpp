@@ -33,6 +33,7 @@
 
 CameraSystem::CameraSystem()
         : _position(0, MinimumHeight, 0),
+        _previousPosition(0, MinimumHeight, 0),
         _horizontalAngle(0.0),
         _verticalAngle(0.0),
         _cameraSpeed(DefaultCameraMovementSpeed),
@@ -44,7 +45,9 @@ CameraSystem::CameraSystem()
 
 void CameraSystem::init() {
     // Hide the cursor.
-    glfwSetInputMode(getEngine().getWindow(), GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    if(!getEngine().isHeadless())
+        glfwSetInputMode(getEngine().getWindow(), GLFW_CURSOR,
+                GLFW_CURSOR_DISABLED);
 }
 
 void CameraSystem::terminate() {
@@ -120,19 +123,19 @@ void CameraSystem::moveCamera(float dt) {
         return;
 
     // Move forward.
-    if(glfwGetKey(getEngine().getWindow(), CameraForwardKey) == GLFW_PRESS)
+    if(getEngine().isKeyPressed(CameraForwardKey))
         _position += _direction * _cameraSpeed * dt;
 
     // Move backward.
-    if(glfwGetKey(getEngine().getWindow(), CameraBackwardKey) == GLFW_PRESS)
+    if(getEngine().isKeyPressed(CameraBackwardKey))
         _position -= _direction * _cameraSpeed * dt;
 
     // Strafe right.
-    if(glfwGetKey(getEngine().getWindow(), CameraRightStrafeKey) == GLFW_PRESS)
+    if(getEngine().isKeyPressed(CameraRightStrafeKey))
         _position += _right * _cameraSpeed * dt;
 
     // Strafe left.
-    if(glfwGetKey(getEngine().getWindow(), CameraLeftStrafeKey) == GLFW_PRESS)
+    if(getEngine().isKeyPressed(CameraLeftStrafeKey))
         _position -= _right * _cameraSpeed * dt;
 
     // Minimum and maximum heights.
@@ -142,6 +145,14 @@ void CameraSystem::moveCamera(float dt) {
         _position.y = MaximumHeight;
 }
 
+unsigned CameraSystem::getReads() const {
+    return KeysComponent | ObjectiveBoidComponent | MiddlePositionComponent;
+}
+
+unsigned CameraSystem::getWrites() const {
+    return CameraComponent;
+}
+
 void CameraSystem::update(float dt) {
     static bool firstUpdate = true;
 
@@ -166,18 +177,35 @@ void CameraSystem::update(float dt) {
         orientCameraToTheBoids();
 }
 
-void CameraSystem::lookThroughCamera() {
+void CameraSystem::savePreviousState() {
+    _previousPosition = _position;
+    _previousDirection = _direction;
+    _previousUp = _up;
+}
+
+void CameraSystem::lookThroughCamera(float alpha) {
+    Point position = _previousPosition + (_position - _previousPosition) * alpha;
+    Vector direction = _direction;
+    Vector up = _up;
+
+    if(!_cameraOrientable) {
+        direction = _previousDirection + (_direction - _previousDirection)
+            * alpha;
+        up = _previousUp + (_up - _previousUp) * alpha;
+    }
+
+    Point center = position + direction;
     if(_cameraType == TowerCamera || _cameraType == ParallelCamera) {
-        gluLookAt(_position.x, _position.y, _position.z,
-                _position.x + _direction.x, _position.y + _direction.y,
-                _position.z + _direction.z,
+        gluLookAt(toFloat(position.x), toFloat(position.y),
+                toFloat(position.z),
+                toFloat(center.x), toFloat(center.y), toFloat(center.z),
                 0.0, 1.0, 0.0);
     }
     else {
-        gluLookAt(_position.x, _position.y, _position.z,
-                _position.x + _direction.x, _position.y + _direction.y,
-                _position.z + _direction.z,
-                _up.x, _up.y, _up.z);
+        gluLookAt(toFloat(position.x), toFloat(position.y),
+                toFloat(position.z),
+                toFloat(center.x), toFloat(center.y), toFloat(center.z),
+                toFloat(up.x), toFloat(up.y), toFloat(up.z));
     }
 }
 
@@ -194,9 +222,10 @@ void CameraSystem::setCameraType(CameraType camera) {
 
             // Fix the camera angles.
             _direction.normalize();
-            vertRads = asin(-_direction.y);
+            vertRads = asin(-toFloat(_direction.y));
             _verticalAngle = toDegrees(vertRads);
-            _horizontalAngle = toDegrees(acos(-_direction.z / cos(vertRads)));
+            _horizontalAngle = toDegrees(acos(-toFloat(_direction.z)
+                        / cos(vertRads)));
 
             // Calculate the direction vectors.
             calculateDirectionVectors();
@@ -64,6 +64,11 @@ private:
     /// Up vector of the camera.
     Vector _up;
 
+    /// Position, direction and up vector at the end of the previous tick.
+    Point _previousPosition;
+    Vector _previousDirection;
+    Vector _previousUp;
+
     /// Horizontal angle.
     float _horizontalAngle;
 
@@ -116,11 +121,23 @@ public:
     void init();
     void terminate();
     void update(float dt);
+    unsigned getReads() const;
+    unsigned getWrites() const;
+
+    /**
+     * Saves the position, direction and up vector as the ones of the
+     * previous tick. Called before each tick.
+     **/
+    void savePreviousState();
 
     /**
      * Like gluLookAt(), but with our camera.
+     * @param alpha Where to place the camera between the previous tick (0)
+     * and the current one (1). The direction of the orientable cameras
+     * follows the mouse between ticks, so only their position is
+     * interpolated.
      **/
-    void lookThroughCamera();
+    void lookThroughCamera(float alpha);
 
     /// Sets the camera type to use.
     void setCameraType(CameraType camera);
@@ -26,9 +26,35 @@
  */
 
 #include "CollisionSystem.hpp"
-#include "../Engine.hpp"
+#include "../World.hpp"
 #include "../defs.hpp"
 #include "../glfw.hpp"
+#include "../simd/kernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    /// Orders flocks by the start of their bounding boxes in x.
+    struct BoundsStartLess {
+        World &world;
+
+        BoundsStartLess(World &_world) : world(_world) {
+
+        }
+
+        bool operator()(unsigned a, unsigned b) const {
+            float startA = toFloat(world.getFlock(a).stats.getMin().x);
+            float startB = toFloat(world.getFlock(b).stats.getMin().x);
+            return startA < startB || (startA == startB && a < b);
+        }
+    };
+}
+
+CollisionSystem::CollisionSystem(World &world)
+        : _world(world), _simdEnabled(true) {
+
+}
 
 void CollisionSystem::init() {
 
@@ -38,87 +64,417 @@ void CollisionSystem::terminate() {
 
 }
 
-void CollisionSystem::restoreBoidsPosition() {
-    Engine::BoidVector &boids = getEngine().getBoids();
-    size_t size = boids.size();
+/// Keeps the follow boids out of the tower, each chunk moving its own boids.
+struct CollisionSystem::TowerTask {
+    CollisionSystem &system;
+    BoidStore &boids;
+    simd::Cone tower;
+    float maxTurn;
+
+    TowerTask(CollisionSystem &_system, BoidStore &_boids,
+            const simd::Cone &_tower, float _maxTurn)
+        : system(_system), boids(_boids), tower(_tower), maxTurn(_maxTurn) {
 
-    // Go through each boid. If their position is different than their old
-    // position, try to restore.
-    for(size_t i = 0; i < size; ++i) {
-        if(boids[i].position != boids[i].oldPosition) {
-            std::cout << "wow, different position" << std::endl;
-        }
     }
+
+    void operator()(size_t begin, size_t end, unsigned) {
+        if(system._simdEnabled)
+            simd::avoidCone(boids, tower, begin, end, TowerClearance,
+                    TowerLookahead, maxTurn, BoidMaxSpeed);
+        else
+            simd::avoidConeScalar(boids, tower, begin, end, TowerClearance,
+                    TowerLookahead, maxTurn, BoidMaxSpeed);
+    }
+};
+
+CollisionSystem::Bounds CollisionSystem::getBounds(const FlockStats &stats,
+        float margin) {
+    Point low = stats.getMin(), high = stats.getMax();
+    Bounds bounds = { toFloat(low.x) - margin, toFloat(low.y) - margin,
+        toFloat(low.z) - margin, toFloat(high.x) + margin,
+        toFloat(high.y) + margin, toFloat(high.z) + margin };
+    return bounds;
 }
 
-void CollisionSystem::calculateCollisionWithTower() {
-    Engine::BoidVector &boids = getEngine().getBoids();
-    size_t size = boids.size();
+void CollisionSystem::calculateCollisionWithTower(Flock &flock, float dt) {
+    const simd::Cone tower = { 0.0f, 0.0f, TowerBaseRadius, TowerHeight };
+    const float slant = std::sqrt(TowerHeight * TowerHeight
+            + TowerBaseRadius * TowerBaseRadius);
 
-    // We have to do this for all boids.
-    for(size_t i = 0; i < size; ++i) {
+    // Push the objective boid out of the side of the tower.
+    Point &position = flock.leader.position;
+    Vector axis(position.x - tower.x, 0.0, position.z - tower.z);
+    Scalar r = axis.module();
+    Scalar distance = (TowerHeight * r + TowerBaseRadius * position.y
+            - TowerBaseRadius * TowerHeight) / slant;
+    if(distance < 0 && r > 0) {
+        axis.normalize();
+        Vector normal = axis * (TowerHeight / slant)
+            + Vector(0.0, TowerBaseRadius / slant, 0.0);
+        position -= normal * distance;
+    }
+
+    // The aggregates were rescanned after the flock moved: if its bounding
+    // box is far from the tower, every boid is.
+    const FlockStats &stats = flock.stats;
+    float reach = TowerBaseRadius + TowerClearance
+        + TowerLookahead * BoidMaxSpeed;
+    Point low = stats.getMin(), high = stats.getMax();
+    if(stats.empty() || low.x > tower.x + reach || high.x < tower.x - reach
+            || low.z > tower.z + reach || high.z < tower.z - reach
+            || low.y > TowerHeight + TowerClearance
+                + TowerLookahead * BoidMaxSpeed)
+        return;
+
+    // The boids that are close are tested in parallel, the rest are
+    // skipped by the kernel.
+    BoidStore &boids = flock.boids;
+    TowerTask task(*this, boids, tower, BoidMaxForce * dt);
+    _world.getThreadPool().parallelFor(0, boids.size(), BoidsPerChunk, task);
+}
+
+/**
+ * Keeps the follow boids out of the obstacles, each chunk moving its own
+ * boids. Like avoidCone(), but with the distance and normal of the field.
+ **/
+struct CollisionSystem::ObstacleTask {
+    BoidStore &boids;
+    const ObstacleField &obstacles;
+    float maxTurn;
+
+    ObstacleTask(BoidStore &_boids, const ObstacleField &_obstacles,
+            float _maxTurn)
+        : boids(_boids), obstacles(_obstacles), maxTurn(_maxTurn) {
 
     }
+
+    void operator()(size_t begin, size_t end, unsigned) {
+        float *px = boids.px(), *py = boids.py(), *pz = boids.pz();
+        float *vx = boids.vx(), *vy = boids.vy(), *vz = boids.vz();
+
+        for(size_t i = begin; i < end; ++i) {
+            // Most boids are in empty bricks, far from every obstacle.
+            float gx, gy, gz;
+            float distance = obstacles.sample(px[i], py[i], pz[i], gx, gy,
+                    gz);
+            if(distance >= ObstacleField::Band)
+                continue;
+
+            float gradient = std::sqrt(gx * gx + gy * gy + gz * gz);
+            if(gradient == 0.0f)
+                continue;
+
+            float nx = gx / gradient, ny = gy / gradient, nz = gz / gradient;
+            float outward = vx[i] * nx + vy[i] * ny + vz[i] * nz;
+
+            // Out of the obstacle, without the velocity into it.
+            bool inside = distance < 0.0f;
+            float kept = inside ? std::max(outward, 0.0f) : outward;
+            float predicted = std::max(distance, 0.0f)
+                + kept * ObstacleLookahead;
+            if(!inside && predicted >= ObstacleClearance)
+                continue;
+
+            if(inside) {
+                px[i] -= nx * distance;
+                py[i] -= ny * distance;
+                pz[i] -= nz * distance;
+            }
+
+            // Turn away from where the boid will be.
+            float turn = std::min(std::max(ObstacleClearance - predicted,
+                        0.0f) / ObstacleLookahead, maxTurn);
+            float change = kept - outward + turn;
+            vx[i] += nx * change;
+            vy[i] += ny * change;
+            vz[i] += nz * change;
+            boids.updateSpeed(i);
+        }
+    }
+};
+
+void CollisionSystem::calculateCollisionWithObstacles(Flock &flock,
+        float dt) {
+    const ObstacleField &obstacles = _world.getObstacles();
+    if(obstacles.empty())
+        return;
+
+    // Push the objective boid out of the obstacles.
+    Point &position = flock.leader.position;
+    float gx, gy, gz;
+    float distance = obstacles.sample(toFloat(position.x),
+            toFloat(position.y), toFloat(position.z), gx, gy, gz);
+    if(distance < 0.0f) {
+        Vector normal(gx, gy, gz);
+        normal.normalize();
+        position -= normal * distance;
+    }
+
+    BoidStore &boids = flock.boids;
+    ObstacleTask task(boids, obstacles, BoidMaxForce * dt);
+    _world.getThreadPool().parallelFor(0, boids.size(), BoidsPerChunk, task);
 }
 
-void CollisionSystem::calculateCollisionWithGround() {
-    /*
-    // I think it is enough to not allow the objective boid to go lower than
-    // the minimum height.
-    if(getEngine().getObjectiveBoid().position.y < MinimumHeight)
-        getEngine().getObjectiveBoid().position.y = MinimumHeight;
-    */
+void CollisionSystem::calculateCollisionWithGround(Flock &flock) {
+    // Do not allow the objective boid to go lower than the minimum height.
+    if(flock.leader.position.y < MinimumHeight)
+        flock.leader.position.y = MinimumHeight;
+
+    // The aggregates were rescanned after the flock moved: if the lowest
+    // boid is above the minimum height, all of them are.
+    if(flock.stats.getMinAltitude() >= MinimumHeight)
+        return;
 
-    Engine::BoidVector &boids = getEngine().getBoids();
-    ObjectiveBoid &obj = getEngine().getObjectiveBoid();
+    BoidStore &boids = flock.boids;
     size_t size = boids.size();
-    float lowest = 0.0;
 
-    // Get the lowest boid height relative to the objective boid.
+    // The follow boids fly by themselves, so each one must be kept above the
+    // minimum height. Stop them from going any further down.
+    float *py = boids.py(), *vy = boids.vy();
     for(size_t i = 0; i < size; ++i) {
-        if(boids[i].position.y < lowest)
-            lowest = boids[i].position.y;
+        if(py[i] < MinimumHeight) {
+            py[i] = MinimumHeight;
+            if(vy[i] < 0.0) {
+                vy[i] = 0.0;
+                boids.updateSpeed(i);
+            }
+        }
     }
-
-    // The objective boid's height minus the lowest height can't go lower than
-    // minimum height.
-    if(obj.position.y + lowest < MinimumHeight)
-        obj.position.y = MinimumHeight - lowest;
 }
 
-void CollisionSystem::calculateCollisionWithCeiling() {
-    // I think it is enough to not allow the objective boid to go higher than
-    // the maximum height.
-    if(getEngine().getObjectiveBoid().position.y > MaximumHeight)
-        getEngine().getObjectiveBoid().position.y = MaximumHeight;
-}
+void CollisionSystem::calculateCollisionWithCeiling(Flock &flock) {
+    // Do not allow the objective boid to go higher than the maximum height.
+    if(flock.leader.position.y > MaximumHeight)
+        flock.leader.position.y = MaximumHeight;
+
+    // Same for the follow boids, if the highest one is too high.
+    if(flock.stats.getMaxAltitude() <= MaximumHeight)
+        return;
 
-void CollisionSystem::calculateCollisionBetweenBoids() {
-    Engine::BoidVector &boids = getEngine().getBoids();
+    BoidStore &boids = flock.boids;
     size_t size = boids.size();
 
-    // Test each boid with the others.
+    // Stop them from going any further up.
+    float *py = boids.py(), *vy = boids.vy();
     for(size_t i = 0; i < size; ++i) {
-        for(size_t j = i + 1; j < size; ++j) {
-            // Calculate the distance between their position. If it is smaller
-            // than 2 * BoidSpace, they are about to collide.
-            if(Point::distance(boids[i].position, boids[j].position)
-                    < 2 * BoidSpace) {
-                // Move in the opposite direction of the collision.
-                //Vector dir = boids[j].position - boids[i].position;
+        if(py[i] > MaximumHeight) {
+            py[i] = MaximumHeight;
+            if(vy[i] > 0.0) {
+                vy[i] = 0.0;
+                boids.updateSpeed(i);
             }
         }
     }
 }
 
+/**
+ * Moves the boids out of their collisions with other boids, of the same
+ * flock or of another one. The boids are tested against the gathered
+ * positions, which no chunk writes, and each boid only moves itself in the
+ * store, so the chunks are independent.
+ **/
+struct CollisionSystem::BoidCollisionTask {
+    CollisionSystem &system;
+    const SortedBoids &tested, &against;
+    const NeighborList *neighbors;
+    const Bounds &bounds;
+    float distance, radius;
+
+    BoidCollisionTask(CollisionSystem &_system, const SortedBoids &_tested,
+            const SortedBoids &_against, const NeighborList *_neighbors,
+            const Bounds &_bounds, float _distance, float _radius)
+        : system(_system), tested(_tested), against(_against),
+        neighbors(_neighbors), bounds(_bounds), distance(_distance),
+        radius(_radius) {
+
+    }
+
+    void operator()(size_t begin, size_t end, unsigned thread) {
+        std::vector<unsigned> &candidates = system._candidates[thread];
+        const unsigned *indices = tested.grid->getSortedIndices();
+        const float *x = tested.x, *y = tested.y, *z = tested.z;
+        BoidStore &boids = *tested.boids;
+
+        for(size_t p = begin; p < end; ++p) {
+            // The boids outside the bounds can't reach any other boid.
+            if(!bounds.contains(x[p], y[p], z[p]))
+                continue;
+
+            // Take the candidates from the lists, or from the cells around
+            // the boid. The kernels read whole Floats, so leave room for the
+            // last one.
+            const unsigned *close;
+            size_t count;
+            if(neighbors) {
+                close = neighbors->getNeighbors(p);
+                count = neighbors->getNumNeighbors(p);
+            }
+            else {
+                candidates.clear();
+                against.grid->findCandidates(x[p], y[p], z[p], radius,
+                        candidates);
+                count = candidates.size();
+                candidates.resize(count + simd::Width - 1, 0);
+                close = &candidates[0];
+            }
+
+            float cx, cy, cz;
+            if(system._simdEnabled)
+                simd::sumCollisions(against.x, against.y, against.z, close,
+                        count, x[p], y[p], z[p], distance, cx, cy, cz);
+            else
+                simd::sumCollisionsScalar(against.x, against.y, against.z,
+                        close, count, x[p], y[p], z[p], distance, cx, cy,
+                        cz);
+
+            unsigned i = indices[p];
+            boids.px()[i] += cx;
+            boids.py()[i] += cy;
+            boids.pz()[i] += cz;
+        }
+    }
+};
+
+void CollisionSystem::calculateCollisionBetweenBoids(Flock &flock, float dt) {
+    // No boid can enter the boid space sphere around another.
+    const float collisionDistance = _world.getParameters().boidSpace;
+    const float infinity = std::numeric_limits<float>::infinity();
+    const Bounds everywhere = { -infinity, -infinity, -infinity, infinity,
+        infinity, infinity };
+    SpatialGrid &grid = flock.grid;
+    ThreadPool &pool = _world.getThreadPool();
+
+    // Only the boids in the grid are tested. The ones added since it was
+    // built are tested in the next tick.
+    size_t size = grid.size();
+    if(!size)
+        return;
+
+    // The grid was built before the boids moved in this tick, so look a bit
+    // further to find every boid that is close now. The neighbor lists
+    // already cover the moves of this tick.
+    float radius = collisionDistance + BoidMaxSpeed * dt;
+    const NeighborList *neighbors = _world.usesNeighborList()
+        ? &flock.neighborList : 0;
+
+    // Test the current positions, in the order of the grid.
+    _x.resize(size);
+    _y.resize(size);
+    _z.resize(size);
+    grid.gather(flock.boids.px(), &_x[0]);
+    grid.gather(flock.boids.py(), &_y[0]);
+    grid.gather(flock.boids.pz(), &_z[0]);
+    SortedBoids sorted = { &flock.boids, &grid, &_x[0], &_y[0], &_z[0] };
+
+    // Test each boid with the ones close to it. The boids are tested with
+    // the gathered positions, so the order doesn't matter.
+    _candidates.resize(pool.getNumThreads());
+    BoidCollisionTask collisions(*this, sorted, sorted, neighbors,
+            everywhere, collisionDistance, radius);
+    pool.parallelFor(0, size, BoidsPerChunk, collisions);
+}
+
+void CollisionSystem::findOverlappingFlocks(float margin) {
+    _sweep.clear();
+    for(unsigned f = 0; f < _world.getNumFlocks(); ++f)
+        if(!_world.getFlock(f).stats.empty())
+            _sweep.push_back(f);
+    std::sort(_sweep.begin(), _sweep.end(), BoundsStartLess(_world));
+
+    _flockPairs.clear();
+    for(size_t i = 0; i < _sweep.size(); ++i) {
+        Bounds a = getBounds(_world.getFlock(_sweep[i]).stats, margin);
+        for(size_t j = i + 1; j < _sweep.size(); ++j) {
+            // The boxes after this one start even further in x.
+            Bounds b = getBounds(_world.getFlock(_sweep[j]).stats, 0.0);
+            if(b.minX > a.maxX)
+                break;
+
+            if(b.maxY < a.minY || b.minY > a.maxY || b.maxZ < a.minZ
+                    || b.minZ > a.maxZ)
+                continue;
+
+            _flockPairs.push_back(std::make_pair(
+                        std::min(_sweep[i], _sweep[j]),
+                        std::max(_sweep[i], _sweep[j])));
+        }
+    }
+    std::sort(_flockPairs.begin(), _flockPairs.end());
+}
+
+void CollisionSystem::calculateCollisionBetweenFlocks(float dt) {
+    const float collisionDistance = _world.getParameters().boidSpace;
+    ThreadPool &pool = _world.getThreadPool();
+
+    // The aggregates were rescanned after the flocks moved, so two boids can
+    // only be closer than the collision distance if their boxes are.
+    findOverlappingFlocks(collisionDistance);
+
+    // The grids were built before the boids moved in this tick, or, with
+    // the neighbor lists, before they moved at most half the skin.
+    float radius = collisionDistance + std::max(BoidMaxSpeed * dt,
+            _world.getParameters().neighborSkin);
+
+    _candidates.resize(pool.getNumThreads());
+    for(size_t p = 0; p < _flockPairs.size(); ++p) {
+        Flock &a = _world.getFlock(_flockPairs[p].first);
+        Flock &b = _world.getFlock(_flockPairs[p].second);
+        size_t sizeA = a.grid.size(), sizeB = b.grid.size();
+        if(!sizeA || !sizeB)
+            continue;
+
+        // Gather both flocks before moving any boid, so the boids of each
+        // are moved by the positions of the other before the pair.
+        _x.resize(sizeA);
+        _y.resize(sizeA);
+        _z.resize(sizeA);
+        a.grid.gather(a.boids.px(), &_x[0]);
+        a.grid.gather(a.boids.py(), &_y[0]);
+        a.grid.gather(a.boids.pz(), &_z[0]);
+        _otherX.resize(sizeB);
+        _otherY.resize(sizeB);
+        _otherZ.resize(sizeB);
+        b.grid.gather(b.boids.px(), &_otherX[0]);
+        b.grid.gather(b.boids.py(), &_otherY[0]);
+        b.grid.gather(b.boids.pz(), &_otherZ[0]);
+        SortedBoids sortedA = { &a.boids, &a.grid, &_x[0], &_y[0], &_z[0] };
+        SortedBoids sortedB = { &b.boids, &b.grid, &_otherX[0],
+            &_otherY[0], &_otherZ[0] };
+
+        // Only the boids inside the box of the other flock can touch it.
+        Bounds boundsA = getBounds(a.stats, collisionDistance);
+        Bounds boundsB = getBounds(b.stats, collisionDistance);
+        BoidCollisionTask outOfB(*this, sortedA, sortedB, 0, boundsB,
+                collisionDistance, radius);
+        pool.parallelFor(0, sizeA, BoidsPerChunk, outOfB);
+        BoidCollisionTask outOfA(*this, sortedB, sortedA, 0, boundsA,
+                collisionDistance, radius);
+        pool.parallelFor(0, sizeB, BoidsPerChunk, outOfA);
+    }
+}
+
+unsigned CollisionSystem::getReads() const {
+    return ObjectiveBoidComponent | BoidPositionComponent | GridComponent
+            | MiddlePositionComponent;
+}
+
+unsigned CollisionSystem::getWrites() const {
+    return ObjectiveBoidComponent | BoidPositionComponent
+            | BoidVelocityComponent;
+}
+
 void CollisionSystem::update(float dt) {
-    // Try to restore to original position.
-    restoreBoidsPosition();
+    // The flocks are tested against each other first, while their
+    // aggregates still bound them.
+    calculateCollisionBetweenFlocks(dt);
 
     // Calculate new collisions.
-    calculateCollisionWithTower();
-    calculateCollisionWithGround();
-    calculateCollisionWithCeiling();
-    calculateCollisionBetweenBoids();
+    for(size_t f = 0; f < _world.getNumFlocks(); ++f) {
+        Flock &flock = _world.getFlock(f);
+        calculateCollisionWithTower(flock, dt);
+        calculateCollisionWithObstacles(flock, dt);
+        calculateCollisionWithGround(flock);
+        calculateCollisionWithCeiling(flock);
+        calculateCollisionBetweenBoids(flock, dt);
+    }
 }
-
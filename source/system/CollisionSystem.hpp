@@ -29,37 +29,151 @@
 #define SYSTEM_COLLISIONSYSTEM_HPP
 
 #include "System.hpp"
+#include "../math/Vector.hpp"
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+class BoidStore;
+class FlockStats;
+class NeighborList;
+class SpatialGrid;
+class World;
+struct Flock;
 
 class CollisionSystem : public System {
+    /// The world of the boids.
+    World &_world;
+
+    /// If the SIMD kernels are used instead of the scalar ones.
+    bool _simdEnabled;
+
+    /**
+     * Positions of the follow boids of a flock, in the order of its grid.
+     * The boids are tested against these, and moved in the store, so every
+     * boid is moved by its collisions with the positions before any was
+     * moved. _otherX, _otherY and _otherZ hold the ones of the other flock
+     * of a pair of flocks.
+     **/
+    std::vector<float> _x, _y, _z;
+    std::vector<float> _otherX, _otherY, _otherZ;
+
+    /// Boids that may collide with the boid being tested, for each thread.
+    std::vector<std::vector<unsigned> > _candidates;
+
+    /// Indices of the flocks with boids, sorted by the start of their boxes.
+    std::vector<unsigned> _sweep;
+
+    /// Pairs of flocks whose boxes overlap, found by findOverlappingFlocks().
+    std::vector<std::pair<unsigned, unsigned> > _flockPairs;
+
+    /// An axis-aligned box.
+    struct Bounds {
+        float minX, minY, minZ;
+        float maxX, maxY, maxZ;
+
+        /// Returns if the point is inside the box.
+        inline bool contains(float x, float y, float z) const {
+            return x >= minX && x <= maxX && y >= minY && y <= maxY
+                && z >= minZ && z <= maxZ;
+        }
+    };
+
+    /**
+     * Boids of a flock in the order of its grid, with their positions before
+     * the collisions moved any.
+     **/
+    struct SortedBoids {
+        BoidStore *boids;
+        const SpatialGrid *grid;
+        const float *x, *y, *z;
+    };
+
+    /// Loop bodies run by the thread pool.
+    struct BoidCollisionTask;
+    struct TowerTask;
+    struct ObstacleTask;
+
+    /// Returns the bounding box of the aggregates, grown by margin.
+    static Bounds getBounds(const FlockStats &stats, float margin);
+
+    /**
+     * Calculates the collision of a flock with the tower. The follow boids
+     * inside it are pushed out, and the ones flying towards it turn away.
+     * Nothing is done if the flock is far from it.
+     * @param dt Length of the tick, to limit how fast the boids turn.
+     **/
+    void calculateCollisionWithTower(Flock &flock, float dt);
+
+    /**
+     * Calculates the collision of a flock with the static obstacles, like
+     * the one with the tower, but with the distance field of the obstacles:
+     * one lookup per boid, however many obstacles there are.
+     * @param dt Length of the tick, to limit how fast the boids turn.
+     **/
+    void calculateCollisionWithObstacles(Flock &flock, float dt);
+
     /**
-     * Tries to restore the boids to their original position.
+     * Calculates the collision of a flock with the ground.
      **/
-    void restoreBoidsPosition();
+    void calculateCollisionWithGround(Flock &flock);
 
     /**
-     * Calculates the collision with the tower.
+     * Calculates the collision of a flock with the ceiling.
      **/
-    void calculateCollisionWithTower();
+    void calculateCollisionWithCeiling(Flock &flock);
 
     /**
-     * Calculates the collision with the ground.
+     * Calculates the collision between the follow boids of a flock.
+     * Uses the grid of the flock to only test the boids close to each other.
+     * @param dt How much time passed since the grid was built.
      **/
-    void calculateCollisionWithGround();
+    void calculateCollisionBetweenBoids(Flock &flock, float dt);
 
     /**
-     * Calculates the collision with the ceiling.
+     * Finds the pairs of flocks whose bounding boxes are closer than margin,
+     * by sorting the boxes by their start in x and sweeping along it: each
+     * box is only compared with the ones that start before it ends. The cost
+     * grows with the number of flocks that overlap in x, not with the square
+     * of the number of flocks. The pairs are sorted, so they are the same
+     * with any order of the flocks.
      **/
-    void calculateCollisionWithCeiling();
+    void findOverlappingFlocks(float margin);
 
     /**
-     * Calculates the collision between follow boids.
+     * Calculates the collision between the follow boids of different
+     * flocks. Only the pairs of flocks whose boxes overlap are tested, and
+     * of those, only the boids inside the box of the other flock.
+     * @param dt How much time passed since the grids were built.
      **/
-    void calculateCollisionBetweenBoids();
+    void calculateCollisionBetweenFlocks(float dt);
 
 public:
+    explicit CollisionSystem(World &world);
+
     void init();
     void terminate();
     void update(float dt);
+    unsigned getReads() const;
+    unsigned getWrites() const;
+
+    /**
+     * Chooses between the SIMD kernels (the default) and their scalar
+     * reference versions.
+     **/
+    inline void setSimdEnabled(bool enabled) {
+        _simdEnabled = enabled;
+    }
+
+    /// Returns if the SIMD kernels are used.
+    inline bool isSimdEnabled() const {
+        return _simdEnabled;
+    }
+
+    /// Returns the number of pairs of flocks tested in the last update.
+    inline size_t getNumFlockPairs() const {
+        return _flockPairs.size();
+    }
 };
 
 #endif // !SYSTEM_COLLISIONSYSTEM_HPP
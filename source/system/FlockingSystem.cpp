@@ -0,0 +1,417 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "FlockingSystem.hpp"
+#include "../World.hpp"
+#include "../defs.hpp"
+#include <limits>
+
+FlockingSystem::FlockingSystem(World &world)
+        : _world(world), _simdEnabled(true), _lodBudget(0), _lodShift(0),
+        _numUpdated(0) {
+
+}
+
+void FlockingSystem::init() {
+
+}
+
+void FlockingSystem::terminate() {
+
+}
+
+Vector FlockingSystem::calculateAcceleration(const simd::Particles &boids,
+        size_t p, const unsigned *candidates, size_t count, float radius,
+        const Point &target, const Vector &leaderVelocity,
+        const Point *farCentroid) {
+    const WorldParameters &parameters = _world.getParameters();
+    Point position(boids.x[p], boids.y[p], boids.z[p]);
+    Vector velocity(boids.vx[p], boids.vy[p], boids.vz[p]);
+
+    simd::FlockmateSums flockmates;
+    if(_simdEnabled)
+        simd::sumFlockmates(boids, candidates, count, boids.x[p],
+                boids.y[p], boids.z[p], radius,
+                parameters.separationRadius, flockmates);
+    else
+        simd::sumFlockmatesScalar(boids, candidates, count, boids.x[p],
+                boids.y[p], boids.z[p], radius,
+                parameters.separationRadius, flockmates);
+
+    Vector acceleration = Vector(flockmates.separationX,
+            flockmates.separationY, flockmates.separationZ)
+        * FlockingSeparationWeight;
+
+    // Steer towards the average velocity and position of the flockmates.
+    if(flockmates.neighbors) {
+        float invNeighbors = 1.0 / flockmates.neighbors;
+        Vector alignment = Vector(flockmates.alignmentX,
+                flockmates.alignmentY, flockmates.alignmentZ) * invNeighbors
+            - velocity;
+        Vector cohesion = Vector(flockmates.cohesionX, flockmates.cohesionY,
+                flockmates.cohesionZ) * invNeighbors
+            - Vector(position.x, position.y, position.z);
+
+        acceleration += alignment * FlockingAlignmentWeight;
+        acceleration += cohesion * FlockingCohesionWeight;
+    }
+
+    // Steer towards the rest of the flock, far ones included.
+    if(farCentroid)
+        acceleration += (*farCentroid - position) * FlockingFarCohesionWeight;
+
+    // Fly like the leader while closing in on the point behind it.
+    Vector desired = leaderVelocity + (target - position) * FlockingLeaderGain;
+    Scalar desiredSpeed = desired.module();
+    if(desiredSpeed > BoidMaxSpeed)
+        desired *= BoidMaxSpeed / desiredSpeed;
+    acceleration += (desired - velocity) * FlockingLeaderWeight;
+
+    // Limit the acceleration.
+    Scalar force = acceleration.module();
+    if(force > BoidMaxForce)
+        acceleration *= BoidMaxForce / force;
+
+    return acceleration;
+}
+
+/**
+ * Finds the level of detail of each boid from its distance to the center.
+ * Each boid writes its own level, so the chunks are independent.
+ **/
+struct FlockingSystem::LevelTask {
+    FlockingSystem &system;
+    const BoidStore &boids;
+
+    LevelTask(FlockingSystem &_system, const BoidStore &_boids)
+        : system(_system), boids(_boids) {
+
+    }
+
+    void operator()(size_t begin, size_t end, unsigned) {
+        const float cx = toFloat(system._lodCenter.x);
+        const float cy = toFloat(system._lodCenter.y);
+        const float cz = toFloat(system._lodCenter.z);
+        for(size_t i = begin; i < end; ++i) {
+            float dx = boids.px()[i] - cx, dy = boids.py()[i] - cy,
+                  dz = boids.pz()[i] - cz;
+            float distance2 = dx * dx + dy * dy + dz * dz;
+
+            // One level more each time the distance doubles.
+            int level = 0;
+            float reach = LodNearDistance;
+            while(level < LodMaxLevel && distance2 >= reach * reach) {
+                ++level;
+                reach *= 2.0f;
+            }
+            system._levels[i] = level;
+        }
+    }
+};
+
+/// Puts the boids in the order of the grid or the tree.
+struct FlockingSystem::GatherTask {
+    FlockingSystem &system;
+    const BoidStore &boids;
+    const unsigned *order;
+
+    GatherTask(FlockingSystem &_system, const BoidStore &_boids,
+            const unsigned *_order)
+        : system(_system), boids(_boids), order(_order) {
+
+    }
+
+    void operator()(size_t begin, size_t end, unsigned) {
+        for(size_t p = begin; p < end; ++p) {
+            unsigned i = order[p];
+            system._x[p] = boids.px()[i];
+            system._y[p] = boids.py()[i];
+            system._z[p] = boids.pz()[i];
+            system._vx[p] = boids.vx()[i];
+            system._vy[p] = boids.vy()[i];
+            system._vz[p] = boids.vz()[i];
+        }
+    }
+};
+
+/**
+ * Calculates the accelerations of the boids. Each boid only writes its own
+ * acceleration, so the chunks are independent.
+ **/
+struct FlockingSystem::AccelerationTask {
+    FlockingSystem &system;
+    const BoidStore &boids;
+    const simd::Particles &sorted;
+    const Flockmates &flockmates;
+    Point target;
+    Vector leaderVelocity;
+    uint32_t tick;
+
+    AccelerationTask(FlockingSystem &_system, const BoidStore &_boids,
+            const simd::Particles &_sorted, const Flockmates &_flockmates,
+            const Point &_target, const Vector &_leaderVelocity,
+            uint32_t _tick)
+        : system(_system), boids(_boids), sorted(_sorted),
+        flockmates(_flockmates), target(_target),
+        leaderVelocity(_leaderVelocity), tick(_tick) {
+
+    }
+
+    void operator()(size_t begin, size_t end, unsigned thread) {
+        const unsigned *indices = flockmates.order;
+        std::vector<unsigned> &candidates = system._candidates[thread];
+
+        for(size_t p = begin; p < end; ++p) {
+            // A boid every 2^level ticks is flocked in one of the ticks,
+            // chosen by its handle. The intervals are powers of two, so a
+            // boid that changes level keeps being flocked in the same ticks.
+            unsigned interval = 1;
+            if(system._lodBudget) {
+                interval = 1u << system.getLevel(indices[p]);
+                uint32_t slot = boids.handleAt(indices[p]).slot;
+                if((tick + slot) & (interval - 1))
+                    continue;
+            }
+            ++system._threadUpdates[thread];
+
+            // Take the flockmates from the lists or the tree, or look for
+            // them in the cells around the boid. The kernels read whole
+            // Floats, so leave room for the last one.
+            const unsigned *mates;
+            size_t count;
+            if(flockmates.lists) {
+                mates = flockmates.lists->getNeighbors(p);
+                count = flockmates.lists->getNumNeighbors(p);
+            }
+            else if(flockmates.tree) {
+                mates = flockmates.tree->getNearest(p);
+                count = flockmates.tree->getNumNearest();
+            }
+            else {
+                candidates.clear();
+                flockmates.grid->findCandidates(sorted.x[p], sorted.y[p],
+                        sorted.z[p], flockmates.radius, candidates);
+                count = candidates.size();
+                candidates.resize(count + simd::Width - 1, 0);
+                mates = &candidates[0];
+            }
+
+            // The centroids of the octree are in the order of the store.
+            unsigned i = indices[p];
+            Point farCentroid;
+            const Octree *octree = flockmates.octree;
+            if(octree)
+                farCentroid = Point(octree->getCentroidX()[i],
+                        octree->getCentroidY()[i], octree->getCentroidZ()[i]);
+
+            Vector acceleration = system.calculateAcceleration(sorted, p,
+                    mates, count, flockmates.radius, target, leaderVelocity,
+                    octree ? &farCentroid : 0);
+
+            // Until it is flocked again, the boid flies straight.
+            if(interval > 1)
+                acceleration *= (float) interval;
+            system._ax[i] = toFloat(acceleration.x);
+            system._ay[i] = toFloat(acceleration.y);
+            system._az[i] = toFloat(acceleration.z);
+        }
+    }
+};
+
+/// Moves the boids.
+struct FlockingSystem::IntegrationTask {
+    FlockingSystem &system;
+    BoidStore &boids;
+    float dt;
+
+    IntegrationTask(FlockingSystem &_system, BoidStore &_boids, float _dt)
+        : system(_system), boids(_boids), dt(_dt) {
+
+    }
+
+    void operator()(size_t begin, size_t end, unsigned) {
+        if(system._simdEnabled)
+            simd::integrate(boids, &system._ax[0], &system._ay[0],
+                    &system._az[0], begin, end, dt, BoidMaxSpeed);
+        else
+            simd::integrateScalar(boids, &system._ax[0], &system._ay[0],
+                    &system._az[0], begin, end, dt, BoidMaxSpeed);
+    }
+};
+
+void FlockingSystem::flock(ThreadPool &pool, const Boid &leader,
+        BoidStore &boids, const SpatialGrid &grid, float dt,
+        const NeighborList *neighbors, const Octree *octree) {
+    Flockmates flockmates;
+    flockmates.grid = &grid;
+    flockmates.lists = neighbors;
+    flockmates.tree = 0;
+    flockmates.order = grid.getSortedIndices();
+    flockmates.size = grid.size();
+    flockmates.radius = _world.getParameters().neighborRadius;
+    flockmates.octree = octree;
+    flock(pool, leader, boids, flockmates, dt);
+}
+
+void FlockingSystem::flockNearest(ThreadPool &pool, const Boid &leader,
+        BoidStore &boids, const KdTree &tree, float dt,
+        const Octree *octree) {
+    // Every one of the nearest boids is a flockmate, however far it is.
+    Flockmates flockmates;
+    flockmates.grid = 0;
+    flockmates.lists = 0;
+    flockmates.tree = &tree;
+    flockmates.order = tree.getSortedIndices();
+    flockmates.size = tree.size();
+    flockmates.radius = std::numeric_limits<float>::max();
+    flockmates.octree = octree;
+    flock(pool, leader, boids, flockmates, dt);
+}
+
+void FlockingSystem::findLevels(ThreadPool &pool, const BoidStore &boids) {
+    _levels.resize(boids.size());
+    LevelTask levels(*this, boids);
+    pool.parallelFor(0, boids.size(), BoidsPerChunk, levels);
+
+    size_t counts[LodMaxLevel + 1] = { 0 };
+    for(size_t i = 0; i < boids.size(); ++i)
+        ++counts[_levels[i]];
+
+    // Push the far boids further out until about budget boids are flocked
+    // per tick, or they are all at the last level.
+    for(_lodShift = 0; _lodShift < LodMaxLevel - 1; ++_lodShift) {
+        size_t updates = counts[0];
+        for(int level = 1; level <= LodMaxLevel; ++level)
+            updates += counts[level]
+                >> std::min(level + _lodShift, LodMaxLevel);
+        if(updates <= _lodBudget)
+            break;
+    }
+}
+
+void FlockingSystem::flock(ThreadPool &pool, const Boid &leader,
+        BoidStore &boids, const Flockmates &flockmates, float dt) {
+    _numUpdated = 0;
+    size_t size = flockmates.size;
+    if(!size)
+        return;
+
+    if(_lodBudget)
+        findLevels(pool, boids);
+
+    // The accelerations are read whole Floats at a time, like the store.
+    size_t padded = (boids.size() + BoidStore::Padding - 1)
+        / BoidStore::Padding * BoidStore::Padding;
+    _ax.assign(padded, 0.0f);
+    _ay.assign(padded, 0.0f);
+    _az.assign(padded, 0.0f);
+    _candidates.resize(pool.getNumThreads());
+    _threadUpdates.assign(pool.getNumThreads(), 0);
+
+    // Put the boids in the order of the grid or the tree, so the flockmates
+    // close in space are close in memory too.
+    _x.resize(size);
+    _y.resize(size);
+    _z.resize(size);
+    _vx.resize(size);
+    _vy.resize(size);
+    _vz.resize(size);
+    GatherTask gather(*this, boids, flockmates.order);
+    pool.parallelFor(0, size, BoidsPerChunk, gather);
+    simd::Particles sorted = { &_x[0], &_y[0], &_z[0], &_vx[0], &_vy[0],
+        &_vz[0] };
+
+    // The boids follow a point behind the leader.
+    Point target = leader.getAbsolutePosition()
+        - leader.direction * FlockingLeaderDistance;
+    Vector leaderVelocity = leader.direction * leader.speed;
+
+    // Calculate all the forces before moving anyone.
+    AccelerationTask accelerations(*this, boids, sorted, flockmates, target,
+            leaderVelocity, _world.getTick());
+    pool.parallelFor(0, size, BoidsPerChunk, accelerations);
+    for(size_t t = 0; t < _threadUpdates.size(); ++t)
+        _numUpdated += _threadUpdates[t];
+
+    // Move the boids into the next buffers, and make them the current ones.
+    IntegrationTask integration(*this, boids, dt);
+    pool.parallelFor(0, boids.size(), BoidsPerChunk, integration);
+    boids.swapBuffers();
+}
+
+unsigned FlockingSystem::getReads() const {
+    return ObjectiveBoidComponent | BoidPositionComponent
+            | BoidVelocityComponent;
+}
+
+unsigned FlockingSystem::getWrites() const {
+    return BoidPositionComponent | BoidVelocityComponent | GridComponent
+            | MiddlePositionComponent;
+}
+
+void FlockingSystem::update(float dt) {
+    // Sort the boids in the grids. This is the only rebuild of the tick: the
+    // other systems query the grids knowing the boids moved a bit since.
+    // With neighbor lists, the grids are only rebuilt with the lists.
+    if(_world.usesNeighborList())
+        _world.updateNeighborList();
+    else
+        _world.updateGrid();
+
+    // The collisions still use the grids or the lists, so the trees are
+    // built on top of them.
+    if(_world.usesTopologicalNeighbors())
+        _world.updateKdTree();
+    if(_world.usesFarCohesion())
+        _world.updateOctree();
+
+    // Move the follow boids of each flock, which only flock with each other.
+    // The budget of the level of detail is split between the flocks by their
+    // size.
+    ThreadPool &pool = _world.getThreadPool();
+    size_t budget = _world.getParameters().lodBudget;
+    size_t numBoids = _world.getNumBoids(), numUpdated = 0;
+    for(size_t f = 0; f < _world.getNumFlocks(); ++f) {
+        Flock &group = _world.getFlock(f);
+        setLevelOfDetail(_world.getLodCenter(), budget && numBoids
+                ? std::max((size_t) 1, budget * group.boids.size() / numBoids)
+                : 0);
+        const Octree *octree = _world.usesFarCohesion() ? &group.octree : 0;
+        if(_world.usesTopologicalNeighbors())
+            flockNearest(pool, group.leader, group.boids, group.kdTree, dt,
+                    octree);
+        else
+            flock(pool, group.leader, group.boids, group.grid, dt,
+                    _world.usesNeighborList() ? &group.neighborList : 0,
+                    octree);
+        numUpdated += _numUpdated;
+    }
+    _numUpdated = numUpdated;
+
+    // The flocks moved, so their aggregates and their middles changed too.
+    _world.updateStats();
+}
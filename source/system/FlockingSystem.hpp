@@ -0,0 +1,252 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SYSTEM_FLOCKINGSYSTEM_HPP
+#define SYSTEM_FLOCKINGSYSTEM_HPP
+
+#include "System.hpp"
+#include "../defs.hpp"
+#include "../gameObject/Boid.hpp"
+#include "../gameObject/BoidStore.hpp"
+#include "../simd/kernels.hpp"
+#include "../spatial/KdTree.hpp"
+#include "../spatial/NeighborList.hpp"
+#include "../spatial/Octree.hpp"
+#include "../spatial/SpatialGrid.hpp"
+#include "../util/Noncopyable.hpp"
+#include "../util/ThreadPool.hpp"
+#include <algorithm>
+#include <vector>
+
+class World;
+
+/**
+ * The flocking system moves the follow boids.
+ * Each follow boid has its own velocity, which is
+ * steered every tick by the classic Reynolds rules: separation from close
+ * flockmates, alignment with and cohesion towards the flockmates inside
+ * FlockingNeighborRadius, plus a rule that seeks a point behind the objective
+ * boid. The flockmates of a boid and its objective boid are the ones of its
+ * own flock.
+ * Optionally, a far cohesion rule pulls each boid towards the centroid of
+ * its whole flock weighted by distance, found by an octree, so the groups
+ * of a large flock that lost sight of each other still come back together.
+ * With the level of detail on, the boids far from a center (the camera) are
+ * only flocked every few ticks, in slices: each tick flocks a different
+ * slice of them, with the acceleration of all the ticks of their interval,
+ * and the others keep flying straight.
+ * The radii of the rules come from the parameters of the world.
+ **/
+class FlockingSystem : public System, public NonCopyable {
+    /// The world of the boids.
+    World &_world;
+
+    /// If the SIMD kernels are used instead of the scalar ones.
+    bool _simdEnabled;
+
+    /**
+     * Acceleration calculated for each follow boid in this tick, padded like
+     * the boid store.
+     **/
+    std::vector<float> _ax, _ay, _az;
+
+    /// Positions and velocities of the boids, in the order of the grid.
+    std::vector<float> _x, _y, _z, _vx, _vy, _vz;
+
+    /// Candidate flockmates of the boid being calculated, for each thread.
+    std::vector<std::vector<unsigned> > _candidates;
+
+    /// Center of the level of detail.
+    Point _lodCenter;
+
+    /// Number of boids to flock per tick, or 0 to flock all of them.
+    size_t _lodBudget;
+
+    /**
+     * Level of detail of each follow boid in this tick, from its distance to
+     * the center: it is flocked every 2^level ticks, once _lodShift is added
+     * to the levels above 0.
+     **/
+    std::vector<unsigned char> _levels;
+
+    /// Levels added to the far boids in this tick to stay in the budget.
+    int _lodShift;
+
+    /// Number of boids flocked by each thread in this tick.
+    std::vector<size_t> _threadUpdates;
+
+    /// Number of boids flocked by the last tick.
+    size_t _numUpdated;
+
+    /**
+     * Where the flockmates of the boids come from: the neighbor lists or the
+     * nearest boids of the tree if given, else the queries of the grid.
+     **/
+    struct Flockmates {
+        const SpatialGrid *grid;
+        const NeighborList *lists;
+        const KdTree *tree;
+
+        /// Index of the boid at each sorted position of the grid or tree.
+        const unsigned *order;
+
+        /// Number of boids in the grid or tree.
+        size_t size;
+
+        /// Radius inside which the boids are flockmates.
+        float radius;
+
+        /// Octree with the centroids of the far cohesion, or 0.
+        const Octree *octree;
+    };
+
+    /// Loop bodies run by the thread pool.
+    struct LevelTask;
+    struct GatherTask;
+    struct AccelerationTask;
+    struct IntegrationTask;
+
+    /**
+     * Calculates the acceleration of the given follow boid from the state of
+     * the flock at the start of the tick.
+     * @param boids The follow boids, in the order of the grid.
+     * @param p Position of the boid in the order of the grid.
+     * @param candidates Candidate flockmates, in the order of the grid,
+     * readable simd::Width - 1 indices past the end.
+     * @param count Number of candidates.
+     * @param radius Radius inside which the candidates are flockmates.
+     * @param target Point the boid is trying to reach.
+     * @param leaderVelocity Velocity of the leader.
+     * @param farCentroid Centroid of the far cohesion, or 0 without it.
+     **/
+    Vector calculateAcceleration(const simd::Particles &boids, size_t p,
+            const unsigned *candidates, size_t count, float radius,
+            const Point &target, const Vector &leaderVelocity,
+            const Point *farCentroid);
+
+    /**
+     * Finds the level of detail of each boid of the flock, and the shift of
+     * the far levels that keeps the boids flocked per tick in the budget.
+     **/
+    void findLevels(ThreadPool &pool, const BoidStore &boids);
+
+    /// Returns the level of the boid i, with the shift of this tick.
+    inline int getLevel(size_t i) const {
+        int level = _levels[i];
+        return level ? std::min(level + _lodShift, LodMaxLevel) : 0;
+    }
+
+    /// Advances the flock, with the flockmates from the given source.
+    void flock(ThreadPool &pool, const Boid &leader, BoidStore &boids,
+            const Flockmates &flockmates, float dt);
+
+public:
+    explicit FlockingSystem(World &world);
+
+    void init();
+    void terminate();
+    void update(float dt);
+    unsigned getReads() const;
+    unsigned getWrites() const;
+
+    /**
+     * Advances the given flock by dt.
+     * The forces are all calculated before any boid is moved, so the result
+     * doesn't depend on the order of the boids.
+     * This only uses the parameters of the world, so it can be called from
+     * the benchmarks with any flock.
+     * The boids are split between the threads of the pool, and the result
+     * is the same with any number of threads.
+     * @param pool The threads to use.
+     * @param leader The boid the flock follows.
+     * @param boids The follow boids to move.
+     * @param grid Grid rebuilt with the current positions of the boids, or
+     * the grid the neighbor lists were built with.
+     * @param dt How much time to simulate.
+     * @param neighbors Neighbor lists to take the flockmates from, instead of
+     * querying the grid, or 0. They must not need a rebuild.
+     * @param octree Octree built with the current positions of the boids,
+     * with the centroids found by findCentroids(), to add the far cohesion,
+     * or 0 to leave it out.
+     **/
+    void flock(ThreadPool &pool, const Boid &leader, BoidStore &boids,
+            const SpatialGrid &grid, float dt,
+            const NeighborList *neighbors = 0, const Octree *octree = 0);
+
+    /**
+     * Advances the given flock by dt like flock(), but with topological
+     * flockmates: the nearest boids found by the tree, however close or far
+     * they are, instead of the boids inside the neighbor radius. The
+     * separation still only pushes away the ones inside the separation
+     * radius.
+     * @param tree Tree built with the current positions of the boids, with
+     * the nearest boids of every boid found by findAllNearest().
+     * @param octree Octree of the far cohesion, like in flock(), or 0.
+     **/
+    void flockNearest(ThreadPool &pool, const Boid &leader, BoidStore &boids,
+            const KdTree &tree, float dt, const Octree *octree = 0);
+
+    /**
+     * Turns on the level of detail of the flocking, or off with a budget of
+     * 0. The boids are flocked every tick up to LodNearDistance from the
+     * center, and half as often each time the distance doubles. When more
+     * than budget boids would be flocked in a tick, the boids past
+     * LodNearDistance are flocked even less often, down to once every
+     * 2^LodMaxLevel ticks, so the cost of a tick stays about the same
+     * however many boids are far.
+     * Which boids are flocked in a tick depends on the tick of the world
+     * and on the handles of the boids, so it is the same with any number of
+     * threads.
+     * @param center Point the distances are measured from.
+     * @param budget Number of boids to flock per call to flock(). update()
+     * splits the budget of the world between the flocks by their size.
+     **/
+    inline void setLevelOfDetail(const Point &center, size_t budget) {
+        _lodCenter = center;
+        _lodBudget = budget;
+    }
+
+    /// Returns the number of follow boids flocked by the last tick.
+    inline size_t getNumUpdated() const {
+        return _numUpdated;
+    }
+
+    /**
+     * Chooses between the SIMD kernels (the default) and their scalar
+     * reference versions.
+     **/
+    inline void setSimdEnabled(bool enabled) {
+        _simdEnabled = enabled;
+    }
+
+    /// Returns if the SIMD kernels are used.
+    inline bool isSimdEnabled() const {
+        return _simdEnabled;
+    }
+};
+
+#endif // !SYSTEM_FLOCKINGSYSTEM_HPP
@@ -43,11 +43,11 @@ void MovementSystem::updateObjectiveBoidSpeed(float dt) {
     ObjectiveBoid &boid = getEngine().getObjectiveBoid();
 
     // Increase the speed.
-    if(glfwGetKey(getEngine().getWindow(), ObjectiveBoidIncreaseSpeedKey) == GLFW_PRESS)
+    if(getEngine().isKeyPressed(ObjectiveBoidIncreaseSpeedKey))
         boid.speed += ObjectiveBoidSpeedFactor;
 
     // Decrease the speed.
-    if(glfwGetKey(getEngine().getWindow(), ObjectiveBoidDecreaseSpeedKey) == GLFW_PRESS)
+    if(getEngine().isKeyPressed(ObjectiveBoidDecreaseSpeedKey))
         boid.speed -= ObjectiveBoidSpeedFactor;
 
     // Do not allow the boid to go too fast.
@@ -66,19 +66,19 @@ void MovementSystem::updateObjectiveBoidDirection(float dt) {
     // Calculate the horizontal and vertical movements.
 
     // Up movement.
-    if(glfwGetKey(getEngine().getWindow(), ObjectiveBoidUpKey) == GLFW_PRESS)
+    if(getEngine().isKeyPressed(ObjectiveBoidUpKey))
         boid.verticalAngle += boid.keySensitivity * dt;
 
     // Down movement.
-    if(glfwGetKey(getEngine().getWindow(), ObjectiveBoidDownKey) == GLFW_PRESS)
+    if(getEngine().isKeyPressed(ObjectiveBoidDownKey))
         boid.verticalAngle -= boid.keySensitivity * dt;
 
     // Right movement.
-    if(glfwGetKey(getEngine().getWindow(), ObjectiveBoidRightKey) == GLFW_PRESS)
+    if(getEngine().isKeyPressed(ObjectiveBoidRightKey))
         boid.horizontalAngle += boid.keySensitivity * dt;
 
     // Left movement.
-    if(glfwGetKey(getEngine().getWindow(), ObjectiveBoidLeftKey) == GLFW_PRESS)
+    if(getEngine().isKeyPressed(ObjectiveBoidLeftKey))
         boid.horizontalAngle -= boid.keySensitivity * dt;
 
     // Limit looking up to vertically up.
@@ -95,11 +95,16 @@ void MovementSystem::updateObjectiveBoidDirection(float dt) {
     if(boid.horizontalAngle > 360.0)
         boid.horizontalAngle -= 360.0;
 
-    // sin and cos.
-    double sinVert = sin(toRads(boid.verticalAngle));
-    double cosVert = cos(toRads(boid.verticalAngle));
-    double sinHoriz = sin(toRads(boid.horizontalAngle));
-    double cosHoriz = cos(toRads(boid.horizontalAngle));
+    // sin and cos, of Scalars so the deterministic mode doesn't depend on
+    // the math library (see Scalar).
+    using std::sin;
+    using std::cos;
+    Scalar vertical = toRads(boid.verticalAngle);
+    Scalar horizontal = toRads(boid.horizontalAngle);
+    Scalar sinVert = sin(vertical);
+    Scalar cosVert = cos(vertical);
+    Scalar sinHoriz = sin(horizontal);
+    Scalar cosHoriz = cos(horizontal);
 
     // Calculate the direction.
     boid.direction.x = sinHoriz * cosVert;
@@ -118,6 +123,14 @@ void MovementSystem::updateObjectiveBoidDirection(float dt) {
     boid.up.normalize();
 }
 
+unsigned MovementSystem::getReads() const {
+    return KeysComponent | ObjectiveBoidComponent;
+}
+
+unsigned MovementSystem::getWrites() const {
+    return ObjectiveBoidComponent;
+}
+
 void MovementSystem::update(float dt) {
     // Change the objective boid speed.
     updateObjectiveBoidSpeed(dt);
@@ -125,8 +138,7 @@ void MovementSystem::update(float dt) {
     // Change the objective boid direction.
     updateObjectiveBoidDirection(dt);
 
-    // Move the objective boid.
-    getEngine().getObjectiveBoid().position +=
-        getEngine().getObjectiveBoid().direction *
-        getEngine().getObjectiveBoid().speed * dt;
+    // Move the objective boid, and the leaders of the other flocks.
+    getEngine().getWorld().moveObjectiveBoid(dt);
+    getEngine().getWorld().moveLeaders(dt);
 }
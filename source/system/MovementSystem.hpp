@@ -42,6 +42,8 @@ public:
     void init();
     void terminate();
     void update(float dt);
+    unsigned getReads() const;
+    unsigned getWrites() const;
 
     /**
      * Processes the direction of the objective boid.
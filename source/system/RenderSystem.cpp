@@ -102,7 +102,7 @@ void RenderSystem::destroySun() {
     glDeleteLists(_sunDisplayList, 1);
 }
 
-void RenderSystem::drawShadow() {
+void RenderSystem::drawShadow(float alpha) {
     glDisable(GL_LIGHT0);
 
     // Shadow's color.
@@ -112,57 +112,92 @@ void RenderSystem::drawShadow() {
         glScalef(1.0, 0.0, 1.0); // Collapse the y-value.
 
         // Draw the boids again.
-        drawObjectiveBoid();
-        drawFollowBoids();
+        drawObjectiveBoids(alpha);
+        drawFollowBoids(alpha);
     glPopMatrix();
 
     glEnable(GL_LIGHT0);
 }
 
-void RenderSystem::drawObjectiveBoid() {
+void RenderSystem::drawObjectiveBoids(float alpha) {
+    World &world = getEngine().getWorld();
+
     // Objective boid color.
     glColor3f(ObjectiveBoidColorRed, ObjectiveBoidColorGreen,
             ObjectiveBoidColorBlue);
 
-    // Translate the objective boid and the other boids.
-    glext::glTranslatep(getEngine().getObjectiveBoid().position);
+    for(size_t f = 0; f < world.getNumFlocks(); ++f) {
+        ObjectiveBoid &boid = world.getFlock(f).leader;
 
-    // Get the objective boid rotation.
-    Matrix4d rotation = Vector::toRotationMatrix(
-            getEngine().getObjectiveBoid().direction,
-            getEngine().getObjectiveBoid().up);
+        // Get the objective boid rotation.
+        Matrix4d rotation = Vector::toRotationMatrix(
+                boid.interpolateDirection(alpha), boid.interpolateUp(alpha));
 
-    glPushMatrix();
-        // Rotate the objective boid.
-        glext::glMultMatrixm(rotation);
+        glPushMatrix();
+            // Translate and rotate the objective boid.
+            glext::glTranslatep(boid.interpolatePosition(alpha));
+            glext::glMultMatrixm(rotation);
 
-        glCallList(getEngine().getObjectiveBoid().displayList);
-    glPopMatrix();
+            glCallList(boid.displayList);
+        glPopMatrix();
+    }
 }
 
-void RenderSystem::drawFollowBoids() {
-    // Get the objective boid rotation.
-    Matrix4d rotation = Vector::toRotationMatrix(
-            getEngine().getObjectiveBoid().direction,
-            getEngine().getObjectiveBoid().up);
+void RenderSystem::drawObstacles() {
+    const std::vector<Obstacle> &obstacles
+        = getEngine().getWorld().getObstacles().getObstacles();
+    if(obstacles.empty())
+        return;
 
-    glColor3f(BoidColorRed, BoidColorGreen, BoidColorBlue);
-    for(Engine::BoidVector::iterator it = getEngine().getBoids().begin();
-            it != getEngine().getBoids().end(); ++it) {
-        glPushMatrix();
-            // Rotate and translate.
-#if BOIDS_ROTATE_AFTER
-                glext::glMultMatrixm(rotation);
-                glext::glTranslatep(it->position);
-#else
-                glext::glTranslatep(it->position);
-                glext::glMultMatrixm(rotation);
-#endif
+    glColor3f(TowerColorRed, TowerColorGreen, TowerColorBlue);
+    GLUquadricObj *quadObj = gluNewQuadric();
+    gluQuadricNormals(quadObj, GLU_SMOOTH);
+    for(size_t o = 0; o < obstacles.size(); ++o) {
+        const Obstacle &obstacle = obstacles[o];
+        bool pillar = obstacle.shape == Obstacle::PillarShape;
 
-            glCallList(it->displayList);
+        glPushMatrix();
+            // Stand the obstacle on the ground, pointing to the top.
+            glTranslatef(obstacle.x, 0.0, obstacle.z);
+            glRotatef(-90, 1.0, 0.0, 0.0);
+
+            gluCylinder(quadObj, obstacle.radius,
+                    pillar ? obstacle.radius : 0.0, obstacle.height,
+                    CurvedShapeFidelity, CurvedShapeFidelity);
+            if(pillar) {
+                glTranslatef(0.0, 0.0, obstacle.height);
+                gluDisk(quadObj, 0.0, obstacle.radius, CurvedShapeFidelity,
+                        1);
+            }
         glPopMatrix();
     }
+    gluDeleteQuadric(quadObj);
+}
 
+void RenderSystem::drawFollowBoids(float alpha) {
+    World &world = getEngine().getWorld();
+    AnimationSystem &animation = getEngine().getAnimationSystem();
+
+    glColor3f(BoidColorRed, BoidColorGreen, BoidColorBlue);
+    for(size_t f = 0; f < world.getNumFlocks(); ++f) {
+        BoidStore &boids = world.getFlock(f).boids;
+        for(size_t i = 0; i < boids.size(); ++i) {
+            FollowBoid boid = boids[i];
+
+            // Each follow boid looks in the direction it is flying to.
+            Matrix4d rotation = Vector::toRotationMatrix(
+                    boid.interpolateDirection(alpha), Vector(0.0, 1.0, 0.0));
+
+            glPushMatrix();
+                // Translate and rotate.
+                glext::glTranslatep(boid.interpolatePosition(alpha));
+                glext::glMultMatrixm(rotation);
+
+                glCallList(animation.getWingDisplayList(
+                            boid.getWingPhase()));
+            glPopMatrix();
+        }
+    }
 }
 
 void RenderSystem::setUpFog() {
@@ -177,7 +212,8 @@ void RenderSystem::setUpFog() {
     }
 }
 
-RenderSystem::RenderSystem() : _toggleFog(false), _fogEnabled(false) {
+RenderSystem::RenderSystem()
+        : _nextDisplayList(0), _toggleFog(false), _fogEnabled(false) {
 
 }
 
@@ -238,7 +274,15 @@ void RenderSystem::terminate() {
     destroySun();
 }
 
-void RenderSystem::update(float dt) {
+unsigned RenderSystem::getReads() const {
+    return AllComponents;
+}
+
+unsigned RenderSystem::getWrites() const {
+    return 0;
+}
+
+void RenderSystem::update(float alpha) {
     // Fog things.
     if(_toggleFog) {
         _toggleFog = false;
@@ -256,7 +300,7 @@ void RenderSystem::update(float dt) {
     glPushMatrix();
 
     // Position the camera.
-    getEngine().getCameraSystem().lookThroughCamera();
+    getEngine().getCameraSystem().lookThroughCamera(alpha);
 
     // Draw the light.
     glDisable(GL_LIGHTING);
@@ -269,7 +313,7 @@ void RenderSystem::update(float dt) {
     glCallList(_groundDisplayList);
 
     // Draw the shadows.
-    drawShadow();
+    drawShadow(alpha);
 
     // Draw the sun.
     glCallList(_sunDisplayList);
@@ -277,13 +321,15 @@ void RenderSystem::update(float dt) {
     // Draw the center tower.
     glCallList(getEngine().getTower().displayList);
 
-    // Draw the objective boid. MUST be drawn before the other boids.
-    drawObjectiveBoid();
+    // Draw the obstacles.
+    drawObstacles();
+
+    // Draw the objective boids.
+    drawObjectiveBoids(alpha);
 
     // Draw the other boids.
-    drawFollowBoids();
+    drawFollowBoids(alpha);
 
-    // Draw the boids. Their position is relative to the objective boid
     // Swap the buffers.
     glPopMatrix();
     glfwSwapBuffers(getEngine().getWindow());
@@ -59,14 +59,21 @@ class RenderSystem : public System {
     /// Destroys the sun.
     void destroySun();
 
-    /// Draws the shadow.
-    void drawShadow();
+    /**
+     * Draws the shadow.
+     * @param alpha Where to draw the boids between the previous tick (0) and
+     * the current one (1).
+     **/
+    void drawShadow(float alpha);
+
+    /// Draws the objective boids of the flocks. See drawShadow() for alpha.
+    void drawObjectiveBoids(float alpha);
 
-    /// Draws the objective boid.
-    void drawObjectiveBoid();
+    /// Draws the follow boids of the flocks. See drawShadow() for alpha.
+    void drawFollowBoids(float alpha);
 
-    /// Draws the follow boids.
-    void drawFollowBoids();
+    /// Draws the static obstacles, with the colors of the tower.
+    void drawObstacles();
 
     /// sets up fog by the _fogEnabled variable.
     void setUpFog();
@@ -75,7 +82,14 @@ public:
     RenderSystem();
     void init();
     void terminate();
-    void update(float dt);
+
+    /**
+     * Draws the frame. Unlike the other systems, the argument is not a time
+     * step but the alpha of State::render().
+     **/
+    void update(float alpha);
+    unsigned getReads() const;
+    unsigned getWrites() const;
 
     /**
      * Toggles fog.
@@ -28,6 +28,43 @@
 #ifndef SYSTEM_SYSTEM_HPP
 #define SYSTEM_SYSTEM_HPP
 
+/**
+ * The data the systems read and write, as bits of a mask.
+ * The scheduler uses them to know which systems can run at the same time.
+ **/
+enum Component {
+    /// The keys read by Engine::updateKeys().
+    KeysComponent = 1 << 0,
+
+    /// Position, direction and speed of the objective boid.
+    ObjectiveBoidComponent = 1 << 1,
+
+    /// Display list of the objective boid.
+    ObjectiveBoidAnimationComponent = 1 << 2,
+
+    /// Positions of the follow boids.
+    BoidPositionComponent = 1 << 3,
+
+    /// Velocities and speeds of the follow boids.
+    BoidVelocityComponent = 1 << 4,
+
+    /// Wing phases of the follow boids.
+    BoidWingComponent = 1 << 5,
+
+    /// The grid of the follow boids.
+    GridComponent = 1 << 6,
+
+    /// The aggregates of the follow boids (see FlockStats) and their middle
+    /// position.
+    MiddlePositionComponent = 1 << 7,
+
+    /// The camera.
+    CameraComponent = 1 << 8,
+
+    /// All the components.
+    AllComponents = (1 << 9) - 1
+};
+
 /**
  * This class represents a system of the engine.
  * There must be only one instance of each system in the engine, but I am lazy
@@ -56,6 +93,20 @@ public:
      * @param dt How much time to update.
      **/
     virtual void update(float dt) = 0;
+
+    /**
+     * Returns the components (see Component) update() reads.
+     * update() may run at the same time as the updates of other systems
+     * that don't write them.
+     **/
+    virtual unsigned getReads() const = 0;
+
+    /**
+     * Returns the components (see Component) update() writes.
+     * update() may run at the same time as the updates of other systems
+     * that don't read or write them.
+     **/
+    virtual unsigned getWrites() const = 0;
 };
 
 
@@ -0,0 +1,142 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "SystemScheduler.hpp"
+#include <cmath>
+
+namespace {
+    /// If system b, added after system a, must wait for a.
+    bool dependsOn(const System &b, const System &a) {
+        return (a.getWrites() & (b.getReads() | b.getWrites()))
+            || (a.getReads() & b.getWrites());
+    }
+}
+
+struct SystemScheduler::StageTask {
+    SystemScheduler &scheduler;
+
+    StageTask(SystemScheduler &scheduler) : scheduler(scheduler) { }
+
+    void operator()(size_t begin, size_t end, unsigned) {
+        for(size_t i = begin; i < end; ++i)
+            scheduler.updateSystem(scheduler._due[i]);
+    }
+};
+
+void SystemScheduler::buildStages() {
+    std::vector<size_t> stageOf(_systems.size());
+    _stages.clear();
+
+    for(size_t i = 0; i < _systems.size(); ++i) {
+        size_t stage = 0;
+        for(size_t j = 0; j < i; ++j)
+            if(stageOf[j] + 1 > stage && dependsOn(*_systems[i].system,
+                        *_systems[j].system))
+                stage = stageOf[j] + 1;
+
+        stageOf[i] = stage;
+        if(stage == _stages.size())
+            _stages.push_back(std::vector<size_t>());
+        _stages[stage].push_back(i);
+    }
+}
+
+size_t SystemScheduler::find(const System &system) const {
+    size_t i = 0;
+    while(i < _systems.size() && _systems[i].system != &system)
+        ++i;
+    return i;
+}
+
+void SystemScheduler::updateSystem(size_t i) {
+    Entry &entry = _systems[i];
+    entry.system->update(entry.elapsed);
+    entry.elapsed = 0.0;
+}
+
+void SystemScheduler::add(System &system, unsigned rate) {
+    Entry entry;
+    entry.system = &system;
+    entry.elapsed = 0.0;
+    entry.due = false;
+    _systems.push_back(entry);
+    setRate(system, rate);
+    buildStages();
+}
+
+void SystemScheduler::clear() {
+    _systems.clear();
+    _stages.clear();
+}
+
+void SystemScheduler::update(ThreadPool &pool, float dt) {
+    // A system is due each time its credit reaches 1, rate times per
+    // second. It is updated once at most, even if the tick is longer than
+    // its period.
+    for(size_t i = 0; i < _systems.size(); ++i) {
+        Entry &entry = _systems[i];
+        entry.elapsed += dt;
+        entry.credit += dt * entry.rate;
+        entry.due = !entry.rate || entry.credit >= 1.0f;
+        if(entry.due)
+            entry.credit -= std::floor(entry.credit);
+    }
+
+    for(size_t s = 0; s < _stages.size(); ++s) {
+        _due.clear();
+        for(size_t i = 0; i < _stages[s].size(); ++i)
+            if(_systems[_stages[s][i]].due)
+                _due.push_back(_stages[s][i]);
+
+        if(_due.empty())
+            continue;
+        if(_due.size() == 1) {
+            updateSystem(_due[0]);
+            continue;
+        }
+
+        StageTask task(*this);
+        pool.parallelFor(0, _due.size(), 1, task);
+    }
+}
+
+bool SystemScheduler::setRate(const System &system, unsigned rate) {
+    size_t i = find(system);
+    if(i == _systems.size())
+        return false;
+
+    // With a whole update of credit, it is due in the next tick.
+    Entry &entry = _systems[i];
+    entry.rate = rate;
+    entry.credit = 1.0;
+    return true;
+}
+
+unsigned SystemScheduler::getRate(const System &system) const {
+    size_t i = find(system);
+    return i < _systems.size() ? _systems[i].rate : 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SYSTEM_SYSTEMSCHEDULER_HPP
+#define SYSTEM_SYSTEMSCHEDULER_HPP
+
+#include "System.hpp"
+#include "../util/Noncopyable.hpp"
+#include "../util/ThreadPool.hpp"
+#include <vector>
+
+/**
+ * Updates a list of systems, running at the same time the ones that don't
+ * touch the same data, each one as often as it needs.
+ * The systems are added in the order they would be updated one after the
+ * other. A system must wait for an earlier system if one of them writes a
+ * component (see Component) the other reads or writes. The systems are
+ * grouped in stages: each system goes in the stage after the last stage of
+ * the systems it must wait for. The systems of a stage run in parallel on the
+ * thread pool, and the stages run in order, so the result is the same as
+ * updating the systems in the order they were added.
+ * A stage with a single system calls it directly, so the loops inside it
+ * still use all the threads of the pool. Loops started by systems that share
+ * a stage run in the thread running the system.
+ * Each system has its own rate, in updates per second. The scheduler is
+ * updated once per tick, however long the ticks are, and a system slower
+ * than the ticks is only updated in some of them, as evenly as the ticks
+ * allow, by all the time since its last update. The systems updated in a
+ * tick keep their order and their stages, so a slow system still sees the
+ * systems before it up to date.
+ * Which ticks update a system only depends on the rates and the lengths of
+ * the ticks, so the result is the same with any number of threads.
+ **/
+class SystemScheduler : public NonCopyable {
+    /// A system and how often it is updated.
+    struct Entry {
+        System *system;
+
+        /// Updates per second, or 0 for every tick.
+        unsigned rate;
+
+        /// Gains rate * dt every tick, and pays 1 for each update.
+        float credit;
+
+        /// Time since the last update.
+        float elapsed;
+
+        /// If the system is updated in this tick.
+        bool due;
+    };
+
+    /// The systems, in the order they were added.
+    std::vector<Entry> _systems;
+
+    /// The index of the systems of each stage, in the order they were added.
+    std::vector<std::vector<size_t> > _stages;
+
+    /// The systems of the stage being updated that are due in this tick.
+    std::vector<size_t> _due;
+
+    /// Runs the systems of a stage.
+    struct StageTask;
+
+    /// Groups the systems in stages.
+    void buildStages();
+
+    /// Returns the index of the system, or the number of systems if it
+    /// wasn't added.
+    size_t find(const System &system) const;
+
+    /// Updates the system at the given index by the time since its last
+    /// update.
+    void updateSystem(size_t i);
+
+public:
+    /**
+     * Adds a system after the ones already added.
+     * The system is not owned by the scheduler.
+     * @param rate Updates per second of the system, or 0 to update it every
+     * tick. A system is never updated more than once per tick.
+     **/
+    void add(System &system, unsigned rate = 0);
+
+    /// Removes all the systems.
+    void clear();
+
+    /**
+     * Updates the systems due in this tick, in stages.
+     * @param pool The threads to use.
+     * @param dt How long this tick is. The systems slower than the ticks are
+     * updated by the dt of all the ticks since their last update.
+     **/
+    void update(ThreadPool &pool, float dt);
+
+    /**
+     * Changes how many times per second a system is updated. 0 updates it
+     * every tick. Its next update is in the next tick.
+     * @return false if the system wasn't added.
+     **/
+    bool setRate(const System &system, unsigned rate);
+
+    /**
+     * Returns how many times per second a system is updated, or 0 if it is
+     * updated every tick or wasn't added.
+     **/
+    unsigned getRate(const System &system) const;
+
+    /// Returns the number of systems.
+    inline size_t getNumSystems() const {
+        return _systems.size();
+    }
+
+    /// Returns the system at the given index, in the order they were added.
+    inline System &getSystem(size_t i) const {
+        return *_systems[i].system;
+    }
+
+    /// Returns the number of stages.
+    inline size_t getNumStages() const {
+        return _stages.size();
+    }
+
+    /// Returns the index of the systems of the given stage.
+    inline const std::vector<size_t> &getStage(size_t stage) const {
+        return _stages[stage];
+    }
+};
+
+#endif // !SYSTEM_SYSTEMSCHEDULER_HPP
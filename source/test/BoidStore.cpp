@@ -0,0 +1,122 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "../gameObject/BoidStore.hpp"
+#include <catch.hpp>
+#include <vector>
+
+namespace {
+    /// Adds a boid at (x, 0, 0), standing still.
+    BoidHandle addBoid(BoidStore &boids, float x) {
+        return boids.add(Point(x, 0.0, 0.0), Vector(), 0.0);
+    }
+
+    /// Returns the x coordinate of the boid of the handle.
+    float getX(BoidStore &boids, BoidHandle handle) {
+        return toFloat(boids[handle].getPosition().x);
+    }
+}
+
+TEST_CASE("BoidStore/remove", "The handles of the other boids follow them "
+        "when a boid is removed, and the handle of the removed one dies") {
+    BoidStore boids;
+    BoidHandle a = addBoid(boids, 1.0);
+    BoidHandle b = addBoid(boids, 2.0);
+    BoidHandle c = addBoid(boids, 3.0);
+
+    boids.remove(a);
+    REQUIRE(boids.size() == 2);
+    CHECK(!boids.contains(a));
+    REQUIRE(boids.contains(b));
+    REQUIRE(boids.contains(c));
+
+    // The last boid took the index of the removed one.
+    CHECK(boids.indexOf(c) == 0);
+    CHECK(getX(boids, b) == 2.0);
+    CHECK(getX(boids, c) == 3.0);
+}
+
+TEST_CASE("BoidStore/reuse", "A slot reused by a new boid doesn't bring the "
+        "handles of the old boid back") {
+    BoidStore boids;
+    BoidHandle a = addBoid(boids, 1.0);
+    addBoid(boids, 2.0);
+    boids.remove(a);
+
+    BoidHandle d = addBoid(boids, 4.0);
+    CHECK(d.slot == a.slot);
+    CHECK(d != a);
+    CHECK(!boids.contains(a));
+    REQUIRE(boids.contains(d));
+    CHECK(getX(boids, d) == 4.0);
+
+    // Again, after the reused slot is freed.
+    boids.remove(d);
+    BoidHandle e = addBoid(boids, 5.0);
+    CHECK(!boids.contains(a));
+    CHECK(!boids.contains(d));
+    CHECK(boids.contains(e));
+}
+
+TEST_CASE("BoidStore/removeMarked", "The boids left keep their order and "
+        "their handles") {
+    BoidStore boids;
+    std::vector<BoidHandle> handles;
+    for(int i = 0; i < 10; ++i)
+        handles.push_back(addBoid(boids, i));
+
+    std::vector<unsigned char> marked(10, 0);
+    marked[0] = marked[3] = marked[9] = 1;
+    REQUIRE(boids.removeMarked(&marked[0]) == 3);
+    REQUIRE(boids.size() == 7);
+
+    size_t index = 0;
+    for(int i = 0; i < 10; ++i) {
+        if(marked[i]) {
+            CHECK(!boids.contains(handles[i]));
+            continue;
+        }
+
+        REQUIRE(boids.contains(handles[i]));
+        CHECK(boids.indexOf(handles[i]) == index);
+        CHECK(boids.handleAt(index) == handles[i]);
+        CHECK(getX(boids, handles[i]) == i);
+        ++index;
+    }
+}
+
+TEST_CASE("BoidStore/clear", "Clearing the store kills every handle") {
+    BoidStore boids;
+    BoidHandle a = addBoid(boids, 1.0);
+    BoidHandle b = addBoid(boids, 2.0);
+    boids.clear();
+
+    CHECK(boids.size() == 0);
+    CHECK(!boids.contains(a));
+    CHECK(!boids.contains(b));
+    CHECK(!boids.contains(BoidHandle()));
+}
@@ -0,0 +1,128 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "../spatial/KdTree.hpp"
+#include "../util/Random.hpp"
+#include "../util/ThreadPool.hpp"
+#include <algorithm>
+#include <catch.hpp>
+#include <vector>
+
+namespace {
+    /// Points with random positions, the same every run.
+    struct Points {
+        std::vector<float> x, y, z;
+
+        Points(size_t size, uint64_t seed) : x(size), y(size), z(size) {
+            Random random(seed);
+            for(size_t i = 0; i < size; ++i) {
+                x[i] = random.getFloat(0, i, 0, 0) * 100.0f - 50.0f;
+                y[i] = random.getFloat(0, i, 0, 1) * 20.0f;
+                z[i] = random.getFloat(0, i, 0, 2) * 100.0f - 50.0f;
+            }
+        }
+
+        /// Squared distance from point i to a position.
+        float distance2(size_t i, float px, float py, float pz) const {
+            float dx = x[i] - px, dy = y[i] - py, dz = z[i] - pz;
+            return dx * dx + dy * dy + dz * dz;
+        }
+
+        /// Sorted squared distances of all points but skip to a position.
+        std::vector<float> bruteForce(float px, float py, float pz,
+                size_t skip) const {
+            std::vector<float> distances;
+            for(size_t i = 0; i < x.size(); ++i)
+                if(i != skip)
+                    distances.push_back(distance2(i, px, py, pz));
+            std::sort(distances.begin(), distances.end());
+            return distances;
+        }
+    };
+}
+
+TEST_CASE("KdTree/findNearest", "The k nearest points are the same found by "
+        "brute force") {
+    const size_t sizes[] = { 1, 2, 9, 100, 1000 };
+    const size_t k = 8;
+    ThreadPool pool(4);
+
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        INFO("size " << sizes[s]);
+        Points points(sizes[s], s + 1);
+        KdTree tree;
+        tree.build(&points.x[0], &points.y[0], &points.z[0], sizes[s], pool);
+        REQUIRE(tree.size() == sizes[s]);
+        const unsigned *sorted = tree.getSortedIndices();
+
+        Random random(100 + s);
+        for(uint32_t q = 0; q < 50; ++q) {
+            float px = random.getFloat(1, q, 0, 0) * 120.0f - 60.0f;
+            float py = random.getFloat(1, q, 0, 1) * 30.0f - 5.0f;
+            float pz = random.getFloat(1, q, 0, 2) * 120.0f - 60.0f;
+            std::vector<float> expected = points.bruteForce(px, py, pz, ~0u);
+            size_t expectedFound = std::min(k, expected.size());
+
+            unsigned nearest[k];
+            float distances2[k];
+            size_t found = tree.findNearest(px, py, pz, k, ~0u, nearest,
+                    distances2);
+            REQUIRE(found == expectedFound);
+            for(size_t n = 0; n < found; ++n) {
+                REQUIRE(nearest[n] < sizes[s]);
+                CHECK(distances2[n] == Approx(expected[n]));
+                CHECK(points.distance2(sorted[nearest[n]], px, py, pz)
+                        == Approx(distances2[n]));
+            }
+        }
+    }
+}
+
+TEST_CASE("KdTree/findAllNearest", "The nearest points of every point are "
+        "the same found by brute force, without the point itself") {
+    const size_t size = 500, k = 6;
+    ThreadPool pool(4);
+    Points points(size, 42);
+    KdTree tree;
+    tree.build(&points.x[0], &points.y[0], &points.z[0], size, pool);
+    tree.findAllNearest(k, pool);
+    REQUIRE(tree.getNumNearest() == k);
+    const unsigned *sorted = tree.getSortedIndices();
+
+    for(size_t p = 0; p < size; ++p) {
+        size_t i = sorted[p];
+        std::vector<float> expected = points.bruteForce(points.x[i],
+                points.y[i], points.z[i], i);
+        const unsigned *nearest = tree.getNearest(p);
+        for(size_t n = 0; n < k; ++n) {
+            REQUIRE(nearest[n] < size);
+            CHECK(nearest[n] != p);
+            CHECK(points.distance2(sorted[nearest[n]], points.x[i],
+                        points.y[i], points.z[i]) == Approx(expected[n]));
+        }
+    }
+}
@@ -0,0 +1,242 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "../defs.hpp"
+#include "../spatial/ObstacleField.hpp"
+#include "../util/ThreadPool.hpp"
+#include <catch.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdint.h>
+#include <string>
+
+namespace {
+    /// Files written by the tests, in the working directory.
+    const char *const FieldFile = "boids_tests_field.bsdf";
+    const char *const BrokenFile = "boids_tests_broken.bsdf";
+
+    /// Bytes before the first obstacle: magic, version and count.
+    const size_t HeaderBytes = 12;
+
+    /// Bytes of each obstacle.
+    const size_t ObstacleBytes = 20;
+
+    /// Returns an obstacle.
+    Obstacle makeObstacle(Obstacle::Shape shape, float x, float z,
+            float radius, float height) {
+        Obstacle obstacle;
+        obstacle.shape = shape;
+        obstacle.x = x;
+        obstacle.z = z;
+        obstacle.radius = radius;
+        obstacle.height = height;
+        return obstacle;
+    }
+
+    /// Adds the obstacles of the tests.
+    void addObstacles(ObstacleField &field) {
+        field.add(makeObstacle(Obstacle::ConeShape, 0.0, 0.0, 60.0, 400.0));
+        field.add(makeObstacle(Obstacle::PillarShape, 300.0, -200.0, 30.0,
+                    150.0));
+        field.add(makeObstacle(Obstacle::PillarShape, -500.0, 700.0, 20.0,
+                    100.0));
+    }
+
+    /// Returns the contents of a file.
+    std::string readFile(const char *file) {
+        std::ifstream in(file, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in),
+                std::istreambuf_iterator<char>());
+    }
+
+    /// Writes the contents of a file.
+    void writeFile(const char *file, const std::string &data) {
+        std::ofstream out(file, std::ios::binary);
+        out.write(data.data(), data.size());
+    }
+
+    /// Reads a value at a byte offset of the contents of a file.
+    template<class T>
+    T get(const std::string &data, size_t offset) {
+        T value;
+        std::memcpy(&value, data.data() + offset, sizeof(value));
+        return value;
+    }
+
+    /// Writes a value at a byte offset of the contents of a file.
+    template<class T>
+    void put(std::string &data, size_t offset, T value) {
+        std::memcpy(&data[offset], &value, sizeof(value));
+    }
+
+    /// Loads the given contents of a file into a field of the obstacles.
+    bool loadBroken(const std::string &data) {
+        writeFile(BrokenFile, data);
+        ObstacleField field;
+        addObstacles(field);
+        return field.load(BrokenFile);
+    }
+}
+
+TEST_CASE("ObstacleField/load", "A saved field loads back only into a field "
+        "of the same obstacles, and broken files are rejected") {
+    ThreadPool pool(4);
+    ObstacleField baked;
+    addObstacles(baked);
+    baked.bake(pool);
+    REQUIRE(baked.save(FieldFile));
+
+    const std::string data = readFile(FieldFile);
+    const size_t cellSizeOffset = HeaderBytes + 3 * ObstacleBytes;
+    const size_t numBricksOffset = cellSizeOffset + 4;
+    const size_t numSamplesOffset = cellSizeOffset + 8;
+    const size_t offsetsOffset = cellSizeOffset + 12;
+    REQUIRE(data.size() > offsetsOffset);
+    const uint32_t numBricks = get<uint32_t>(data, numBricksOffset);
+    const uint32_t numSamples = get<uint32_t>(data, numSamplesOffset);
+    REQUIRE(numSamples > 0);
+    REQUIRE(data.size() == offsetsOffset + numBricks * sizeof(int)
+            + numSamples * sizeof(float));
+
+    SECTION("same", "The same obstacles load the field") {
+        ObstacleField field;
+        addObstacles(field);
+        REQUIRE(field.load(FieldFile));
+
+        // Same samples as the baked field.
+        for(float x = -100.0; x <= 100.0; x += 7.5) {
+            float gx, gy, gz, bx, by, bz;
+            float distance = field.sample(x, 50.0, x / 2, gx, gy, gz);
+            CHECK(distance == baked.sample(x, 50.0, x / 2, bx, by, bz));
+            CHECK(gx == bx);
+            CHECK(gy == by);
+            CHECK(gz == bz);
+        }
+    }
+
+    SECTION("missing", "A missing file is rejected") {
+        std::remove(BrokenFile);
+        ObstacleField field;
+        addObstacles(field);
+        CHECK(!field.load(BrokenFile));
+    }
+
+    SECTION("obstacles", "Different obstacles are rejected") {
+        ObstacleField fewer;
+        fewer.add(makeObstacle(Obstacle::ConeShape, 0.0, 0.0, 60.0, 400.0));
+        CHECK(!fewer.load(FieldFile));
+
+        ObstacleField more;
+        addObstacles(more);
+        more.add(makeObstacle(Obstacle::ConeShape, 10.0, 0.0, 20.0, 100.0));
+        CHECK(!more.load(FieldFile));
+
+        ObstacleField moved;
+        moved.add(makeObstacle(Obstacle::ConeShape, 0.0, 0.0, 60.0, 400.0));
+        moved.add(makeObstacle(Obstacle::PillarShape, 300.0, -200.0, 30.0,
+                    150.0));
+        moved.add(makeObstacle(Obstacle::PillarShape, -500.0, 700.5, 20.0,
+                    100.0));
+        CHECK(!moved.load(FieldFile));
+
+        ObstacleField reshaped;
+        reshaped.add(makeObstacle(Obstacle::PillarShape, 0.0, 0.0, 60.0,
+                    400.0));
+        reshaped.add(makeObstacle(Obstacle::PillarShape, 300.0, -200.0, 30.0,
+                    150.0));
+        reshaped.add(makeObstacle(Obstacle::PillarShape, -500.0, 700.0, 20.0,
+                    100.0));
+        CHECK(!reshaped.load(FieldFile));
+    }
+
+    SECTION("header", "A broken header is rejected") {
+        std::string broken = data;
+        broken[0] = 'X';
+        CHECK(!loadBroken(broken));
+
+        broken = data;
+        put<uint32_t>(broken, 4, 2);
+        CHECK(!loadBroken(broken));
+
+        broken = data;
+        put<uint32_t>(broken, 8, 4);
+        CHECK(!loadBroken(broken));
+    }
+
+    SECTION("layout", "A field of another layout is rejected") {
+        std::string broken = data;
+        put<float>(broken, cellSizeOffset, ObstacleFieldCellSize * 2);
+        CHECK(!loadBroken(broken));
+
+        broken = data;
+        put<uint32_t>(broken, numBricksOffset, numBricks - 1);
+        CHECK(!loadBroken(broken));
+
+        broken = data;
+        put<uint32_t>(broken, numSamplesOffset, numSamples - 1);
+        CHECK(!loadBroken(broken));
+    }
+
+    SECTION("truncated", "A truncated file is rejected") {
+        const size_t sizes[] = { 0, 3, HeaderBytes + ObstacleBytes / 2,
+            offsetsOffset, offsetsOffset + numBricks * sizeof(int),
+            data.size() - 1 };
+        for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+            INFO("size " << sizes[s]);
+            CHECK(!loadBroken(data.substr(0, sizes[s])));
+        }
+    }
+
+    SECTION("offsets", "Brick offsets outside the samples are rejected") {
+        size_t brick = 0;
+        while(brick < numBricks && get<int>(data,
+                    offsetsOffset + brick * sizeof(int)) < 0)
+            ++brick;
+        REQUIRE(brick < numBricks);
+        const size_t offset = offsetsOffset + brick * sizeof(int);
+
+        // Past the end.
+        std::string broken = data;
+        put<int>(broken, offset, numSamples);
+        CHECK(!loadBroken(broken));
+
+        // Not at the start of a brick.
+        broken = data;
+        put<int>(broken, offset, get<int>(data, offset) + 1);
+        CHECK(!loadBroken(broken));
+
+        // Still valid, only moved to another brick.
+        broken = data;
+        put<int>(broken, offset, 0);
+        CHECK(loadBroken(broken));
+    }
+
+    std::remove(FieldFile);
+    std::remove(BrokenFile);
+}
@@ -0,0 +1,147 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "../util/ThreadPool.hpp"
+#include <catch.hpp>
+#include <vector>
+
+namespace {
+    /// Counts how many times each index was run, and checks the chunks.
+    struct CountTask {
+        std::vector<int> &count;
+        size_t begin, chunkSize;
+        unsigned numThreads;
+        bool chunksOk;
+
+        CountTask(std::vector<int> &countVal, size_t beginVal,
+                size_t chunkSizeVal, unsigned numThreadsVal)
+                : count(countVal), begin(beginVal), chunkSize(chunkSizeVal),
+                  numThreads(numThreadsVal), chunksOk(true) {
+
+        }
+
+        void operator()(size_t chunkBegin, size_t chunkEnd, unsigned thread) {
+            // Each chunk writes only its own indices, so no lock is needed.
+            if(thread >= numThreads || chunkBegin >= chunkEnd
+                    || (chunkBegin - begin) % chunkSize
+                    || chunkEnd - chunkBegin > chunkSize)
+                chunksOk = false;
+            for(size_t i = chunkBegin; i < chunkEnd; ++i)
+                ++count[i];
+        }
+    };
+
+    /// Runs a loop over the row of each index of an outer loop.
+    struct NestedTask {
+        ThreadPool &pool;
+        std::vector<int> &count;
+        size_t columns;
+        std::vector<unsigned char> &threadsOk;
+
+        NestedTask(ThreadPool &poolVal, std::vector<int> &countVal,
+                size_t columnsVal, std::vector<unsigned char> &threadsOkVal)
+                : pool(poolVal), count(countVal), columns(columnsVal),
+                  threadsOk(threadsOkVal) {
+
+        }
+
+        void operator()(size_t begin, size_t end, unsigned) {
+            for(size_t row = begin; row < end; ++row) {
+                size_t first = row * columns;
+                CountTask inner(count, first, 3, 1);
+                pool.parallelFor(first, first + columns, 3, inner);
+                threadsOk[row] = inner.chunksOk;
+            }
+        }
+    };
+}
+
+TEST_CASE("ThreadPool/parallelFor", "Every index of the range is run once, "
+        "in chunks of the given size") {
+    const unsigned threads[] = { 1, 2, 4, 7 };
+    const size_t ranges[][3] = {
+        // begin, end, chunkSize.
+        { 0, 0, 8 },
+        { 5, 5, 8 },
+        { 0, 1, 8 },
+        { 0, 64, 8 },
+        { 0, 1000, 7 },
+        { 13, 1000, 64 },
+        { 3, 50, 0 },
+        { 0, 10, 100 }
+    };
+
+    for(size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); ++t) {
+        ThreadPool pool(threads[t]);
+        REQUIRE(pool.getNumThreads() == threads[t]);
+
+        for(size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); ++r) {
+            size_t begin = ranges[r][0], end = ranges[r][1];
+            size_t chunkSize = ranges[r][2] ? ranges[r][2] : 1;
+            INFO("threads " << threads[t] << ", range [" << begin << ", "
+                    << end << "), chunk size " << ranges[r][2]);
+
+            std::vector<int> count(end + 1, 0);
+            CountTask task(count, begin, chunkSize, pool.getNumThreads());
+            pool.parallelFor(begin, end, ranges[r][2], task);
+
+            CHECK(task.chunksOk);
+            for(size_t i = 0; i < count.size(); ++i)
+                if(count[i] != (i >= begin && i < end))
+                    FAIL("index " << i << " run " << count[i] << " times");
+        }
+    }
+}
+
+TEST_CASE("ThreadPool/getNumChunks", "The number of chunks rounds up") {
+    CHECK(ThreadPool::getNumChunks(0, 0, 8) == 0);
+    CHECK(ThreadPool::getNumChunks(0, 8, 8) == 1);
+    CHECK(ThreadPool::getNumChunks(0, 9, 8) == 2);
+    CHECK(ThreadPool::getNumChunks(13, 1000, 64) == 16);
+}
+
+TEST_CASE("ThreadPool/nested", "A loop started from inside another loop "
+        "runs all of its chunks in the thread that started it") {
+    const unsigned threads[] = { 1, 4 };
+    const size_t rows = 40, columns = 25;
+
+    for(size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); ++t) {
+        INFO("threads " << threads[t]);
+        ThreadPool pool(threads[t]);
+        std::vector<int> count(rows * columns, 0);
+        std::vector<unsigned char> threadsOk(rows, 0);
+
+        NestedTask task(pool, count, columns, threadsOk);
+        pool.parallelFor(0, rows, 1, task);
+
+        for(size_t row = 0; row < rows; ++row)
+            CHECK(threadsOk[row]);
+        for(size_t i = 0; i < count.size(); ++i)
+            if(count[i] != 1)
+                FAIL("cell " << i << " run " << count[i] << " times");
+    }
+}
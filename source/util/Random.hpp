@@ -0,0 +1,204 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef UTIL_RANDOM_HPP
+#define UTIL_RANDOM_HPP
+
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * The independent streams of random numbers of a simulation. Each use of
+ * random numbers has its own stream, so adding a use never changes the
+ * numbers of the others.
+ **/
+enum RandomStreamId {
+    /// Placement of the objective boid.
+    ObjectiveBoidStream,
+
+    /// Placement of the new follow boids.
+    SpawnStream,
+
+    /// Choice of the boids to remove.
+    RemoveStream,
+
+    /// Display lists and wing phases.
+    AnimationStream,
+
+    /// Flocks created by the benchmarks.
+    BenchmarkStream,
+
+    /// Placement of the static obstacles.
+    ObstacleStream,
+
+    /// Waypoints of the leaders of the other flocks.
+    WaypointStream
+};
+
+/**
+ * Counter-based random numbers (Philox4x32-10, from Salmon et al., "Parallel
+ * Random Numbers: As Easy as 1, 2, 3").
+ * Instead of a state that advances with each number, each number is a hash of
+ * a counter with the seed: (stream, id, tick, index), where id is usually a
+ * boid. So the numbers don't depend on the order they are drawn in, or on
+ * which thread draws them: a boid gets the same numbers in a tick with any
+ * number of threads, and a loop over the boids can draw them in parallel, or
+ * in SIMD registers, with no shared state.
+ **/
+class Random {
+    /// The key: the seed.
+    uint32_t _key[2];
+
+    /// Returns the high and low 32 bits of a * b.
+    static inline uint32_t mulhilo(uint32_t a, uint32_t b, uint32_t &hi) {
+        uint64_t product = (uint64_t) a * b;
+        hi = product >> 32;
+        return (uint32_t) product;
+    }
+
+public:
+    /// Creates the numbers of the given seed.
+    explicit Random(uint64_t seed = 0) {
+        setSeed(seed);
+    }
+
+    /// Changes the seed.
+    inline void setSeed(uint64_t seed) {
+        _key[0] = (uint32_t) seed;
+        _key[1] = (uint32_t) (seed >> 32);
+    }
+
+    /// Returns the seed.
+    inline uint64_t getSeed() const {
+        return ((uint64_t) _key[1] << 32) | _key[0];
+    }
+
+    /**
+     * Returns the four random numbers of a counter.
+     * @param counter The counter, which is replaced by the numbers.
+     **/
+    inline void generate(uint32_t counter[4]) const {
+        const uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+        const uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+        uint32_t k0 = _key[0], k1 = _key[1];
+
+        for(int round = 0; round < 10; ++round) {
+            uint32_t hi0, hi1;
+            uint32_t lo0 = mulhilo(M0, counter[0], hi0);
+            uint32_t lo1 = mulhilo(M1, counter[2], hi1);
+            counter[0] = hi1 ^ counter[1] ^ k0;
+            counter[1] = lo1;
+            counter[2] = hi0 ^ counter[3] ^ k1;
+            counter[3] = lo0;
+            k0 += W0;
+            k1 += W1;
+        }
+    }
+
+    /**
+     * Returns a random 32 bit number.
+     * @param stream What the number is for (see RandomStreamId).
+     * @param id Whose number it is, usually a boid.
+     * @param tick The tick it is drawn in.
+     * @param index Index of the number, for more than one per id and tick.
+     **/
+    inline uint32_t get(uint32_t stream, uint32_t id, uint32_t tick,
+            uint32_t index = 0) const {
+        uint32_t counter[4] = { index / 4, id, tick, stream };
+        generate(counter);
+        return counter[index % 4];
+    }
+
+    /// Like get(), but returns a float in [0, 1).
+    inline float getFloat(uint32_t stream, uint32_t id, uint32_t tick,
+            uint32_t index = 0) const {
+        return toFloat(get(stream, id, tick, index));
+    }
+
+    /**
+     * Writes getFloat(stream, id, tick, index) for each id in [begin, end) to
+     * values[id - begin]. Each value only depends on its id, so the loop can
+     * be split between threads and vectorized.
+     **/
+    inline void fillFloats(uint32_t stream, uint32_t tick, uint32_t index,
+            size_t begin, size_t end, float *values) const {
+        for(size_t id = begin; id < end; ++id) {
+            uint32_t counter[4] = { index / 4, (uint32_t) id, tick, stream };
+            generate(counter);
+            values[id - begin] = toFloat(counter[index % 4]);
+        }
+    }
+
+    /// Converts a random 32 bit number to a float in [0, 1).
+    static inline float toFloat(uint32_t number) {
+        // The 24 high bits fit exactly in the mantissa.
+        return (number >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+/**
+ * The numbers of one stream, id and tick of a Random, drawn one after the
+ * other, for the code that needs an unknown amount of them.
+ **/
+class RandomStream {
+    const Random &_random;
+    uint32_t _stream, _id, _tick;
+
+    /// Index of the next number.
+    uint32_t _index;
+
+    /// The numbers of the current counter.
+    uint32_t _numbers[4];
+
+public:
+    RandomStream(const Random &random, uint32_t stream, uint32_t id,
+            uint32_t tick)
+            : _random(random), _stream(stream), _id(id), _tick(tick),
+            _index(0) {
+
+    }
+
+    /// Returns the next random 32 bit number.
+    inline uint32_t next() {
+        if(_index % 4 == 0) {
+            _numbers[0] = _index / 4;
+            _numbers[1] = _id;
+            _numbers[2] = _tick;
+            _numbers[3] = _stream;
+            _random.generate(_numbers);
+        }
+
+        return _numbers[_index++ % 4];
+    }
+
+    /// Returns the next random float in [0, 1).
+    inline float nextFloat() {
+        return Random::toFloat(next());
+    }
+};
+
+#endif // !UTIL_RANDOM_HPP
@@ -0,0 +1,202 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ThreadPool.hpp"
+
+namespace {
+    /// If the thread is running chunks of a loop.
+    thread_local bool insideLoop = false;
+
+    /// Returns the number of threads to use for the given option.
+    unsigned chooseNumThreads(unsigned numThreads) {
+        if(numThreads)
+            return numThreads;
+
+        unsigned hardware = std::thread::hardware_concurrency();
+        return hardware ? hardware : 1;
+    }
+}
+
+ThreadPool::ThreadPool(unsigned numThreads)
+        : _numThreads(chooseNumThreads(numThreads)), _blocks(0),
+        _generation(0), _stop(false), _busy(0), _task(0), _begin(0), _end(0),
+        _chunkSize(1), _remaining(0) {
+    startWorkers();
+}
+
+ThreadPool::~ThreadPool() {
+    stopWorkers();
+}
+
+void ThreadPool::setNumThreads(unsigned numThreads) {
+    stopWorkers();
+    _numThreads = chooseNumThreads(numThreads);
+    startWorkers();
+}
+
+void ThreadPool::startWorkers() {
+    _blocks = new Block[_numThreads];
+    _stop = false;
+
+    // The calling thread is thread 0.
+    for(unsigned i = 1; i < _numThreads; ++i)
+        _workers.push_back(std::thread(&ThreadPool::work, this, i));
+}
+
+void ThreadPool::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _start.notify_all();
+
+    for(size_t i = 0; i < _workers.size(); ++i)
+        _workers[i].join();
+    _workers.clear();
+
+    delete[] _blocks;
+    _blocks = 0;
+}
+
+void ThreadPool::work(unsigned thread) {
+    unsigned long generation = 0;
+
+    for(;;) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while(!_stop && (generation == _generation || !_remaining))
+                _start.wait(lock);
+
+            if(_stop)
+                return;
+
+            // Join the loop. run() doesn't return while a worker is inside it.
+            generation = _generation;
+            ++_busy;
+        }
+
+        runChunksInLoop(thread);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            --_busy;
+        }
+        _done.notify_one();
+    }
+}
+
+void ThreadPool::runChunks(unsigned thread) {
+    size_t chunk;
+    while(takeChunk(thread, chunk) || stealChunk(thread, chunk))
+        runChunk(chunk, thread);
+}
+
+void ThreadPool::runChunksInLoop(unsigned thread) {
+    insideLoop = true;
+    runChunks(thread);
+    insideLoop = false;
+}
+
+bool ThreadPool::takeChunk(unsigned thread, size_t &chunk) {
+    Block &block = _blocks[thread];
+    std::lock_guard<std::mutex> lock(block.mutex);
+    if(block.front == block.back)
+        return false;
+
+    chunk = block.front++;
+    return true;
+}
+
+bool ThreadPool::stealChunk(unsigned thread, size_t &chunk) {
+    for(unsigned i = 1; i < _numThreads; ++i) {
+        Block &block = _blocks[(thread + i) % _numThreads];
+        std::lock_guard<std::mutex> lock(block.mutex);
+        if(block.front != block.back) {
+            chunk = --block.back;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::runChunk(size_t chunk, unsigned thread) {
+    size_t begin = _begin + chunk * _chunkSize;
+    size_t end = begin + _chunkSize < _end ? begin + _chunkSize : _end;
+    _task->run(begin, end, thread);
+
+    if(_remaining.fetch_sub(1) == 1) {
+        // Last chunk: wake the calling thread. Take the mutex so it can't
+        // miss the notification between checking and waiting.
+        std::lock_guard<std::mutex> lock(_mutex);
+        _done.notify_one();
+    }
+}
+
+void ThreadPool::run(Task &task, size_t begin, size_t end, size_t chunkSize) {
+    if(!chunkSize)
+        chunkSize = 1;
+    size_t numChunks = getNumChunks(begin, end, chunkSize);
+    if(!numChunks)
+        return;
+
+    // Nothing to share, or called from inside a loop, whose chunks may be
+    // waiting for this one: run the chunks in order in this thread.
+    if(_numThreads == 1 || numChunks == 1 || insideLoop) {
+        for(size_t b = begin; b < end; b += chunkSize)
+            task.run(b, b + chunkSize < end ? b + chunkSize : end, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _task = &task;
+        _begin = begin;
+        _end = end;
+        _chunkSize = chunkSize;
+
+        // Deal the chunks in contiguous blocks, so each thread works on
+        // boids close to each other in memory.
+        for(unsigned i = 0; i < _numThreads; ++i) {
+            _blocks[i].front = numChunks * i / _numThreads;
+            _blocks[i].back = numChunks * (i + 1) / _numThreads;
+        }
+
+        _remaining = numChunks;
+        ++_generation;
+    }
+    _start.notify_all();
+
+    runChunksInLoop(0);
+
+    // Wait for the chunks stolen by the workers, and for the workers to
+    // leave the loop before it can be replaced.
+    std::unique_lock<std::mutex> lock(_mutex);
+    while(_remaining || _busy)
+        _done.wait(lock);
+    _task = 0;
+}
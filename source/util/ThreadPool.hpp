@@ -0,0 +1,199 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef UTIL_THREADPOOL_HPP
+#define UTIL_THREADPOOL_HPP
+
+#include "Noncopyable.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A pool of threads that runs loops over index ranges in parallel.
+ * parallelFor() cuts the range into chunks of a fixed size and deals them
+ * out to the threads in contiguous blocks. Each thread runs the chunks of its
+ * block in order, and when it runs out, steals chunks from the end of the
+ * blocks of the other threads, so the threads stay busy even when some
+ * chunks are slower than others. The calling thread works as one of the
+ * threads of the pool.
+ * The chunks only depend on the range and the chunk size, never on the
+ * number of threads, so a loop whose chunks write to separate data gives the
+ * same results with any number of threads. Reductions must combine results
+ * per chunk, in chunk order (see getNumChunks()).
+ * A loop started from inside the body of another loop runs in order in the
+ * thread that started it, with thread index 0.
+ **/
+class ThreadPool : public NonCopyable {
+public:
+    /// A loop body, run once per chunk.
+    class Task {
+    public:
+        virtual ~Task() { }
+
+        /**
+         * Runs the loop body over [begin, end).
+         * @param thread Index of the thread running the chunk, smaller than
+         * getNumThreads(). Used to pick scratch space for the thread.
+         **/
+        virtual void run(size_t begin, size_t end, unsigned thread) = 0;
+    };
+
+private:
+    /// Chunks dealt to a thread that were not taken yet.
+    struct Block {
+        std::mutex mutex;
+
+        /// The chunks [front, back) are left.
+        size_t front, back;
+    };
+
+    /// Number of threads, including the calling thread.
+    unsigned _numThreads;
+
+    /// The worker threads: all but the calling thread.
+    std::vector<std::thread> _workers;
+
+    /// Chunks of each thread, for the current loop.
+    Block *_blocks;
+
+    /// Protects the state of the current loop and the fields below.
+    std::mutex _mutex;
+
+    /// Wakes the workers when there is a new loop or they must stop.
+    std::condition_variable _start;
+
+    /// Wakes the calling thread when the loop is over.
+    std::condition_variable _done;
+
+    /// Incremented for each new loop.
+    unsigned long _generation;
+
+    /// If the workers must stop.
+    bool _stop;
+
+    /// Number of workers inside the current loop.
+    unsigned _busy;
+
+    /// The current loop.
+    Task *_task;
+    size_t _begin, _end, _chunkSize;
+
+    /// Number of chunks of the current loop not yet finished.
+    std::atomic<size_t> _remaining;
+
+    /// Starts the worker threads.
+    void startWorkers();
+
+    /// Stops the worker threads.
+    void stopWorkers();
+
+    /// Runs runChunks() marking the thread as inside a loop.
+    void runChunksInLoop(unsigned thread);
+
+    /// Body of the worker threads.
+    void work(unsigned thread);
+
+    /**
+     * Runs chunks of the current loop, first from the block of the thread,
+     * then stolen from the others, until there are none left to take.
+     **/
+    void runChunks(unsigned thread);
+
+    /// Takes the next chunk of the block of the thread.
+    bool takeChunk(unsigned thread, size_t &chunk);
+
+    /// Steals the last chunk of the block of another thread.
+    bool stealChunk(unsigned thread, size_t &chunk);
+
+    /// Runs one chunk of the current loop.
+    void runChunk(size_t chunk, unsigned thread);
+
+    /// Calls a function object as a Task.
+    template<typename Function>
+    class FunctionTask : public Task {
+        Function &_function;
+
+    public:
+        FunctionTask(Function &function) : _function(function) { }
+
+        void run(size_t begin, size_t end, unsigned thread) {
+            _function(begin, end, thread);
+        }
+    };
+
+public:
+    /**
+     * Creates the pool.
+     * @param numThreads Number of threads, including the calling thread. 0
+     * uses one thread per hardware thread.
+     **/
+    explicit ThreadPool(unsigned numThreads = 0);
+
+    ~ThreadPool();
+
+    /**
+     * Changes the number of threads, including the calling thread. 0 uses
+     * one thread per hardware thread.
+     * Must not be called while a loop is running.
+     **/
+    void setNumThreads(unsigned numThreads);
+
+    /// Returns the number of threads, including the calling thread.
+    inline unsigned getNumThreads() const {
+        return _numThreads;
+    }
+
+    /// Returns the number of chunks parallelFor() cuts the range into.
+    static inline size_t getNumChunks(size_t begin, size_t end,
+            size_t chunkSize) {
+        return end > begin ? (end - begin + chunkSize - 1) / chunkSize : 0;
+    }
+
+    /**
+     * Runs task.run() over [begin, end) in chunks of chunkSize indices (the
+     * last chunk may be smaller), and returns when all of them are done.
+     * Chunk c is [begin + c * chunkSize, begin + (c + 1) * chunkSize).
+     **/
+    void run(Task &task, size_t begin, size_t end, size_t chunkSize);
+
+    /**
+     * Like run(), but calls function(chunkBegin, chunkEnd, thread) for each
+     * chunk.
+     **/
+    template<typename Function>
+    inline void parallelFor(size_t begin, size_t end, size_t chunkSize,
+            Function &function) {
+        FunctionTask<Function> task(function);
+        run(task, begin, end, chunkSize);
+    }
+};
+
+#endif // !UTIL_THREADPOOL_HPP
@@ -0,0 +1,53 @@
+/*
+ * Author: Renato Utsch Gonçalves
+ * Computer Science, UFMG
+ * Computer Graphics
+ * Practical exercise 2 - Boids
+ *
+ * Copyright (c) 2014 Renato Utsch <renatoutsch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef UTIL_ALIGNED_HPP
+#define UTIL_ALIGNED_HPP
+
+#include <cstddef>
+
+/// Utility functions.
+namespace util {
+    /// Alignment of the memory returned by alignedAlloc(), in bytes. This is
+    /// the size of the widest SIMD register we use (AVX).
+    const size_t MemoryAlignment = 32;
+
+    /**
+     * Allocates memory aligned to MemoryAlignment bytes.
+     * Exits the program if there is no memory.
+     * The memory must be freed by alignedFree().
+     * @param size The size of the memory, in bytes.
+     **/
+    void *alignedAlloc(size_t size);
+
+    /**
+     * Frees memory allocated by alignedAlloc(). Does nothing with NULL.
+     **/
+    void alignedFree(void *memory);
+}
+
+#endif // !UTIL_ALIGNED_HPP